@@ -0,0 +1,556 @@
+#include "accessor_view.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+// SSE2 is the x64 baseline; on 32-bit x86 only when the build asks for it
+#if defined(_M_X64) || defined(__x86_64__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define ACCESSOR_VIEW_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* =========================
+   Source
+   ========================= */
+
+template <typename S>
+static inline S Load(const unsigned char* p)
+{
+    S v;
+    std::memcpy(&v, p, sizeof(S));
+    return v;
+}
+
+// Bytes [offset, offset + (count - 1) * stride + elementSize) of a view
+static bool Locate(
+    const tinygltf::Model& model,
+    int viewIndex,
+    size_t offset,
+    size_t stride,
+    size_t count,
+    size_t elementSize,
+    const unsigned char*& out)
+{
+    if (viewIndex < 0 || viewIndex >= static_cast<int>(model.bufferViews.size()))
+        return false;
+
+    const auto& view = model.bufferViews[viewIndex];
+    if (view.buffer < 0 || view.buffer >= static_cast<int>(model.buffers.size()))
+        return false;
+
+    const auto& buf = model.buffers[view.buffer];
+    if (view.byteOffset + view.byteLength > buf.Size())
+        return false;
+
+    size_t needed = count ? (count - 1) * stride + elementSize : 0;
+    if (offset + needed > view.byteLength)
+        return false;
+
+    out = buf.Data() + view.byteOffset + offset;
+    return true;
+}
+
+static size_t SparseIndex(const AccessorSource& s, size_t k)
+{
+    switch (s.sparseIndexType)
+    {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        return s.sparseIndices[k];
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        return Load<unsigned short>(s.sparseIndices + k * 2);
+    default:
+        return Load<unsigned int>(s.sparseIndices + k * 4);
+    }
+}
+
+bool MakeAccessorSource(
+    const tinygltf::Model& model,
+    const tinygltf::Accessor& accessor,
+    AccessorSource& out)
+{
+    out = AccessorSource();
+
+    int size = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+    int components = tinygltf::GetNumComponentsInType(accessor.type);
+    if (size <= 0 || components <= 0)
+    {
+        std::cerr << "Accessor has an unknown type or component type\n";
+        return false;
+    }
+
+    AccessorSource s;
+    s.count = accessor.count;
+    s.componentType = accessor.componentType;
+    s.components = components;
+    s.normalized = accessor.normalized;
+
+    switch (accessor.type)
+    {
+    case TINYGLTF_TYPE_MAT2: s.columns = 2; break;
+    case TINYGLTF_TYPE_MAT3: s.columns = 3; break;
+    case TINYGLTF_TYPE_MAT4: s.columns = 4; break;
+    }
+
+    s.columnStride = static_cast<size_t>(size) * (components / s.columns);
+    if (s.columns > 1)
+        s.columnStride = (s.columnStride + 3) & ~size_t(3);
+
+    const size_t elementSize = s.columnStride * s.columns;
+
+    // Without a buffer view the elements are zeros, unless sparse
+    if (accessor.bufferView >= 0)
+    {
+        if (accessor.bufferView >= static_cast<int>(model.bufferViews.size()))
+        {
+            std::cerr << "Accessor buffer view out of range\n";
+            return false;
+        }
+
+        const auto& view = model.bufferViews[accessor.bufferView];
+        int stride = accessor.ByteStride(view);
+        if (stride <= 0)
+        {
+            std::cerr << "Accessor has an invalid byteStride\n";
+            return false;
+        }
+
+        // Tightly packed elements still carry the column padding
+        s.stride = view.byteStride ? static_cast<size_t>(stride) : elementSize;
+
+        if (!Locate(model, accessor.bufferView, accessor.byteOffset,
+                s.stride, s.count, elementSize, s.data))
+        {
+            std::cerr << "Accessor runs past its buffer view\n";
+            return false;
+        }
+    }
+
+    const auto& sparse = accessor.sparse;
+    if (sparse.isSparse && sparse.count > 0)
+    {
+        int indexType = sparse.indices.componentType;
+        if (indexType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+            indexType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT &&
+            indexType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+        {
+            std::cerr << "Sparse indices must be unsigned integers\n";
+            return false;
+        }
+
+        size_t indexSize = tinygltf::GetComponentSizeInBytes(indexType);
+        s.sparseCount = sparse.count;
+        s.sparseIndexType = indexType;
+
+        if (!Locate(model, sparse.indices.bufferView, sparse.indices.byteOffset,
+                indexSize, s.sparseCount, indexSize, s.sparseIndices) ||
+            !Locate(model, sparse.values.bufferView, sparse.values.byteOffset,
+                elementSize, s.sparseCount, elementSize, s.sparseValues))
+        {
+            std::cerr << "Sparse accessor runs past its buffer views\n";
+            return false;
+        }
+
+        // Substitution binary-searches the indices
+        for (size_t k = 0; k < s.sparseCount; k++)
+        {
+            size_t index = SparseIndex(s, k);
+            if (index >= s.count || (k > 0 && index <= SparseIndex(s, k - 1)))
+            {
+                std::cerr << "Sparse indices must be ascending and in range\n";
+                return false;
+            }
+        }
+    }
+
+    out = s;
+    return true;
+}
+
+/* =========================
+   Conversion
+   ========================= */
+
+// ---- Scalar ----
+
+template <typename In>
+static inline void Store(float& out, In v, float scale, float lo)
+{
+    out = std::max(static_cast<float>(v) * scale, lo);
+}
+
+template <typename In>
+static inline void Store(unsigned short& out, In v, float, float)
+{
+    out = static_cast<unsigned short>(v);
+}
+
+template <typename In>
+static inline void Store(unsigned int& out, In v, float, float)
+{
+    out = static_cast<unsigned int>(v);
+}
+
+template <typename In, typename Out>
+static void ConvertRun(
+    const unsigned char* src, size_t srcStride,
+    size_t count, int n, int components,
+    float scale, float lo,
+    unsigned char* dst, size_t dstStride)
+{
+    for (size_t i = 0; i < count; i++, src += srcStride, dst += dstStride)
+    {
+        Out* o = reinterpret_cast<Out*>(dst);
+        for (int c = 0; c < n; c++)
+            Store(o[c], Load<In>(src + c * sizeof(In)), scale, lo);
+        for (int c = n; c < components; c++)
+            o[c] = Out(0);
+    }
+}
+
+// ---- Same type ----
+// Straight copies when the accessor already holds the output scalars
+
+static void CopyRun(
+    const unsigned char* src, size_t srcStride,
+    size_t count, size_t bytes,
+    unsigned char* dst, size_t dstStride)
+{
+    if (srcStride == bytes && dstStride == bytes)
+    {
+        std::memcpy(dst, src, count * bytes);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++, src += srcStride, dst += dstStride)
+        std::memcpy(dst, src, bytes);
+}
+
+static int NativeType(float*) { return TINYGLTF_COMPONENT_TYPE_FLOAT; }
+static int NativeType(unsigned short*) { return TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT; }
+static int NativeType(unsigned int*) { return TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT; }
+
+// ---- SIMD ----
+
+#if defined(ACCESSOR_VIEW_SSE2)
+
+// Low 4 components sign or zero extended to 32 bits
+template <int Type>
+static inline __m128i Widen(__m128i v)
+{
+    const __m128i zero = _mm_setzero_si128();
+    switch (Type)
+    {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        return _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero);
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+        v = _mm_unpacklo_epi8(v, v);
+        return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 24);
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        return _mm_unpacklo_epi16(v, zero);
+    default:
+        return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    }
+}
+
+// 8/16-bit vec2-vec4 to float, one element per iteration. n <= 4, so
+// an element fits the 8-byte load.
+template <int Type>
+static void SmallIntToFloat(
+    const unsigned char* src, size_t srcStride,
+    size_t count, int n,
+    float scale, float lo,
+    unsigned char* dst, size_t dstStride)
+{
+    const size_t bytes = n * tinygltf::GetComponentSizeInBytes(Type);
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 vlo = _mm_set1_ps(lo);
+
+    for (size_t i = 0; i < count; i++, src += srcStride, dst += dstStride)
+    {
+        long long raw = 0;
+        std::memcpy(&raw, src, bytes);
+
+        __m128i v = Widen<Type>(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&raw)));
+        __m128 f = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(v), vscale), vlo);
+
+        if (n == 4)
+        {
+            _mm_storeu_ps(reinterpret_cast<float*>(dst), f);
+        }
+        else
+        {
+            alignas(16) float tmp[4];
+            _mm_store_ps(tmp, f);
+            std::memcpy(dst, tmp, n * sizeof(float));
+        }
+    }
+}
+
+// Packed index widening, 8 or 16 at a time
+static void WidenIndices8(const unsigned char* src, size_t count, unsigned int* dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i* d = reinterpret_cast<__m128i*>(dst + i);
+        _mm_storeu_si128(d + 0, _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128(d + 1, _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128(d + 2, _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128(d + 3, _mm_unpackhi_epi16(hi, zero));
+    }
+    for (; i < count; i++)
+        dst[i] = src[i];
+}
+
+static void WidenIndices16(const unsigned char* src, size_t count, unsigned int* dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        __m128i* d = reinterpret_cast<__m128i*>(dst + i);
+        _mm_storeu_si128(d + 0, _mm_unpacklo_epi16(v, zero));
+        _mm_storeu_si128(d + 1, _mm_unpackhi_epi16(v, zero));
+    }
+    for (; i < count; i++)
+        dst[i] = Load<unsigned short>(src + i * 2);
+}
+
+#endif
+
+// Output specific fast paths; false to take the scalar loop
+static bool ConvertFast(
+    const AccessorSource& s, const unsigned char* src, size_t srcStride,
+    size_t count, int n, int components, float scale, float lo,
+    float*, unsigned char* dst, size_t dstStride)
+{
+#if defined(ACCESSOR_VIEW_SSE2)
+    if (n != components || n < 2 || n > 4)
+        return false;
+
+    switch (s.componentType)
+    {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        SmallIntToFloat<TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE>(src, srcStride, count, n, scale, lo, dst, dstStride);
+        return true;
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+        SmallIntToFloat<TINYGLTF_COMPONENT_TYPE_BYTE>(src, srcStride, count, n, scale, lo, dst, dstStride);
+        return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        SmallIntToFloat<TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT>(src, srcStride, count, n, scale, lo, dst, dstStride);
+        return true;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+        SmallIntToFloat<TINYGLTF_COMPONENT_TYPE_SHORT>(src, srcStride, count, n, scale, lo, dst, dstStride);
+        return true;
+    }
+#endif
+    return false;
+}
+
+static bool ConvertFast(
+    const AccessorSource&, const unsigned char*, size_t,
+    size_t, int, int, float, float,
+    unsigned short*, unsigned char*, size_t)
+{
+    return false;
+}
+
+static bool ConvertFast(
+    const AccessorSource& s, const unsigned char* src, size_t srcStride,
+    size_t count, int n, int components, float, float,
+    unsigned int*, unsigned char* dst, size_t dstStride)
+{
+#if defined(ACCESSOR_VIEW_SSE2)
+    // Index buffers
+    if (n != 1 || components != 1 || dstStride != sizeof(unsigned int))
+        return false;
+
+    unsigned int* out = reinterpret_cast<unsigned int*>(dst);
+    if (s.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE && srcStride == 1)
+    {
+        WidenIndices8(src, count, out);
+        return true;
+    }
+    if (s.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT && srcStride == 2)
+    {
+        WidenIndices16(src, count, out);
+        return true;
+    }
+#endif
+    return false;
+}
+
+// ---- Dispatch ----
+
+// Runs of `rows` contiguous source scalars: a whole vector, or one
+// matrix column
+template <typename Out>
+static void ConvertRows(
+    const AccessorSource& s,
+    const unsigned char* src, size_t srcStride,
+    size_t count, int rows, int components,
+    unsigned char* dst, size_t dstStride)
+{
+    const int n = std::min(rows, components);
+
+    if (s.componentType == NativeType(static_cast<Out*>(nullptr)) &&
+        n == components && !s.normalized)
+    {
+        CopyRun(src, srcStride, count, n * sizeof(Out), dst, dstStride);
+        return;
+    }
+
+    // Normalized integers map to [0, 1], signed ones clamp at -1
+    float scale = 1.0f;
+    float lo = -std::numeric_limits<float>::infinity();
+    if (s.normalized)
+    {
+        switch (s.componentType)
+        {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:  scale = 1.0f / 255.0f; break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: scale = 1.0f / 65535.0f; break;
+        case TINYGLTF_COMPONENT_TYPE_BYTE:           scale = 1.0f / 127.0f; lo = -1.0f; break;
+        case TINYGLTF_COMPONENT_TYPE_SHORT:          scale = 1.0f / 32767.0f; lo = -1.0f; break;
+        }
+    }
+
+    if (ConvertFast(s, src, srcStride, count, n, components, scale, lo,
+            static_cast<Out*>(nullptr), dst, dstStride))
+        return;
+
+    switch (s.componentType)
+    {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        ConvertRun<float, Out>(src, srcStride, count, n, components, scale, lo, dst, dstStride);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        ConvertRun<unsigned char, Out>(src, srcStride, count, n, components, scale, lo, dst, dstStride);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+        ConvertRun<signed char, Out>(src, srcStride, count, n, components, scale, lo, dst, dstStride);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        ConvertRun<unsigned short, Out>(src, srcStride, count, n, components, scale, lo, dst, dstStride);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+        ConvertRun<short, Out>(src, srcStride, count, n, components, scale, lo, dst, dstStride);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        ConvertRun<unsigned int, Out>(src, srcStride, count, n, components, scale, lo, dst, dstStride);
+        break;
+    default:
+        for (size_t i = 0; i < count; i++, dst += dstStride)
+            std::memset(dst, 0, components * sizeof(Out));
+        break;
+    }
+}
+
+template <typename Out>
+static void ConvertDense(
+    const AccessorSource& s,
+    const unsigned char* src, size_t srcStride,
+    size_t count, int components,
+    unsigned char* dst, size_t dstStride)
+{
+    if (!src)
+    {
+        for (size_t i = 0; i < count; i++, dst += dstStride)
+            std::memset(dst, 0, components * sizeof(Out));
+        return;
+    }
+
+    if (s.columns == 1)
+    {
+        ConvertRows<Out>(s, src, srcStride, count, s.components, components, dst, dstStride);
+        return;
+    }
+
+    // Matrices column by column, skipping the column padding
+    const int rows = s.components / s.columns;
+    for (int c = 0; c < s.columns && c * rows < components; c++)
+    {
+        ConvertRows<Out>(s, src + c * s.columnStride, srcStride, count,
+            rows, std::min(rows, components - c * rows),
+            dst + c * rows * sizeof(Out), dstStride);
+    }
+
+    if (components > s.components)
+    {
+        unsigned char* tail = dst + s.components * sizeof(Out);
+        for (size_t i = 0; i < count; i++, tail += dstStride)
+            std::memset(tail, 0, (components - s.components) * sizeof(Out));
+    }
+}
+
+template <typename Out>
+static void Convert(
+    const AccessorSource& s,
+    size_t first,
+    size_t count,
+    int components,
+    Out* out,
+    size_t dstStride)
+{
+    if (first >= s.count)
+        return;
+    count = std::min(count, s.count - first);
+
+    unsigned char* dst = reinterpret_cast<unsigned char*>(out);
+    const unsigned char* src = s.data ? s.data + first * s.stride : nullptr;
+    ConvertDense<Out>(s, src, s.stride, count, components, dst, dstStride);
+
+    if (s.sparseCount == 0)
+        return;
+
+    // First substituted element at or after `first`
+    size_t lo = 0;
+    size_t hi = s.sparseCount;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (SparseIndex(s, mid) < first)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    const size_t valueSize = s.columns * s.columnStride;
+
+    for (size_t k = lo; k < s.sparseCount; k++)
+    {
+        size_t index = SparseIndex(s, k);
+        if (index >= first + count)
+            break;
+        ConvertDense<Out>(s, s.sparseValues + k * valueSize, valueSize, 1,
+            components, dst + (index - first) * dstStride, dstStride);
+    }
+}
+
+void ConvertAccessor(
+    const AccessorSource& src, size_t first, size_t count,
+    int components, float* dst, size_t dstStride)
+{
+    Convert(src, first, count, components, dst, dstStride);
+}
+
+void ConvertAccessor(
+    const AccessorSource& src, size_t first, size_t count,
+    int components, unsigned short* dst, size_t dstStride)
+{
+    Convert(src, first, count, components, dst, dstStride);
+}
+
+void ConvertAccessor(
+    const AccessorSource& src, size_t first, size_t count,
+    int components, unsigned int* dst, size_t dstStride)
+{
+    Convert(src, first, count, components, dst, dstStride);
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <gl/glm/glm.hpp>
+#include <gl/glm/gtc/type_precision.hpp>
+
+#include <tinygltf-release/tiny_gltf.h>
+
+/* =========================
+   Accessor Source
+   ========================= */
+
+// Where the elements of one accessor live, resolved once. Views never
+// copy or own buffer data, so the model must outlive them.
+struct AccessorSource
+{
+    const unsigned char* data = nullptr;    // element 0, null: all zeros
+    size_t stride = 0;                      // bytes between elements
+    size_t count = 0;
+
+    int componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+    int components = 0;                     // of the accessor's type
+    bool normalized = false;
+
+    // Matrices are read column by column; glTF pads each column of
+    // 1- and 2-byte components to a 4-byte boundary
+    int columns = 1;
+    size_t columnStride = 0;                // bytes between columns
+
+    // Sparse substitution: ascending element indices, tightly packed values
+    size_t sparseCount = 0;
+    int sparseIndexType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+    const unsigned char* sparseIndices = nullptr;
+    const unsigned char* sparseValues = nullptr;
+};
+
+// Validates the accessor against its buffer views. On failure prints
+// why and leaves out empty.
+bool MakeAccessorSource(
+    const tinygltf::Model& model,
+    const tinygltf::Accessor& accessor,
+    AccessorSource& out);
+
+// ---- Bulk conversion ----
+// Converts elements [first, first + count) to `components` scalars each,
+// element i going to the bytes at dst + i * dstStride. Components the
+// accessor lacks are zero, extra ones are dropped. Normalized integers
+// become [0, 1] or [-1, 1] floats; the integer outputs keep raw values.
+// Sparse values are substituted.
+
+void ConvertAccessor(
+    const AccessorSource& src,
+    size_t first,
+    size_t count,
+    int components,
+    float* dst,
+    size_t dstStride);
+
+void ConvertAccessor(
+    const AccessorSource& src,
+    size_t first,
+    size_t count,
+    int components,
+    unsigned short* dst,
+    size_t dstStride);
+
+void ConvertAccessor(
+    const AccessorSource& src,
+    size_t first,
+    size_t count,
+    int components,
+    unsigned int* dst,
+    size_t dstStride);
+
+/* =========================
+   Accessor View
+   ========================= */
+
+// Scalar type and count of each element type a view can produce
+template <typename T> struct AccessorElement;
+
+template <> struct AccessorElement<float>        { using Scalar = float;          static const int components = 1; };
+template <> struct AccessorElement<glm::vec2>    { using Scalar = float;          static const int components = 2; };
+template <> struct AccessorElement<glm::vec3>    { using Scalar = float;          static const int components = 3; };
+template <> struct AccessorElement<glm::vec4>    { using Scalar = float;          static const int components = 4; };
+template <> struct AccessorElement<glm::mat4>    { using Scalar = float;          static const int components = 16; };
+template <> struct AccessorElement<glm::u16vec4> { using Scalar = unsigned short; static const int components = 4; };
+template <> struct AccessorElement<unsigned int> { using Scalar = unsigned int;   static const int components = 1; };
+
+// Typed, zero-copy window on an accessor. Elements are converted on
+// read, either one at a time or in bulk into caller memory.
+template <typename T>
+struct AccessorView
+{
+    using Scalar = typename AccessorElement<T>::Scalar;
+    static const int components = AccessorElement<T>::components;
+
+    static_assert(sizeof(T) == components * sizeof(Scalar),
+        "view elements must be tightly packed scalars");
+
+    AccessorSource source;
+
+    AccessorView() = default;
+
+    AccessorView(const tinygltf::Model& model, const tinygltf::Accessor& accessor)
+    {
+        MakeAccessorSource(model, accessor, source);
+    }
+
+    size_t Size() const { return source.count; }
+    bool Empty() const { return source.count == 0; }
+
+    // Random access; prefer Read for runs of elements
+    T operator[](size_t i) const
+    {
+        T value;
+        Read(i, 1, &value);
+        return value;
+    }
+
+    // dstStride 0: elements packed back to back
+    void Read(size_t first, size_t count, T* dst, size_t dstStride = 0) const
+    {
+        ConvertAccessor(source, first, count, components,
+            reinterpret_cast<Scalar*>(dst), dstStride ? dstStride : sizeof(T));
+    }
+
+    std::vector<T> ToVector() const
+    {
+        std::vector<T> out(source.count);
+        if (!out.empty())
+            Read(0, out.size(), out.data());
+        return out;
+    }
+};
@@ -0,0 +1,133 @@
+// Checks for AccessorView conversions on hand-built accessors.
+// Not part of the viewer build (excluded in the .vcxproj); build it on
+// its own, e.g.
+//   cl /EHsc /I. accessor_view_test.cpp accessor_view.cpp tinygltf_impl.cpp
+//   g++ -I<include dir with gl/glm> -I. accessor_view_test.cpp accessor_view.cpp tinygltf_impl.cpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "accessor_view.h"
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+    if (!ok)
+    {
+        std::printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static bool Near(float a, float b)
+{
+    return std::fabs(a - b) < 1e-5f;
+}
+
+// One buffer, one tightly packed view, one accessor over all of it
+static tinygltf::Model MakeModel(
+    const std::vector<unsigned char>& bytes,
+    int type, int componentType, bool normalized, size_t count)
+{
+    tinygltf::Model model;
+
+    tinygltf::Buffer buffer;
+    buffer.data = bytes;
+    model.buffers.push_back(buffer);
+
+    tinygltf::BufferView view;
+    view.buffer = 0;
+    view.byteLength = bytes.size();
+    model.bufferViews.push_back(view);
+
+    tinygltf::Accessor accessor;
+    accessor.bufferView = 0;
+    accessor.type = type;
+    accessor.componentType = componentType;
+    accessor.normalized = normalized;
+    accessor.count = count;
+    model.accessors.push_back(accessor);
+
+    return model;
+}
+
+/* =========================
+   Cases
+   ========================= */
+
+// Four-component short columns need no padding
+static void TestMat4ShortNormalized()
+{
+    const size_t count = 3;
+    std::vector<short> values(count * 16);
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = static_cast<short>((i % 2 ? -1 : 1) * static_cast<int>(i * 500));
+    values[5] = -32768;
+
+    std::vector<unsigned char> bytes(values.size() * sizeof(short));
+    std::memcpy(bytes.data(), values.data(), bytes.size());
+
+    tinygltf::Model model = MakeModel(bytes, TINYGLTF_TYPE_MAT4,
+        TINYGLTF_COMPONENT_TYPE_SHORT, true, count);
+
+    std::vector<glm::mat4> out =
+        AccessorView<glm::mat4>(model, model.accessors[0]).ToVector();
+    Check(out.size() == count, "mat4/short count");
+
+    for (size_t m = 0; m < out.size(); m++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            for (int r = 0; r < 4; r++)
+            {
+                float expected = std::max(values[m * 16 + c * 4 + r] / 32767.0f, -1.0f);
+                Check(Near(out[m][c][r], expected), "mat4/short normalized value");
+            }
+        }
+    }
+}
+
+// Three-byte columns are each padded to four bytes
+static void TestMat3BytePadding()
+{
+    const size_t count = 2;
+    std::vector<unsigned char> bytes(count * 12, 0xEE);
+    for (size_t m = 0; m < count; m++)
+        for (int c = 0; c < 3; c++)
+            for (int r = 0; r < 3; r++)
+                bytes[m * 12 + c * 4 + r] = static_cast<unsigned char>(m * 9 + c * 3 + r);
+
+    tinygltf::Model model = MakeModel(bytes, TINYGLTF_TYPE_MAT3,
+        TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, false, count);
+
+    std::vector<glm::mat4> out =
+        AccessorView<glm::mat4>(model, model.accessors[0]).ToVector();
+    Check(out.size() == count, "mat3/byte count");
+
+    for (size_t m = 0; m < out.size(); m++)
+    {
+        const float* f = &out[m][0][0];
+        for (int i = 0; i < 9; i++)
+            Check(Near(f[i], static_cast<float>(m * 9 + i)), "mat3/byte skips column padding");
+        for (int i = 9; i < 16; i++)
+            Check(f[i] == 0.0f, "mat3/byte zero tail");
+    }
+}
+
+int main()
+{
+    TestMat4ShortNormalized();
+    TestMat3BytePadding();
+
+    if (failures)
+    {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("all accessor view checks passed\n");
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include "crowd.h"
+
+#include <cmath>
+
+#include <gl/glm/gtc/matrix_transform.hpp>
+#include <gl/glm/gtc/type_ptr.hpp>
+
+/* =========================
+   Setup
+   ========================= */
+
+void InitCrowd(
+    Crowd& crowd,
+    size_t count,
+    const NodeHierarchy& prototype,
+    const Skin& skin,
+    const AnimLibrary& lib,
+    int clip,
+    float spacing)
+{
+    crowd.instances.assign(count, CrowdInstance());
+    crowd.jointCount = skin.jointSlots.size();
+    crowd.stride = crowd.jointCount + 1;
+
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    float half = (side - 1) * spacing * 0.5f;
+
+    float duration = clip >= 0 && clip < lib.clips.size() ?
+        lib.clips[clip].duration : 0.0f;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        CrowdInstance& inst = crowd.instances[i];
+
+        float x = (i % side) * spacing - half;
+        float z = (i / side) * spacing - half;
+        inst.world = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+
+        inst.hierarchy = prototype;
+
+        if (clip >= 0)
+        {
+            // Golden-ratio phases keep neighbours out of sync
+            float phase = std::fmod(i * 0.618034f, 1.0f);
+
+            int layer = PlayClip(inst.mixer, clip);
+            inst.mixer.layers[layer].time = phase * duration;
+            inst.mixer.layers[layer].speed = 0.9f + 0.2f * phase;
+        }
+    }
+}
+
+bool InitCrowdGL(Crowd& crowd, GLuint program)
+{
+    crowd.program = program;
+    crowd.uViewProj = glGetUniformLocation(program, "uViewProj");
+    crowd.uPalettes = glGetUniformLocation(program, "uPalettes");
+    crowd.uJointCount = glGetUniformLocation(program, "uJointCount");
+    crowd.uPaletteBase = glGetUniformLocation(program, "uPaletteBase");
+
+    size_t bytes = crowd.instances.size() * crowd.stride * sizeof(glm::mat4);
+
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if (bytes * kPaletteRegions / 16 > static_cast<size_t>(maxTexels))
+    {
+        std::cerr << "Crowd palette exceeds GL_MAX_TEXTURE_BUFFER_SIZE ("
+            << maxTexels << " texels)\n";
+        return false;
+    }
+
+    if (!InitPaletteStream(crowd.stream, GL_TEXTURE_BUFFER, bytes, sizeof(glm::mat4)))
+        return false;
+
+    // One texture spans the whole ring; uPaletteBase selects the region
+    glGenTextures(1, &crowd.texture);
+    glBindTexture(GL_TEXTURE_BUFFER, crowd.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, crowd.stream.buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    return crowd.uPalettes >= 0;
+}
+
+void DestroyCrowdGL(Crowd& crowd)
+{
+    if (crowd.texture)
+        glDeleteTextures(1, &crowd.texture);
+    DestroyPaletteStream(crowd.stream);
+
+    crowd.texture = 0;
+    crowd.writeRegion = -1;
+    crowd.readRegion = -1;
+}
+
+/* =========================
+   Update
+   ========================= */
+
+static void UpdateCrowdRange(
+    Crowd& crowd,
+    const AnimLibrary& lib,
+    const Pose& bind,
+    const Skin& skin,
+    float dt,
+    size_t begin,
+    size_t end,
+    unsigned worker)
+{
+    const SkinKernels& kernels = GetSkinKernels();
+    Pose& scratch = crowd.scratch[worker];
+    glm::mat4* palettes = PaletteRegionData(crowd.stream, crowd.writeRegion);
+
+    for (size_t i = begin; i < end; i++)
+    {
+        CrowdInstance& inst = crowd.instances[i];
+
+        UpdateMixer(inst.mixer, dt);
+        EvaluateMixer(lib, inst.mixer, bind, scratch);
+        ApplyPose(scratch, inst.hierarchy);
+        UpdateHierarchy(inst.hierarchy);
+
+        glm::mat4* dst = palettes + i * crowd.stride;
+        dst[0] = inst.world;
+
+        if (crowd.jointCount > 0)
+            kernels.buildPalette(
+                inst.hierarchy.globals.data(),
+                skin.jointSlots.data(),
+                skin.inverseBindAffine.data(),
+                crowd.jointCount,
+                dst + 1);
+    }
+}
+
+void UpdateCrowd(
+    Crowd& crowd,
+    const AnimLibrary& lib,
+    const Pose& bind,
+    const Skin& skin,
+    float dt)
+{
+    if (crowd.scratch.empty())
+        crowd.scratch.resize(1);
+
+    crowd.writeRegion = AcquirePaletteRegion(crowd.stream);
+    UpdateCrowdRange(crowd, lib, bind, skin, dt, 0, crowd.instances.size(), 0);
+
+    crowd.readRegion = crowd.writeRegion;
+    crowd.writeRegion = -1;
+}
+
+void KickCrowdUpdate(
+    Crowd& crowd,
+    JobSystem& jobs,
+    const AnimLibrary& lib,
+    const Pose& bind,
+    const Skin& skin,
+    float dt)
+{
+    if (crowd.inFlight)
+        SyncCrowdUpdate(crowd, jobs);
+
+    if (crowd.scratch.size() < jobs.ThreadCount())
+        crowd.scratch.resize(jobs.ThreadCount());
+
+    crowd.job = [&crowd, &lib, &bind, &skin, dt](size_t begin, size_t end, unsigned worker)
+    {
+        UpdateCrowdRange(crowd, lib, bind, skin, dt, begin, end, worker);
+    };
+
+    crowd.writeRegion = AcquirePaletteRegion(crowd.stream);
+
+    // A few chunks per thread so stealing can even out the load
+    size_t grain = crowd.instances.size() / (jobs.ThreadCount() * 4) + 1;
+
+    jobs.Run(crowd.pending, crowd.instances.size(), grain, crowd.job);
+    crowd.inFlight = true;
+}
+
+void SyncCrowdUpdate(Crowd& crowd, JobSystem& jobs)
+{
+    if (!crowd.inFlight)
+        return;
+
+    jobs.Wait(crowd.pending);
+    crowd.readRegion = crowd.writeRegion;
+    crowd.writeRegion = -1;
+    crowd.inFlight = false;
+}
+
+/* =========================
+   Draw
+   ========================= */
+
+void DrawCrowd(
+    Crowd& crowd,
+    const Mesh& mesh,
+    const glm::mat4& viewProj)
+{
+    if (crowd.instances.empty() || crowd.readRegion < 0 ||
+        mesh.vao == 0 || mesh.indexCount <= 0)
+        return;
+
+    size_t bytes = crowd.instances.size() * crowd.stride * sizeof(glm::mat4);
+    CommitPaletteRegion(crowd.stream, crowd.readRegion, bytes);
+
+    glUseProgram(crowd.program);
+    glUniformMatrix4fv(crowd.uViewProj, 1, GL_FALSE, glm::value_ptr(viewProj));
+    glUniform1i(crowd.uJointCount, static_cast<GLint>(crowd.jointCount));
+    glUniform1i(crowd.uPaletteBase, static_cast<GLint>(
+        PaletteRegionOffset(crowd.stream, crowd.readRegion) / 16));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, crowd.texture);
+    glUniform1i(crowd.uPalettes, 0);
+
+    glBindVertexArray(mesh.vao);
+    glDrawElementsInstancedBaseVertex(
+        GL_TRIANGLES,
+        mesh.indexCount,
+        GL_UNSIGNED_INT,
+        (void*)(mesh.firstIndex * sizeof(unsigned int)),
+        static_cast<GLsizei>(crowd.instances.size()),
+        mesh.baseVertex);
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    FencePaletteRegion(crowd.stream, crowd.readRegion);
+}
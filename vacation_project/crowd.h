@@ -0,0 +1,90 @@
+#pragma once
+
+#include "loader.h"
+#include "job_system.h"
+#include "palette_stream.h"
+
+/* =========================
+   Crowd
+   ========================= */
+
+// Many copies of one skinned mesh, each with its own animation state.
+// All palettes are packed into one region of a palette stream, read
+// through a texture buffer and drawn with a single instanced call.
+// Jobs fill the next frame's region while the render thread draws the
+// current one.
+
+struct CrowdInstance
+{
+    glm::mat4 world = glm::mat4(1.0f);
+    AnimMixer mixer;
+    NodeHierarchy hierarchy;
+};
+
+struct Crowd
+{
+    std::vector<CrowdInstance> instances;
+
+    size_t jointCount = 0;
+    size_t stride = 0;                  // mat4s per instance: world + joints
+
+    PaletteStream stream;               // regions of instances * stride mat4s
+    int writeRegion = -1;               // being filled by the update
+    int readRegion = -1;                // ready to draw
+
+    std::vector<Pose> scratch;          // one per job thread
+
+    JobSystem::JobFn job;
+    JobCounter pending;
+    bool inFlight = false;
+
+    GLuint program = 0;
+    GLuint texture = 0;
+    GLint uViewProj = -1;
+    GLint uPalettes = -1;
+    GLint uJointCount = -1;
+    GLint uPaletteBase = -1;
+};
+
+// Lays instances out on a grid; each starts the clip at its own phase.
+void InitCrowd(
+    Crowd& crowd,
+    size_t count,
+    const NodeHierarchy& prototype,
+    const Skin& skin,
+    const AnimLibrary& lib,
+    int clip,
+    float spacing);
+
+bool InitCrowdGL(Crowd& crowd, GLuint program);
+
+// Batched CPU pass: mixer -> pose -> hierarchy -> palette per instance,
+// written straight into the next stream region, which becomes the one
+// drawn. Requires InitCrowdGL.
+void UpdateCrowd(
+    Crowd& crowd,
+    const AnimLibrary& lib,
+    const Pose& bind,
+    const Skin& skin,
+    float dt);
+
+// Queues the same pass on the job system without blocking. lib, bind
+// and skin must outlive the update.
+void KickCrowdUpdate(
+    Crowd& crowd,
+    JobSystem& jobs,
+    const AnimLibrary& lib,
+    const Pose& bind,
+    const Skin& skin,
+    float dt);
+
+// The per-frame hand-off: waits for the kicked update (helping run its
+// jobs) and makes its region the one drawn.
+void SyncCrowdUpdate(Crowd& crowd, JobSystem& jobs);
+
+void DrawCrowd(
+    Crowd& crowd,
+    const Mesh& mesh,
+    const glm::mat4& viewProj);
+
+void DestroyCrowdGL(Crowd& crowd);
@@ -0,0 +1,86 @@
+#version 330 core
+
+/* =========================
+   Attributes (glTF)
+   ========================= */
+
+layout(location = 0) in vec3  aPos;       // POSITION
+layout(location = 1) in vec2  aNormalOct; // NORMAL, octahedral snorm16
+layout(location = 2) in uvec4 aJoints;    // JOINTS_0
+layout(location = 3) in vec4  aWeights;   // WEIGHTS_0
+layout(location = 4) in vec2  aTexCoord;  // TEXCOORD_0
+
+/* =========================
+   Uniforms
+   ========================= */
+
+uniform mat4 uViewProj;
+
+// Per instance: world matrix, then uJointCount joint matrices.
+// Every mat4 is four RGBA32F texels (columns). uPaletteBase is the
+// first texel of this frame's region in the palette ring.
+uniform samplerBuffer uPalettes;
+uniform int uPaletteBase;
+uniform int uJointCount;
+
+/* =========================
+   Outputs
+   ========================= */
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoord;
+
+/* =========================
+   Helpers
+   ========================= */
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+mat4 FetchMatrix(int index)
+{
+    int base = uPaletteBase + index * 4;
+    return mat4(
+        texelFetch(uPalettes, base + 0),
+        texelFetch(uPalettes, base + 1),
+        texelFetch(uPalettes, base + 2),
+        texelFetch(uPalettes, base + 3));
+}
+
+/* =========================
+   Main
+   ========================= */
+
+void main()
+{
+    int first = gl_InstanceID * (uJointCount + 1);
+    mat4 world = FetchMatrix(first);
+
+    /* ---- Skinning ---- */
+    mat4 skinMat = mat4(1.0);
+    if (uJointCount > 0)
+    {
+        skinMat =
+            aWeights.x * FetchMatrix(first + 1 + int(aJoints.x)) +
+            aWeights.y * FetchMatrix(first + 1 + int(aJoints.y)) +
+            aWeights.z * FetchMatrix(first + 1 + int(aJoints.z)) +
+            aWeights.w * FetchMatrix(first + 1 + int(aJoints.w));
+    }
+
+    vec4 worldPos = world * (skinMat * vec4(aPos, 1.0));
+    vec3 worldNorm = mat3(world) * (mat3(skinMat) * OctDecode(aNormalOct));
+
+    /* ---- Outputs ---- */
+    gl_Position = uViewProj * worldPos;
+
+    FragPos = vec3(worldPos);
+    Normal = worldNorm;
+    TexCoord = aTexCoord;
+}
@@ -0,0 +1,150 @@
+#include "job_system.h"
+
+#include <algorithm>
+
+/* =========================
+   Lifetime
+   ========================= */
+
+JobSystem::JobSystem(unsigned workers)
+{
+    if (workers == 0)
+    {
+        unsigned hw = std::thread::hardware_concurrency();
+        workers = hw > 1 ? hw - 1 : 0;
+    }
+
+    // Queue 0 belongs to the external (render) thread
+    for (unsigned i = 0; i <= workers; i++)
+        queues.emplace_back(new Queue());
+
+    for (unsigned i = 1; i <= workers; i++)
+        threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quit.store(true);
+    }
+    wake.notify_all();
+
+    for (auto& t : threads)
+        t.join();
+}
+
+/* =========================
+   Submission
+   ========================= */
+
+void JobSystem::Run(JobCounter& counter, size_t count, size_t grain, const JobFn& fn)
+{
+    if (count == 0)
+        return;
+
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (count + grain - 1) / grain;
+    counter.pending.fetch_add(static_cast<int>(chunks), std::memory_order_relaxed);
+
+    // Round-robin the chunks so every deque starts with work
+    unsigned qcount = static_cast<unsigned>(queues.size());
+    for (size_t c = 0; c < chunks; c++)
+    {
+        Job job;
+        job.fn = &fn;
+        job.begin = c * grain;
+        job.end = std::min(count, job.begin + grain);
+        job.counter = &counter;
+
+        Queue& q = *queues[nextQueue];
+        nextQueue = (nextQueue + 1) % qcount;
+
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.jobs.push_back(job);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued.fetch_add(static_cast<int>(chunks));
+    }
+    wake.notify_all();
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    Job job;
+    while (!counter.Done())
+    {
+        if (Pop(0, job) || Steal(0, job))
+            Execute(job, 0);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const JobFn& fn)
+{
+    JobCounter counter;
+    Run(counter, count, grain, fn);
+    Wait(counter);
+}
+
+/* =========================
+   Workers
+   ========================= */
+
+bool JobSystem::Pop(unsigned queue, Job& job)
+{
+    Queue& q = *queues[queue];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.jobs.empty())
+        return false;
+
+    job = q.jobs.back();
+    q.jobs.pop_back();
+    queued.fetch_sub(1);
+    return true;
+}
+
+bool JobSystem::Steal(unsigned thief, Job& job)
+{
+    unsigned qcount = static_cast<unsigned>(queues.size());
+    for (unsigned i = 1; i < qcount; i++)
+    {
+        Queue& q = *queues[(thief + i) % qcount];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.jobs.empty())
+            continue;
+
+        job = q.jobs.front();
+        q.jobs.pop_front();
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::Execute(const Job& job, unsigned worker)
+{
+    (*job.fn)(job.begin, job.end, worker);
+    job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::WorkerLoop(unsigned index)
+{
+    Job job;
+    for (;;)
+    {
+        if (Pop(index, job) || Steal(index, job))
+        {
+            Execute(job, index);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return quit.load() || queued.load() > 0; });
+        if (quit.load())
+            return;
+    }
+}
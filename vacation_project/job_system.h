@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* =========================
+   Job System
+   ========================= */
+
+// Tracks the outstanding chunks of one Run() call.
+struct JobCounter
+{
+    std::atomic<int> pending{ 0 };
+
+    bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Fixed pool of worker threads, one job deque per thread. Owners pop
+// from the back of their own deque; idle threads steal from the front
+// of the others. The thread that calls Wait() helps run jobs and uses
+// worker index 0; pool threads are 1..WorkerCount().
+class JobSystem
+{
+public:
+    // fn(begin, end, worker) processes items [begin, end)
+    using JobFn = std::function<void(size_t, size_t, unsigned)>;
+
+    // 0 = one worker per hardware thread, minus the calling thread
+    explicit JobSystem(unsigned workers = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned WorkerCount() const { return static_cast<unsigned>(threads.size()); }
+    unsigned ThreadCount() const { return WorkerCount() + 1; }
+
+    // Splits [0, count) into chunks of at most grain items and queues
+    // them without blocking. fn must stay alive until Wait() returns.
+    void Run(JobCounter& counter, size_t count, size_t grain, const JobFn& fn);
+
+    // Runs queued jobs on the calling thread until counter is done.
+    void Wait(JobCounter& counter);
+
+    void ParallelFor(size_t count, size_t grain, const JobFn& fn);
+
+private:
+    struct Job
+    {
+        const JobFn* fn = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+        JobCounter* counter = nullptr;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    bool Pop(unsigned queue, Job& job);
+    bool Steal(unsigned thief, Job& job);
+    void Execute(const Job& job, unsigned worker);
+    void WorkerLoop(unsigned index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<int> queued{ 0 };
+    std::atomic<bool> quit{ false };
+    unsigned nextQueue = 0;
+};
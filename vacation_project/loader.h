@@ -8,11 +8,16 @@
 
 #include <gl/glew.h>
 #include <gl/glm/glm.hpp>
+#include <gl/glm/gtc/matrix_transform.hpp>
 #include <gl/glm/gtc/quaternion.hpp>
+#include <gl/glm/gtc/type_precision.hpp>
 #include <gl/glm/gtc/type_ptr.hpp>
 
 #include <tinygltf-release/tiny_gltf.h>
 
+#include "accessor_view.h"
+#include "skin_kernels.h"
+
 /* =========================
    Mesh
    ========================= */
@@ -23,6 +28,8 @@ struct Mesh
     unsigned int vbo = 0;
     unsigned int ebo = 0;
     int indexCount = 0;
+    int firstIndex = 0;         // into a shared index buffer
+    int baseVertex = 0;
 };
 
 /* =========================
@@ -42,6 +49,31 @@ struct Node
     glm::mat4 globalMatrix = glm::mat4(1.0f);
 };
 
+/* =========================
+   Node Hierarchy
+   ========================= */
+
+// Flattened, topologically sorted copy of the node tree. Everything is
+// indexed by slot; parents[i] < i, so one forward pass updates all
+// globals. Only dirty slots (and descendants of moved slots) recompute.
+struct NodeHierarchy
+{
+    std::vector<int> nodeOf;        // slot -> glTF node index
+    std::vector<int> slotOf;        // glTF node index -> slot, -1 if unreachable
+    std::vector<int> parents;       // parent slot, -1 for roots
+
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+
+    std::vector<Affine> locals;
+    std::vector<Affine> globals;
+
+    std::vector<unsigned char> dirty;   // local TRS changed since last update
+    std::vector<unsigned char> moved;   // global recomputed in last update
+    std::vector<int> dirtySlots;        // scratch for the batched TRS kernel
+};
+
 /* =========================
    Skin
    ========================= */
@@ -50,37 +82,118 @@ struct Skin
 {
     std::vector<int> joints;
     std::vector<glm::mat4> inverseBind;
+
+    // Kernel-ready copies, filled by LoadSkin
+    std::vector<Affine> inverseBindAffine;
+    std::vector<int> jointSlots;        // hierarchy slot per joint
 };
 
 /* =========================
    Animation
    ========================= */
 
-struct AnimSampler
+enum class AnimPath { T, R, S };
+
+struct AnimTimeline
 {
+    int input = -1;                 // source accessor index
     std::vector<float> times;
-    std::vector<glm::vec4> values;
 };
 
-struct AnimChannel
+// One animated property of one node. Values are tightly packed;
+// CUBICSPLINE tracks store (in-tangent, value, out-tangent) per key.
+template <typename T>
+struct AnimTrack
 {
-    int sampler;
-    int node;
-    enum Path { T, R, S } path;
+    int node = -1;
+    int timeline = 0;
+    std::vector<T> values;
+};
+
+// Tracks bucketed by interpolation so each bucket runs its own
+// evaluator loop without per-key mode checks.
+template <typename T>
+struct AnimTrackSet
+{
+    std::vector<AnimTrack<T>> linear;
+    std::vector<AnimTrack<T>> step;
+    std::vector<AnimTrack<T>> cubic;
+
+    size_t size() const { return linear.size() + step.size() + cubic.size(); }
 };
 
 struct Animation
 {
     std::string name;
     float duration = 0.0f;
-    std::vector<AnimSampler> samplers;
-    std::vector<AnimChannel> channels;
+    std::vector<AnimTimeline> timelines;
+
+    AnimTrackSet<glm::vec3> translations;
+    AnimTrackSet<glm::quat> rotations;
+    AnimTrackSet<glm::vec3> scales;
+
+    bool empty() const
+    {
+        return translations.size() + rotations.size() + scales.size() == 0;
+    }
+};
+
+// Per-playback keyframe cursor, one entry per timeline.
+// Tracks sharing an input accessor share one lookup per frame.
+struct AnimCursor
+{
+    std::vector<int> keys;
+    std::vector<float> alphas;
+};
+
+struct AnimLibrary
+{
+    std::vector<Animation> clips;
+
+    int Find(const std::string& clipName) const;
+};
+
+/* =========================
+   Pose / Mixer
+   ========================= */
+
+// SoA local transforms for every node. Mixer layers blend straight
+// into this buffer; weights is per node/path scratch for blending.
+struct Pose
+{
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<float> weights;
+
+    size_t size() const { return translations.size(); }
+    void Resize(size_t count);
+};
+
+struct AnimLayer
+{
+    int clip = -1;
+    float time = 0.0f;
+    float speed = 1.0f;
+    float weight = 1.0f;
+    float targetWeight = 1.0f;
+    float fadeRate = 0.0f;          // weight units per second
+    bool additive = false;          // delta against the bind pose
+    bool loop = true;
+    AnimCursor cursor;
+};
+
+struct AnimMixer
+{
+    std::vector<AnimLayer> layers;
 };
 
 /* =========================
    Accessor Readers
    ========================= */
 
+// Whole accessors copied into new vectors. Mesh data should go through
+// AccessorView (accessor_view.h) and convert into its destination.
 std::vector<float> ReadFloatAccessor(
     const tinygltf::Model&,
     const tinygltf::Accessor&);
@@ -101,13 +214,54 @@ std::vector<glm::mat4> ReadMat4Accessor(
    Animation Helpers
    ========================= */
 
+Animation LoadAnimation(const tinygltf::Model& model, int index);
 Animation LoadIdleAnimation(const tinygltf::Model& model);
+AnimLibrary LoadAnimationLibrary(const tinygltf::Model& model);
+
+int FindKeyframe(
+    const std::vector<float>& times,
+    float t,
+    int hint);
+
+void EvaluateIdle(
+    const Animation& anim,
+    float time,
+    AnimCursor& cursor,
+    std::vector<Node>& nodes);
 
 void EvaluateIdle(
     const Animation& anim,
     float time,
     std::vector<Node>& nodes);
 
+void PoseFromNodes(const std::vector<Node>& nodes, Pose& pose);
+void ApplyPose(const Pose& pose, std::vector<Node>& nodes);
+
+int PlayClip(
+    AnimMixer& mixer,
+    int clip,
+    float weight = 1.0f,
+    bool additive = false);
+
+void CrossFade(AnimMixer& mixer, int clip, float duration);
+void UpdateMixer(AnimMixer& mixer, float dt);
+
+void EvaluateMixer(
+    const AnimLibrary& lib,
+    AnimMixer& mixer,
+    const Pose& bind,
+    Pose& out);
+
+void BuildHierarchy(const std::vector<Node>& nodes, NodeHierarchy& h);
+
+Skin LoadSkin(
+    const tinygltf::Model& model,
+    int index,
+    const NodeHierarchy& h);
+
+void ApplyPose(const Pose& pose, NodeHierarchy& h);
+void UpdateHierarchy(NodeHierarchy& h);
+
 void UpdateLocal(Node& n);
 void UpdateGlobal(int idx, std::vector<Node>& nodes);
 
@@ -116,8 +270,20 @@ void BuildJointPalette(
     const std::vector<Node>& nodes,
     std::vector<glm::mat4>& out);
 
+void BuildJointPalette(
+    const Skin& skin,
+    const NodeHierarchy& h,
+    std::vector<glm::mat4>& out);
+
+// Writes skin.jointSlots.size() matrices to out (e.g. mapped memory)
+void BuildJointPalette(
+    const Skin& skin,
+    const NodeHierarchy& h,
+    glm::mat4* out);
+
 /* =========================
    Shader Utilities
    ========================= */
 
 GLuint LoadShaderProgram();
+GLuint LoadShaderProgram(const char* vertexPath, const char* fragmentPath);
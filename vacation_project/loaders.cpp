@@ -1,188 +1,606 @@
 #include "loader.h"
+#include <algorithm>
 #include <cmath>
 
 /* =========================
    Accessor Readers
    ========================= */
 
+// The readers below are views copied out whole: byteStride, normalized
+// integers, sparse accessors and missing buffer views all apply.
+
 std::vector<float> ReadFloatAccessor(
     const tinygltf::Model& model,
     const tinygltf::Accessor& accessor)
 {
-    std::vector<float> out;
-
-    const auto& view = model.bufferViews[accessor.bufferView];
-    const auto& buf = model.buffers[view.buffer];
+    return AccessorView<float>(model, accessor).ToVector();
+}
 
-    const unsigned char* data =
-        buf.data.data() + view.byteOffset + accessor.byteOffset;
+std::vector<glm::vec3> ReadVec3Accessor(
+    const tinygltf::Model& model,
+    const tinygltf::Accessor& accessor)
+{
+    return AccessorView<glm::vec3>(model, accessor).ToVector();
+}
 
-    size_t count = accessor.count;
-    size_t stride = accessor.ByteStride(view);
-    if (stride == 0) stride = sizeof(float);
+std::vector<glm::vec4> ReadVec4Accessor(
+    const tinygltf::Model& model,
+    const tinygltf::Accessor& accessor)
+{
+    return AccessorView<glm::vec4>(model, accessor).ToVector();
+}
 
-    out.resize(count);
+std::vector<glm::mat4> ReadMat4Accessor(
+    const tinygltf::Model& model,
+    const tinygltf::Accessor& accessor)
+{
+    return AccessorView<glm::mat4>(model, accessor).ToVector();
+}
 
-    for (size_t i = 0; i < count; i++)
-        out[i] = *reinterpret_cast<const float*>(data + i * stride);
+/* =========================
+   Animation
+   ========================= */
 
-    return out;
+static int FindOrAddTimeline(
+    const tinygltf::Model& model,
+    int input,
+    Animation& anim)
+{
+    // Samplers keyed by the same input accessor share one timeline
+    for (size_t i = 0; i < anim.timelines.size(); i++)
+        if (anim.timelines[i].input == input)
+            return static_cast<int>(i);
+
+    AnimTimeline timeline;
+    timeline.input = input;
+    timeline.times = ReadFloatAccessor(model, model.accessors[input]);
+    anim.timelines.push_back(timeline);
+    return static_cast<int>(anim.timelines.size()) - 1;
 }
 
-std::vector<glm::vec3> ReadVec3Accessor(
-    const tinygltf::Model& model,
-    const tinygltf::Accessor& accessor)
+template <typename T>
+static void AddTrack(
+    AnimTrackSet<T>& set,
+    const std::string& interpolation,
+    AnimTrack<T>& track)
 {
-    std::vector<glm::vec3> out;
+    if (interpolation == "STEP")
+        set.step.push_back(std::move(track));
+    else if (interpolation == "CUBICSPLINE")
+        set.cubic.push_back(std::move(track));
+    else
+        set.linear.push_back(std::move(track));
+}
 
-    const auto& view = model.bufferViews[accessor.bufferView];
-    const auto& buf = model.buffers[view.buffer];
+Animation LoadAnimation(const tinygltf::Model& model, int index)
+{
+    Animation anim;
 
-    const unsigned char* data =
-        buf.data.data() + view.byteOffset + accessor.byteOffset;
+    if (index < 0 || index >= model.animations.size())
+        return anim;
 
-    out.resize(accessor.count);
+    const auto& src = model.animations[index];
+    anim.name = src.name;
 
-    for (size_t i = 0; i < accessor.count; i++)
+    for (const auto& c : src.channels)
     {
-        const float* p =
-            reinterpret_cast<const float*>(data + i * sizeof(float) * 3);
-        out[i] = glm::vec3(p[0], p[1], p[2]);
+        if (c.sampler < 0 || c.sampler >= src.samplers.size())
+            continue;
+        if (c.target_node < 0 || c.target_node >= model.nodes.size())
+            continue;
+
+        const auto& s = src.samplers[c.sampler];
+        const auto& output = model.accessors[s.output];
+        int timeline = FindOrAddTimeline(model, s.input, anim);
+
+        size_t keys = anim.timelines[timeline].times.size();
+        size_t expected = s.interpolation == "CUBICSPLINE" ? keys * 3 : keys;
+        if (keys == 0 || output.count < expected)
+        {
+            std::cerr << "Animation sampler output too short, skipping channel\n";
+            continue;
+        }
+
+        if (c.target_path == "translation" || c.target_path == "scale")
+        {
+            AnimTrack<glm::vec3> track;
+            track.node = c.target_node;
+            track.timeline = timeline;
+            track.values = ReadVec3Accessor(model, output);
+
+            AddTrack(c.target_path == "translation" ?
+                anim.translations : anim.scales, s.interpolation, track);
+        }
+        else if (c.target_path == "rotation")
+        {
+            std::vector<glm::vec4> raw = ReadVec4Accessor(model, output);
+
+            AnimTrack<glm::quat> track;
+            track.node = c.target_node;
+            track.timeline = timeline;
+            track.values.resize(raw.size());
+            for (size_t i = 0; i < raw.size(); i++)
+                track.values[i] = glm::quat(raw[i].w, raw[i].x, raw[i].y, raw[i].z);
+
+            AddTrack(anim.rotations, s.interpolation, track);
+        }
     }
-    return out;
+
+    for (const auto& tl : anim.timelines)
+        if (!tl.times.empty() && tl.times.back() > anim.duration)
+            anim.duration = tl.times.back();
+
+    return anim;
 }
 
-std::vector<glm::vec4> ReadVec4Accessor(
-    const tinygltf::Model& model,
-    const tinygltf::Accessor& accessor)
+Animation LoadIdleAnimation(const tinygltf::Model& model)
+{
+    return LoadAnimation(model, 0);
+}
+
+AnimLibrary LoadAnimationLibrary(const tinygltf::Model& model)
 {
-    std::vector<glm::vec4> out;
+    AnimLibrary lib;
+    lib.clips.reserve(model.animations.size());
 
-    const auto& view = model.bufferViews[accessor.bufferView];
-    const auto& buf = model.buffers[view.buffer];
+    for (size_t i = 0; i < model.animations.size(); i++)
+        lib.clips.push_back(LoadAnimation(model, static_cast<int>(i)));
 
-    const unsigned char* data =
-        buf.data.data() + view.byteOffset + accessor.byteOffset;
+    return lib;
+}
+
+int AnimLibrary::Find(const std::string& clipName) const
+{
+    for (size_t i = 0; i < clips.size(); i++)
+        if (clips[i].name == clipName)
+            return static_cast<int>(i);
+    return -1;
+}
 
-    out.resize(accessor.count);
+// Returns i such that times[i] <= t < times[i + 1], clamped to
+// [0, size - 2]. The previous frame's key is tried first, so normal
+// playback is O(1); seeks and wrap-around fall back to a binary search.
+int FindKeyframe(
+    const std::vector<float>& times,
+    float t,
+    int hint)
+{
+    int last = static_cast<int>(times.size()) - 2;
+    if (last <= 0 || t <= times[0])
+        return 0;
+    if (t >= times[last])
+        return last;
 
-    for (size_t i = 0; i < accessor.count; i++)
+    if (hint >= 0 && hint <= last && times[hint] <= t)
     {
-        const float* p =
-            reinterpret_cast<const float*>(data + i * sizeof(float) * 4);
-        out[i] = glm::vec4(p[0], p[1], p[2], p[3]);
+        if (t < times[hint + 1])
+            return hint;
+        if (hint + 1 <= last && t < times[hint + 2])
+            return hint + 1;
     }
-    return out;
+
+    auto it = std::upper_bound(times.begin(), times.end(), t);
+    return static_cast<int>(it - times.begin()) - 1;
 }
 
-std::vector<glm::mat4> ReadMat4Accessor(
-    const tinygltf::Model& model,
-    const tinygltf::Accessor& accessor)
+static void UpdateCursor(
+    const Animation& anim,
+    float t,
+    AnimCursor& cursor)
 {
-    std::vector<glm::mat4> out;
+    cursor.keys.resize(anim.timelines.size(), 0);
+    cursor.alphas.resize(anim.timelines.size(), 0.0f);
+
+    for (size_t i = 0; i < anim.timelines.size(); i++)
+    {
+        const auto& times = anim.timelines[i].times;
+        if (times.size() < 2)
+        {
+            cursor.keys[i] = 0;
+            cursor.alphas[i] = 0.0f;
+            continue;
+        }
+
+        int k = FindKeyframe(times, t, cursor.keys[i]);
+        float a = (t - times[k]) / (times[k + 1] - times[k]);
+
+        cursor.keys[i] = k;
+        cursor.alphas[i] = glm::clamp(a, 0.0f, 1.0f);
+    }
+}
+
+/* ---- Interpolators ---- */
+
+static glm::vec3 Lerp(const glm::vec3& a, const glm::vec3& b, float t)
+{
+    return glm::mix(a, b, t);
+}
+
+static glm::quat Lerp(const glm::quat& a, const glm::quat& b, float t)
+{
+    return glm::slerp(a, b, t);
+}
 
-    const auto& view = model.bufferViews[accessor.bufferView];
-    const auto& buf = model.buffers[view.buffer];
+static glm::vec3 Finish(const glm::vec3& v) { return v; }
+static glm::quat Finish(const glm::quat& q) { return glm::normalize(q); }
 
-    const unsigned char* data =
-        buf.data.data() + view.byteOffset + accessor.byteOffset;
+/* ---- Track Evaluators ---- */
 
-    out.resize(accessor.count);
+// Evaluators hand each sampled value to a sink, which either stores it
+// on a Node or blends it into a Pose. The sink is a template argument,
+// so the write is inlined into the evaluator loop.
 
-    for (size_t i = 0; i < accessor.count; i++)
+template <typename T, typename Sink>
+static void EvaluateLinear(
+    const std::vector<AnimTrack<T>>& tracks,
+    const AnimCursor& cursor,
+    AnimPath path,
+    Sink& sink)
+{
+    for (const auto& tr : tracks)
     {
-        const float* p =
-            reinterpret_cast<const float*>(data + i * sizeof(float) * 16);
-        out[i] = glm::make_mat4(p);
+        int k = cursor.keys[tr.timeline];
+        float a = cursor.alphas[tr.timeline];
+        int k1 = glm::min(k + 1, static_cast<int>(tr.values.size()) - 1);
+
+        sink(path, tr.node, Lerp(tr.values[k], tr.values[k1], a));
     }
-    return out;
 }
 
-/* =========================
-   Animation
-   ========================= */
+template <typename T, typename Sink>
+static void EvaluateStep(
+    const std::vector<AnimTrack<T>>& tracks,
+    const AnimCursor& cursor,
+    AnimPath path,
+    Sink& sink)
+{
+    for (const auto& tr : tracks)
+    {
+        // alpha only reaches 1 past the last key
+        int k = cursor.keys[tr.timeline] +
+            static_cast<int>(cursor.alphas[tr.timeline] >= 1.0f);
+        k = glm::min(k, static_cast<int>(tr.values.size()) - 1);
 
-Animation LoadIdleAnimation(const tinygltf::Model& model)
+        sink(path, tr.node, tr.values[k]);
+    }
+}
+
+template <typename T, typename Sink>
+static void EvaluateCubic(
+    const std::vector<AnimTrack<T>>& tracks,
+    const Animation& anim,
+    const AnimCursor& cursor,
+    AnimPath path,
+    Sink& sink)
 {
-    Animation anim;
+    for (const auto& tr : tracks)
+    {
+        const auto& times = anim.timelines[tr.timeline].times;
+        if (times.size() < 2)
+        {
+            sink(path, tr.node, Finish(tr.values[1]));
+            continue;
+        }
+
+        int k = cursor.keys[tr.timeline];
+        float t = cursor.alphas[tr.timeline];
+        float dt = times[k + 1] - times[k];
+
+        float t2 = t * t;
+        float t3 = t2 * t;
+
+        // Hermite basis, glTF 2.0 spec Appendix C
+        const T& p0 = tr.values[k * 3 + 1];
+        const T& m0 = tr.values[k * 3 + 2];
+        const T& m1 = tr.values[(k + 1) * 3 + 0];
+        const T& p1 = tr.values[(k + 1) * 3 + 1];
+
+        sink(path, tr.node, Finish(
+            p0 * (2.0f * t3 - 3.0f * t2 + 1.0f) +
+            m0 * ((t3 - 2.0f * t2 + t) * dt) +
+            p1 * (-2.0f * t3 + 3.0f * t2) +
+            m1 * ((t3 - t2) * dt)));
+    }
+}
 
-    if (model.animations.empty())
-        return anim;
+template <typename T, typename Sink>
+static void EvaluateTrackSet(
+    const AnimTrackSet<T>& set,
+    const Animation& anim,
+    const AnimCursor& cursor,
+    AnimPath path,
+    Sink& sink)
+{
+    EvaluateLinear(set.linear, cursor, path, sink);
+    EvaluateStep(set.step, cursor, path, sink);
+    EvaluateCubic(set.cubic, anim, cursor, path, sink);
+}
 
-    const auto& src = model.animations[0];
-    anim.name = src.name;
+template <typename Sink>
+static void EvaluateClip(
+    const Animation& anim,
+    float time,
+    bool loop,
+    AnimCursor& cursor,
+    Sink& sink)
+{
+    float t = loop ?
+        fmod(time, anim.duration) :
+        glm::clamp(time, 0.0f, anim.duration);
+    if (t < 0.0f)
+        t += anim.duration;
+
+    UpdateCursor(anim, t, cursor);
+
+    EvaluateTrackSet(anim.translations, anim, cursor, AnimPath::T, sink);
+    EvaluateTrackSet(anim.rotations, anim, cursor, AnimPath::R, sink);
+    EvaluateTrackSet(anim.scales, anim, cursor, AnimPath::S, sink);
+}
+
+/* ---- Sinks ---- */
 
-    for (const auto& s : src.samplers)
+struct NodeSink
+{
+    std::vector<Node>& nodes;
+
+    void operator()(AnimPath path, int node, const glm::vec3& v)
     {
-        AnimSampler sp;
-        sp.times = ReadFloatAccessor(model, model.accessors[s.input]);
-        sp.values = ReadVec4Accessor(model, model.accessors[s.output]);
-        anim.samplers.push_back(sp);
+        if (node >= nodes.size())
+            return;
+        if (path == AnimPath::T)
+            nodes[node].translation = v;
+        else
+            nodes[node].scale = v;
     }
 
-    for (const auto& c : src.channels)
+    void operator()(AnimPath, int node, const glm::quat& q)
     {
-        AnimChannel ch;
-        ch.sampler = c.sampler;
-        ch.node = c.target_node;
+        if (node < nodes.size())
+            nodes[node].rotation = q;
+    }
+};
 
-        if (c.target_path == "translation") ch.path = AnimChannel::T;
-        if (c.target_path == "rotation")    ch.path = AnimChannel::R;
-        if (c.target_path == "scale")       ch.path = AnimChannel::S;
+// Accumulates a normalized weighted average per node and path.
+// Pose::weights tracks how much weight each slot has received so far.
+struct BlendSink
+{
+    Pose& pose;
+    float weight;
+
+    float Accumulate(AnimPath path, int node)
+    {
+        float& acc = pose.weights[node * 3 + static_cast<int>(path)];
+        acc += weight;
+        return weight / acc;
+    }
 
-        anim.channels.push_back(ch);
+    void operator()(AnimPath path, int node, const glm::vec3& v)
+    {
+        if (node >= pose.size())
+            return;
+        glm::vec3& dst = path == AnimPath::T ?
+            pose.translations[node] : pose.scales[node];
+        dst = glm::mix(dst, v, Accumulate(path, node));
     }
 
-    if (!anim.samplers.empty() &&
-        !anim.samplers[0].times.empty())
-        anim.duration = anim.samplers[0].times.back();
+    void operator()(AnimPath path, int node, const glm::quat& q)
+    {
+        if (node >= pose.size())
+            return;
+        glm::quat& dst = pose.rotations[node];
+        dst = glm::slerp(dst, q, Accumulate(path, node));
+    }
+};
 
-    return anim;
-}
+// Applies the clip as a delta against the bind pose.
+struct AdditiveSink
+{
+    Pose& pose;
+    const Pose& bind;
+    float weight;
+
+    void operator()(AnimPath path, int node, const glm::vec3& v)
+    {
+        if (node >= pose.size())
+            return;
+        if (path == AnimPath::T)
+        {
+            pose.translations[node] += (v - bind.translations[node]) * weight;
+            return;
+        }
+
+        // Zero bind scales (hidden nodes) have no ratio; leave them at 1
+        const glm::vec3& b = bind.scales[node];
+        glm::vec3 ratio(
+            b.x != 0.0f ? v.x / b.x : 1.0f,
+            b.y != 0.0f ? v.y / b.y : 1.0f,
+            b.z != 0.0f ? v.z / b.z : 1.0f);
+        pose.scales[node] *= glm::mix(glm::vec3(1.0f), ratio, weight);
+    }
+
+    void operator()(AnimPath, int node, const glm::quat& q)
+    {
+        if (node >= pose.size())
+            return;
+        glm::quat delta = q * glm::inverse(bind.rotations[node]);
+        pose.rotations[node] = glm::normalize(
+            glm::slerp(glm::quat(1, 0, 0, 0), delta, weight) *
+            pose.rotations[node]);
+    }
+};
 
 void EvaluateIdle(
     const Animation& anim,
     float time,
+    AnimCursor& cursor,
     std::vector<Node>& nodes)
 {
-    if (anim.samplers.empty())
+    if (anim.empty() || anim.duration <= 0.0f)
         return;
 
-    float t = fmod(time, anim.duration);
+    NodeSink sink{ nodes };
+    EvaluateClip(anim, time, true, cursor, sink);
+}
+
+void EvaluateIdle(
+    const Animation& anim,
+    float time,
+    std::vector<Node>& nodes)
+{
+    AnimCursor cursor;
+    EvaluateIdle(anim, time, cursor, nodes);
+}
+
+/* =========================
+   Pose / Mixer
+   ========================= */
+
+void Pose::Resize(size_t count)
+{
+    translations.resize(count, glm::vec3(0.0f));
+    rotations.resize(count, glm::quat(1, 0, 0, 0));
+    scales.resize(count, glm::vec3(1.0f));
+    weights.resize(count * 3, 0.0f);
+}
+
+void PoseFromNodes(const std::vector<Node>& nodes, Pose& pose)
+{
+    pose.Resize(nodes.size());
+
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        pose.translations[i] = nodes[i].translation;
+        pose.rotations[i] = nodes[i].rotation;
+        pose.scales[i] = nodes[i].scale;
+    }
+}
+
+void ApplyPose(const Pose& pose, std::vector<Node>& nodes)
+{
+    size_t count = glm::min(pose.size(), nodes.size());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        nodes[i].translation = pose.translations[i];
+        nodes[i].rotation = pose.rotations[i];
+        nodes[i].scale = pose.scales[i];
+    }
+}
 
-    for (const auto& ch : anim.channels)
+int PlayClip(AnimMixer& mixer, int clip, float weight, bool additive)
+{
+    AnimLayer layer;
+    layer.clip = clip;
+    layer.weight = weight;
+    layer.targetWeight = weight;
+    layer.additive = additive;
+
+    mixer.layers.push_back(layer);
+    return static_cast<int>(mixer.layers.size()) - 1;
+}
+
+void CrossFade(AnimMixer& mixer, int clip, float duration)
+{
+    float rate = duration > 0.0f ? 1.0f / duration : 0.0f;
+
+    for (auto& layer : mixer.layers)
     {
-        if (ch.node < 0 || ch.node >= nodes.size())
+        if (layer.additive)
             continue;
+        layer.targetWeight = 0.0f;
+        layer.fadeRate = rate;
+        if (rate == 0.0f)
+            layer.weight = 0.0f;
+    }
+
+    int idx = PlayClip(mixer, clip, rate > 0.0f ? 0.0f : 1.0f, false);
+    mixer.layers[idx].targetWeight = 1.0f;
+    mixer.layers[idx].fadeRate = rate;
+}
+
+void UpdateMixer(AnimMixer& mixer, float dt)
+{
+    for (auto& layer : mixer.layers)
+    {
+        layer.time += dt * layer.speed;
 
-        const auto& sp = anim.samplers[ch.sampler];
-        if (sp.times.size() < 2)
+        if (layer.weight < layer.targetWeight)
+            layer.weight = glm::min(layer.weight + layer.fadeRate * dt, layer.targetWeight);
+        else if (layer.weight > layer.targetWeight)
+            layer.weight = glm::max(layer.weight - layer.fadeRate * dt, layer.targetWeight);
+    }
+
+    // Drop layers that finished fading out
+    mixer.layers.erase(
+        std::remove_if(mixer.layers.begin(), mixer.layers.end(),
+            [](const AnimLayer& l) { return l.weight <= 0.0f && l.targetWeight <= 0.0f; }),
+        mixer.layers.end());
+}
+
+void EvaluateMixer(
+    const AnimLibrary& lib,
+    AnimMixer& mixer,
+    const Pose& bind,
+    Pose& out)
+{
+    out.Resize(bind.size());
+    std::copy(bind.translations.begin(), bind.translations.end(), out.translations.begin());
+    std::copy(bind.rotations.begin(), bind.rotations.end(), out.rotations.begin());
+    std::copy(bind.scales.begin(), bind.scales.end(), out.scales.begin());
+    std::fill(out.weights.begin(), out.weights.end(), 0.0f);
+
+    /* ---- Override layers ---- */
+    for (auto& layer : mixer.layers)
+    {
+        if (layer.additive || layer.weight <= 0.0f)
+            continue;
+        if (layer.clip < 0 || layer.clip >= lib.clips.size())
             continue;
 
-        int i = 0;
-        while (i + 1 < sp.times.size() && sp.times[i + 1] < t)
-            i++;
+        const Animation& anim = lib.clips[layer.clip];
+        if (anim.empty() || anim.duration <= 0.0f)
+            continue;
 
-        float a =
-            (t - sp.times[i]) /
-            (sp.times[i + 1] - sp.times[i]);
+        BlendSink sink{ out, layer.weight };
+        EvaluateClip(anim, layer.time, layer.loop, layer.cursor, sink);
+    }
 
-        Node& n = nodes[ch.node];
+    // Slots with less than full weight fall back toward the bind pose
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        float wt = out.weights[i * 3 + 0];
+        float wr = out.weights[i * 3 + 1];
+        float ws = out.weights[i * 3 + 2];
+
+        if (wt > 0.0f && wt < 1.0f)
+            out.translations[i] = glm::mix(bind.translations[i], out.translations[i], wt);
+        if (wr > 0.0f && wr < 1.0f)
+            out.rotations[i] = glm::slerp(bind.rotations[i], out.rotations[i], wr);
+        if (ws > 0.0f && ws < 1.0f)
+            out.scales[i] = glm::mix(bind.scales[i], out.scales[i], ws);
+    }
+
+    /* ---- Additive layers ---- */
+    for (auto& layer : mixer.layers)
+    {
+        if (!layer.additive || layer.weight <= 0.0f)
+            continue;
+        if (layer.clip < 0 || layer.clip >= lib.clips.size())
+            continue;
 
-        if (ch.path == AnimChannel::T)
-            n.translation = glm::mix(
-                glm::vec3(sp.values[i]),
-                glm::vec3(sp.values[i + 1]), a);
+        const Animation& anim = lib.clips[layer.clip];
+        if (anim.empty() || anim.duration <= 0.0f)
+            continue;
 
-        else if (ch.path == AnimChannel::R)
-            n.rotation = glm::slerp(
-                glm::quat(sp.values[i].w, sp.values[i].x,
-                    sp.values[i].y, sp.values[i].z),
-                glm::quat(sp.values[i + 1].w, sp.values[i + 1].x,
-                    sp.values[i + 1].y, sp.values[i + 1].z), a);
+        AdditiveSink sink{ out, bind, layer.weight };
+        EvaluateClip(anim, layer.time, layer.loop, layer.cursor, sink);
     }
 }
 
+/* =========================
+   Hierarchy
+   ========================= */
+
 void UpdateLocal(Node& n)
 {
     n.localMatrix =
@@ -216,6 +634,186 @@ void BuildJointPalette(
         skin.inverseBind[i];
 }
 
+void BuildHierarchy(const std::vector<Node>& nodes, NodeHierarchy& h)
+{
+    size_t count = nodes.size();
+
+    h.nodeOf.clear();
+    h.nodeOf.reserve(count);
+    h.slotOf.assign(count, -1);
+    h.parents.clear();
+    h.parents.reserve(count);
+
+    // Iterative pre-order walk: parents always precede their children
+    // and every subtree occupies a contiguous slot range.
+    std::vector<int> stack;
+    for (size_t r = count; r-- > 0;)
+        if (nodes[r].parent < 0)
+            stack.push_back(static_cast<int>(r));
+
+    while (!stack.empty())
+    {
+        int idx = stack.back();
+        stack.pop_back();
+
+        if (h.slotOf[idx] >= 0)
+            continue;       // malformed file: node listed twice
+
+        int parent = nodes[idx].parent;
+        h.slotOf[idx] = static_cast<int>(h.nodeOf.size());
+        h.nodeOf.push_back(idx);
+        h.parents.push_back(parent >= 0 ? h.slotOf[parent] : -1);
+
+        const auto& children = nodes[idx].children;
+        for (size_t c = children.size(); c-- > 0;)
+            if (children[c] >= 0 && children[c] < count)
+                stack.push_back(children[c]);
+    }
+
+    size_t slots = h.nodeOf.size();
+    h.translations.resize(slots);
+    h.rotations.resize(slots);
+    h.scales.resize(slots);
+    h.locals.assign(slots, Affine());
+    h.globals.assign(slots, Affine());
+    h.dirty.assign(slots, 1);
+    h.moved.assign(slots, 0);
+    h.dirtySlots.reserve(slots);
+
+    for (size_t i = 0; i < slots; i++)
+    {
+        const Node& n = nodes[h.nodeOf[i]];
+        h.translations[i] = n.translation;
+        h.rotations[i] = n.rotation;
+        h.scales[i] = n.scale;
+    }
+}
+
+Skin LoadSkin(
+    const tinygltf::Model& model,
+    int index,
+    const NodeHierarchy& h)
+{
+    Skin skin;
+
+    if (index < 0 || index >= model.skins.size())
+        return skin;
+
+    const auto& src = model.skins[index];
+    skin.joints = src.joints;
+
+    if (src.inverseBindMatrices >= 0)
+        skin.inverseBind = ReadMat4Accessor(
+            model,
+            model.accessors[src.inverseBindMatrices]);
+
+    skin.inverseBind.resize(skin.joints.size(), glm::mat4(1.0f));
+
+    skin.inverseBindAffine.resize(skin.joints.size());
+    skin.jointSlots.resize(skin.joints.size());
+
+    for (size_t i = 0; i < skin.joints.size(); i++)
+    {
+        int joint = skin.joints[i];
+        skin.inverseBindAffine[i] = ToAffine(skin.inverseBind[i]);
+        skin.jointSlots[i] = joint >= 0 && joint < h.slotOf.size() ?
+            h.slotOf[joint] : -1;
+    }
+
+    return skin;
+}
+
+void ApplyPose(const Pose& pose, NodeHierarchy& h)
+{
+    size_t slots = h.nodeOf.size();
+
+    for (size_t i = 0; i < slots; i++)
+    {
+        int node = h.nodeOf[i];
+        if (node >= pose.size())
+            continue;
+
+        const glm::vec3& t = pose.translations[node];
+        const glm::quat& r = pose.rotations[node];
+        const glm::vec3& s = pose.scales[node];
+
+        // Only nodes whose TRS actually changed are marked dirty
+        if (t != h.translations[i] || r != h.rotations[i] || s != h.scales[i])
+        {
+            h.translations[i] = t;
+            h.rotations[i] = r;
+            h.scales[i] = s;
+            h.dirty[i] = 1;
+        }
+    }
+}
+
+void UpdateHierarchy(NodeHierarchy& h)
+{
+    size_t slots = h.nodeOf.size();
+
+    // ---- Locals: one batched TRS -> affine kernel call ----
+    h.dirtySlots.clear();
+    for (size_t i = 0; i < slots; i++)
+        if (h.dirty[i])
+            h.dirtySlots.push_back(static_cast<int>(i));
+
+    if (!h.dirtySlots.empty())
+        GetSkinKernels().composeAffine(
+            h.translations.data(),
+            h.rotations.data(),
+            h.scales.data(),
+            h.dirtySlots.data(),
+            h.dirtySlots.size(),
+            h.locals.data());
+
+    // ---- Globals: forward pass, parents first ----
+    for (size_t i = 0; i < slots; i++)
+    {
+        int p = h.parents[i];
+        bool parentMoved = p >= 0 && h.moved[p];
+
+        if (h.dirty[i] || parentMoved)
+        {
+            if (p >= 0)
+                MulAffine(h.globals[p], h.locals[i], h.globals[i]);
+            else
+                h.globals[i] = h.locals[i];
+            h.moved[i] = 1;
+        }
+        else
+        {
+            h.moved[i] = 0;
+        }
+
+        h.dirty[i] = 0;
+    }
+}
+
+void BuildJointPalette(
+    const Skin& skin,
+    const NodeHierarchy& h,
+    std::vector<glm::mat4>& out)
+{
+    out.resize(skin.jointSlots.size());
+
+    if (!out.empty())
+        BuildJointPalette(skin, h, out.data());
+}
+
+void BuildJointPalette(
+    const Skin& skin,
+    const NodeHierarchy& h,
+    glm::mat4* out)
+{
+    GetSkinKernels().buildPalette(
+        h.globals.data(),
+        skin.jointSlots.data(),
+        skin.inverseBindAffine.data(),
+        skin.jointSlots.size(),
+        out);
+}
+
 /* =========================
    Shader Utilities
    ========================= */
@@ -261,8 +859,13 @@ static GLuint CompileShader(const char* path, GLenum type)
 
 GLuint LoadShaderProgram()
 {
-    GLuint vs = CompileShader("vertex.glsl", GL_VERTEX_SHADER);
-    GLuint fs = CompileShader("fragment.glsl", GL_FRAGMENT_SHADER);
+    return LoadShaderProgram("vertex.glsl", "fragment.glsl");
+}
+
+GLuint LoadShaderProgram(const char* vertexPath, const char* fragmentPath)
+{
+    GLuint vs = CompileShader(vertexPath, GL_VERTEX_SHADER);
+    GLuint fs = CompileShader(fragmentPath, GL_FRAGMENT_SHADER);
 
     if (!vs || !fs)
     {
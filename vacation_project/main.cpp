@@ -1,4 +1,8 @@
-﻿#include <iostream>
+﻿#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
 #include <vector>
 
 #include <gl/glew.h>
@@ -11,23 +15,53 @@
 #include <tinygltf-release/tiny_gltf.h>
 
 #include "loader.h"
+#include "crowd.h"
+#include "palette_stream.h"
+#include "scene.h"
 
 /* =========================
    Globals
    ========================= */
 
 GLuint gProgram = 0;
-Mesh gMesh;
+Scene gScene;
+Mesh gMesh;         // skinned primitive instanced by the crowd
 
 std::vector<Node> gNodes;
 std::vector<int> gRootNodes;
+NodeHierarchy gHierarchy;
 
 Skin gSkin;
-Animation gIdleAnim;
-std::vector<glm::mat4> gJointMatrices;
+AnimLibrary gAnimLib;
+AnimMixer gMixer;
+Pose gBindPose;
+Pose gPose;
+
+// Must match MAX_JOINTS and the JointPalette binding in vertex.glsl.
+// The last entry stays identity for geometry without JOINTS_0.
+const int kMaxPaletteJoints = 256;
+const int kRigidJoint = kMaxPaletteJoints - 1;
+const GLuint kJointPaletteBinding = 0;
+PaletteStream gJointStream;
 
 GLint uMVP = -1;
-GLint uJoints = -1;
+GLuint uJointPalette = GL_INVALID_INDEX;
+
+size_t gCrowdCount = 0;
+Crowd gCrowd;
+std::unique_ptr<JobSystem> gJobs;
+
+float FrameDeltaTime()
+{
+    // The first frame starts the clock, so load time is not played back
+    static float lastTime = -1.0f;
+    float time = glutGet(GLUT_ELAPSED_TIME) * 0.001f;
+    if (lastTime < 0.0f)
+        lastTime = time;
+    float dt = time - lastTime;
+    lastTime = time;
+    return dt;
+}
 
 /* =========================
    Display
@@ -59,6 +93,29 @@ void Display()
         100.0f
     );
 
+    /* ---- Crowd ---- */
+    if (!gCrowd.instances.empty())
+    {
+        float extent = std::sqrt(static_cast<float>(gCrowd.instances.size())) * 2.0f;
+        glm::mat4 crowdView = glm::lookAt(
+            glm::vec3(0, extent * 0.6f + 3.0f, extent + 5.0f),
+            glm::vec3(0, 0, 0),
+            glm::vec3(0, 1, 0)
+        );
+        glm::mat4 crowdProj = glm::perspective(
+            glm::radians(60.0f), 800.0f / 600.0f, 0.1f, extent * 4.0f + 100.0f);
+
+        // Hand-off: take the palettes finished by the workers, then
+        // start next frame's evaluation while this one is drawn
+        SyncCrowdUpdate(gCrowd, *gJobs);
+        KickCrowdUpdate(gCrowd, *gJobs, gAnimLib, gBindPose, gSkin, FrameDeltaTime());
+
+        DrawCrowd(gCrowd, gMesh, crowdProj * crowdView);
+
+        glutSwapBuffers();
+        return;
+    }
+
     glm::mat4 mvp = proj * view * model;
     
     if (uMVP >= 0) {
@@ -66,52 +123,43 @@ void Display()
     }
 
     /* ---- Animation ---- */
-    if (!gNodes.empty() && !gIdleAnim.samplers.empty())
+    if (!gNodes.empty() && !gMixer.layers.empty())
     {
-        float time = glutGet(GLUT_ELAPSED_TIME) * 0.001f;
-
-        EvaluateIdle(gIdleAnim, time, gNodes);
-
-        for (auto& n : gNodes)
-            UpdateLocal(n);
-
-        for (int r : gRootNodes)
-            UpdateGlobal(r, gNodes);
+        UpdateMixer(gMixer, FrameDeltaTime());
+        EvaluateMixer(gAnimLib, gMixer, gBindPose, gPose);
+        ApplyPose(gPose, gHierarchy);
+        UpdateHierarchy(gHierarchy);
+    }
 
-        if (!gSkin.joints.empty())
-        {
-            BuildJointPalette(gSkin, gNodes, gJointMatrices);
+    /* ---- Joint Palette ---- */
+    // Written straight into this frame's region of the palette ring
+    int region = AcquirePaletteRegion(gJointStream);
+    glm::mat4* palette = PaletteRegionData(gJointStream, region);
+    size_t jointCount = gSkin.jointSlots.size();
 
-            if (!gJointMatrices.empty() && uJoints >= 0)
-            {
-                glUniformMatrix4fv(
-                    uJoints,
-                    (GLsizei)gJointMatrices.size(),
-                    GL_FALSE,
-                    glm::value_ptr(gJointMatrices[0])
-                );
-            }
-        }
+    if (jointCount > 0 && jointCount <= kRigidJoint) {
+        BuildJointPalette(gSkin, gHierarchy, palette);
     }
     else {
-        // 애니메이션이 없으면 identity 매트릭스로 초기화
-        std::vector<glm::mat4> identityMatrices(64, glm::mat4(1.0f));
-        if (uJoints >= 0) {
-            glUniformMatrix4fv(uJoints, 64, GL_FALSE, glm::value_ptr(identityMatrices[0]));
-        }
+        // 스킨이 없거나 너무 크면 전부 identity
+        std::fill(palette, palette + kRigidJoint, glm::mat4(1.0f));
     }
+    palette[kRigidJoint] = glm::mat4(1.0f);
+
+    CommitPaletteRegion(gJointStream, region, kMaxPaletteJoints * sizeof(glm::mat4));
+    glBindBufferRange(
+        GL_UNIFORM_BUFFER,
+        kJointPaletteBinding,
+        gJointStream.buffer,
+        static_cast<GLintptr>(PaletteRegionOffset(gJointStream, region)),
+        kMaxPaletteJoints * sizeof(glm::mat4)
+    );
 
     /* ---- Draw ---- */
-    if (gMesh.vao != 0 && gMesh.indexCount > 0) {
-        glBindVertexArray(gMesh.vao);
-        glDrawElements(
-            GL_TRIANGLES,
-            gMesh.indexCount,
-            GL_UNSIGNED_INT,
-            0
-        );
-        glBindVertexArray(0);
-        
+    if (!gScene.draws.empty()) {
+        DrawScene(gScene, gHierarchy);
+        FencePaletteRegion(gJointStream, region);
+
         // 에러 체크
         err = glGetError();
         if (err != GL_NO_ERROR) {
@@ -122,8 +170,7 @@ void Display()
         static int frameCount = 0;
         if (frameCount++ < 10) {
             std::cout << "Frame " << frameCount 
-                      << ": VAO=" << gMesh.vao 
-                      << ", IndexCount=" << gMesh.indexCount << std::endl;
+                      << ": nothing to draw" << std::endl;
         }
     }
 
@@ -173,16 +220,31 @@ void InitGL()
     std::cout << "Shader program ID: " << gProgram << std::endl;
 
     uMVP = glGetUniformLocation(gProgram, "uMVP");
-    uJoints = glGetUniformLocation(gProgram, "uJoints");
+    uJointPalette = glGetUniformBlockIndex(gProgram, "JointPalette");
     
-    std::cout << "Uniform locations - uMVP: " << uMVP << ", uJoints: " << uJoints << std::endl;
+    std::cout << "Uniform locations - uMVP: " << uMVP << ", JointPalette block: " << uJointPalette << std::endl;
     
     if (uMVP < 0) {
         std::cerr << "Warning: uMVP uniform not found!" << std::endl;
     }
-    if (uJoints < 0) {
-        std::cerr << "Warning: uJoints uniform not found!" << std::endl;
+    if (uJointPalette == GL_INVALID_INDEX) {
+        std::cerr << "Warning: JointPalette uniform block not found!" << std::endl;
+    }
+    else {
+        glUniformBlockBinding(gProgram, uJointPalette, kJointPaletteBinding);
     }
+
+    GLint uboAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+
+    if (!InitPaletteStream(gJointStream, GL_UNIFORM_BUFFER,
+            kMaxPaletteJoints * sizeof(glm::mat4), static_cast<size_t>(uboAlignment))) {
+        std::cerr << "Failed to create joint palette buffer!\n";
+        exit(1);
+    }
+
+    std::cout << "Joint palette stream: "
+              << (gJointStream.persistent ? "persistent mapped" : "staged") << std::endl;
 }
 
 /* =========================
@@ -197,6 +259,9 @@ void LoadGLTF(const char* path)
 
     std::cout << "Attempting to load: " << path << std::endl;
 
+    // BIN chunk stays in the mapped file; accessors read it in place
+    loader.SetMapBinaryFiles(true);
+
     bool ok = loader.LoadBinaryFromFile(&model, &err, &warn, path);
 
     if (!warn.empty()) {
@@ -267,150 +332,57 @@ void LoadGLTF(const char* path)
 
     std::cout << "Root nodes: " << gRootNodes.size() << std::endl;
 
+    BuildHierarchy(gNodes, gHierarchy);
+    UpdateHierarchy(gHierarchy);
+
     // ---- Load Skin ----
     if (!model.skins.empty())
     {
-        const auto& skin = model.skins[0];
-        gSkin.joints = skin.joints;
+        gSkin = LoadSkin(model, 0, gHierarchy);
+        std::cout << "Joints: " << gSkin.joints.size()
+                  << " (kernels: " << SimdLevelName(GetSkinKernelLevel()) << ")" << std::endl;
 
-        if (skin.inverseBindMatrices >= 0) {
-            gSkin.inverseBind = ReadMat4Accessor(
-                model,
-                model.accessors[skin.inverseBindMatrices]
-            );
+        if (gSkin.joints.size() > kRigidJoint) {
+            std::cerr << "Warning: skin has more than " << kRigidJoint
+                      << " joints, drawing unskinned" << std::endl;
         }
-
-        std::cout << "Joints: " << gSkin.joints.size() << std::endl;
     }
 
-    // ---- Load Animation ----
-    if (!model.animations.empty())
-    {
-        gIdleAnim = LoadIdleAnimation(model);
-        std::cout << "Animation loaded: " << gIdleAnim.name 
-                  << " (duration: " << gIdleAnim.duration << "s)" << std::endl;
-    }
+    // ---- Load Animations ----
+    PoseFromNodes(gNodes, gBindPose);
 
-    // ---- Load Mesh ----
-    if (!model.meshes.empty() && !model.meshes[0].primitives.empty())
+    if (!model.animations.empty())
     {
-        const auto& mesh = model.meshes[0];
-        const auto& primitive = mesh.primitives[0];
-
-        std::cout << "Loading mesh geometry..." << std::endl;
-
-        // Get attribute accessors
-        auto posIt = primitive.attributes.find("POSITION");
-        auto normIt = primitive.attributes.find("NORMAL");
-        auto jointsIt = primitive.attributes.find("JOINTS_0");
-        auto weightsIt = primitive.attributes.find("WEIGHTS_0");
-        auto uvIt = primitive.attributes.find("TEXCOORD_0");
-
-        if (posIt == primitive.attributes.end()) {
-            std::cerr << "No POSITION attribute!\n";
-            return;
+        gAnimLib = LoadAnimationLibrary(model);
+        for (const auto& clip : gAnimLib.clips) {
+            std::cout << "Animation loaded: " << clip.name
+                      << " (duration: " << clip.duration << "s)" << std::endl;
         }
 
-        // Read vertex data
-        std::vector<glm::vec3> positions = ReadVec3Accessor(model, model.accessors[posIt->second]);
-        std::vector<glm::vec3> normals;
-        std::vector<glm::vec4> joints;
-        std::vector<glm::vec4> weights;
-        std::vector<glm::vec2> uvs;
-
-        if (normIt != primitive.attributes.end())
-            normals = ReadVec3Accessor(model, model.accessors[normIt->second]);
-        
-        if (jointsIt != primitive.attributes.end())
-            joints = ReadVec4Accessor(model, model.accessors[jointsIt->second]);
-        
-        if (weightsIt != primitive.attributes.end())
-            weights = ReadVec4Accessor(model, model.accessors[weightsIt->second]);
-
-        std::cout << "Vertices: " << positions.size() << std::endl;
-        std::cout << "Has joints: " << (joints.empty() ? "No" : "Yes") << std::endl;
-
-        // Read indices
-        std::vector<unsigned int> indices;
-        if (primitive.indices >= 0) {
-            const auto& accessor = model.accessors[primitive.indices];
-            const auto& bufferView = model.bufferViews[accessor.bufferView];
-            const auto& buffer = model.buffers[bufferView.buffer];
-            const unsigned char* dataPtr = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
-
-            for (size_t i = 0; i < accessor.count; i++) {
-                unsigned int index = 0;
-                if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-                    index = *reinterpret_cast<const unsigned short*>(dataPtr + i * sizeof(unsigned short));
-                }
-                else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
-                    index = *reinterpret_cast<const unsigned int*>(dataPtr + i * sizeof(unsigned int));
-                }
-                indices.push_back(index);
-            }
-        }
-
-        gMesh.indexCount = static_cast<int>(indices.size());
-        std::cout << "Indices: " << gMesh.indexCount << std::endl;
-
-        // Create VAO/VBO/EBO
-        glGenVertexArrays(1, &gMesh.vao);
-        glGenBuffers(1, &gMesh.vbo);
-        glGenBuffers(1, &gMesh.ebo);
-
-        glBindVertexArray(gMesh.vao);
-
-        // Interleave vertex data
-        struct Vertex {
-            glm::vec3 pos;
-            glm::vec3 norm;
-            glm::uvec4 joints;
-            glm::vec4 weights;
-            glm::vec2 uv;
-        };
-
-        std::vector<Vertex> vertices(positions.size());
-        for (size_t i = 0; i < positions.size(); i++) {
-            vertices[i].pos = positions[i];
-            vertices[i].norm = normals.empty() ? glm::vec3(0, 1, 0) : normals[i];
-            vertices[i].joints = joints.empty() ? glm::uvec4(0) : glm::uvec4(joints[i]);
-            vertices[i].weights = weights.empty() ? glm::vec4(1, 0, 0, 0) : weights[i];
-            vertices[i].uv = glm::vec2(0);
-        }
-
-        // Upload vertex data
-        glBindBuffer(GL_ARRAY_BUFFER, gMesh.vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-        // Upload index data
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gMesh.ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-
-        // Set vertex attributes
-        // POSITION (location = 0)
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
-
-        // NORMAL (location = 1)
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, norm));
+        int idle = gAnimLib.Find("idle");
+        PlayClip(gMixer, idle >= 0 ? idle : 0);
+    }
 
-        // JOINTS_0 (location = 2)
-        glEnableVertexAttribArray(2);
-        glVertexAttribIPointer(2, 4, GL_UNSIGNED_INT, sizeof(Vertex), (void*)offsetof(Vertex, joints));
+    // ---- Load Meshes ----
+    std::cout << "Loading scene geometry..." << std::endl;
 
-        // WEIGHTS_0 (location = 3)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, weights));
+    if (!BuildScene(model, gHierarchy, kRigidJoint, gScene)) {
+        std::cerr << "No drawable primitives!\n";
+        return;
+    }
 
-        // TEXCOORD_0 (location = 4)
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    if (!InitSceneGL(gScene, gProgram)) {
+        std::cerr << "Warning: uDrawMatrices uniform not found!" << std::endl;
+    }
 
-        glBindVertexArray(0);
+    gMesh = ScenePrimitiveMesh(gScene, FindSkinnedPrimitive(gScene));
 
-        std::cout << "Mesh uploaded to GPU successfully!" << std::endl;
-    }
+    std::cout << "Primitives: " << gScene.primitives.size()
+              << ", draws: " << gScene.draws.size()
+              << ", batches: " << gScene.batches.size()
+              << ", buffers: " << gScene.pools.size()
+              << (gScene.multiDraw ? " (multi-draw indirect)" : " (per-draw fallback)")
+              << std::endl;
 }
 
 /* =========================
@@ -424,9 +396,37 @@ int main(int argc, char** argv)
     glutInitWindowSize(800, 600);
     glutCreateWindow("glTF Idle Animation");
 
+    // Optional first argument: number of instances for crowd mode
+    if (argc > 1)
+        gCrowdCount = static_cast<size_t>(std::max(0, std::atoi(argv[1])));
+
     InitGL();
     LoadGLTF("peto.glb");
 
+    if (gCrowdCount > 0)
+    {
+        GLuint crowdProgram = LoadShaderProgram("crowd_vertex.glsl", "fragment.glsl");
+        if (crowdProgram == 0) {
+            std::cerr << "Failed to load crowd shaders!\n";
+            exit(1);
+        }
+
+        int clip = gAnimLib.clips.empty() ? -1 : gMixer.layers[0].clip;
+        InitCrowd(gCrowd, gCrowdCount, gHierarchy, gSkin, gAnimLib, clip, 2.0f);
+
+        if (!InitCrowdGL(gCrowd, crowdProgram)) {
+            std::cerr << "Crowd mode unavailable, drawing a single character\n";
+            gCrowd.instances.clear();
+        }
+        else {
+            gJobs.reset(new JobSystem());
+            UpdateCrowd(gCrowd, gAnimLib, gBindPose, gSkin, 0.0f);
+
+            std::cout << "Crowd: " << gCrowdCount << " instances on "
+                      << gJobs->ThreadCount() << " threads" << std::endl;
+        }
+    }
+
     glutDisplayFunc(Display);
     glutIdleFunc(Idle);
 
@@ -0,0 +1,146 @@
+#include "palette_stream.h"
+
+#include <iostream>
+
+/* =========================
+   Setup
+   ========================= */
+
+bool InitPaletteStream(
+    PaletteStream& stream,
+    GLenum target,
+    size_t bytesPerFrame,
+    size_t alignment)
+{
+    DestroyPaletteStream(stream);
+
+    if (alignment == 0)
+        alignment = sizeof(glm::mat4);
+
+    stream.target = target;
+    stream.regionSize = (bytesPerFrame + alignment - 1) / alignment * alignment;
+    stream.next = 0;
+
+    GLsizeiptr total = static_cast<GLsizeiptr>(stream.regionSize * kPaletteRegions);
+
+    glGenBuffers(1, &stream.buffer);
+    glBindBuffer(target, stream.buffer);
+
+    stream.persistent = GLEW_ARB_buffer_storage != 0;
+
+    if (stream.persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, total, nullptr, flags);
+        stream.mapped = static_cast<unsigned char*>(
+            glMapBufferRange(target, 0, total, flags));
+
+        if (!stream.mapped)
+        {
+            std::cerr << "Persistent palette mapping failed, using staging copy\n";
+            glBindBuffer(target, 0);
+            glDeleteBuffers(1, &stream.buffer);
+
+            // Immutable storage cannot be respecified; start over
+            glGenBuffers(1, &stream.buffer);
+            glBindBuffer(target, stream.buffer);
+            stream.persistent = false;
+        }
+    }
+
+    if (!stream.persistent)
+    {
+        glBufferData(target, total, nullptr, GL_DYNAMIC_DRAW);
+        stream.staging.assign(static_cast<size_t>(total), 0);
+    }
+
+    glBindBuffer(target, 0);
+    return stream.buffer != 0;
+}
+
+void DestroyPaletteStream(PaletteStream& stream)
+{
+    for (auto& fence : stream.fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = 0;
+    }
+
+    if (stream.buffer)
+    {
+        if (stream.mapped)
+        {
+            glBindBuffer(stream.target, stream.buffer);
+            glUnmapBuffer(stream.target);
+            glBindBuffer(stream.target, 0);
+        }
+        glDeleteBuffers(1, &stream.buffer);
+    }
+
+    stream.buffer = 0;
+    stream.mapped = nullptr;
+    stream.staging.clear();
+}
+
+/* =========================
+   Per Frame
+   ========================= */
+
+int AcquirePaletteRegion(PaletteStream& stream)
+{
+    int region = stream.next;
+    stream.next = (stream.next + 1) % kPaletteRegions;
+
+    GLsync& fence = stream.fences[region];
+    if (fence)
+    {
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;)
+        {
+            GLenum r = glClientWaitSync(fence, flags, 1000000);   // 1 ms
+            if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED ||
+                r == GL_WAIT_FAILED)
+                break;
+            flags = 0;
+        }
+        glDeleteSync(fence);
+        fence = 0;
+    }
+
+    return region;
+}
+
+glm::mat4* PaletteRegionData(PaletteStream& stream, int region)
+{
+    unsigned char* base = stream.persistent ? stream.mapped : stream.staging.data();
+    return reinterpret_cast<glm::mat4*>(base + PaletteRegionOffset(stream, region));
+}
+
+size_t PaletteRegionOffset(const PaletteStream& stream, int region)
+{
+    return static_cast<size_t>(region) * stream.regionSize;
+}
+
+void CommitPaletteRegion(PaletteStream& stream, int region, size_t bytes)
+{
+    // Coherent persistent mapping: writes are already visible
+    if (stream.persistent || bytes == 0)
+        return;
+
+    size_t offset = PaletteRegionOffset(stream, region);
+
+    glBindBuffer(stream.target, stream.buffer);
+    glBufferSubData(stream.target,
+        static_cast<GLintptr>(offset),
+        static_cast<GLsizeiptr>(bytes),
+        stream.staging.data() + offset);
+    glBindBuffer(stream.target, 0);
+}
+
+void FencePaletteRegion(PaletteStream& stream, int region)
+{
+    if (stream.fences[region])
+        glDeleteSync(stream.fences[region]);
+    stream.fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
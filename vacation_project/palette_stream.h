@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <gl/glew.h>
+#include <gl/glm/glm.hpp>
+
+/* =========================
+   Palette Stream
+   ========================= */
+
+// Ring of per-frame regions in one GL buffer for streaming joint
+// palettes. With GL_ARB_buffer_storage the buffer is persistently and
+// coherently mapped, so the CPU writes palettes straight into GPU
+// visible memory. Otherwise regions are staged in a CPU copy allocated
+// once and sent with one glBufferSubData per frame. Either way a fence
+// per region keeps the CPU from overwriting data the GPU still reads.
+
+const int kPaletteRegions = 3;
+
+struct PaletteStream
+{
+    GLuint buffer = 0;
+    GLenum target = GL_UNIFORM_BUFFER;
+
+    size_t regionSize = 0;              // bytes, rounded to the alignment
+    int next = 0;
+
+    bool persistent = false;
+    unsigned char* mapped = nullptr;    // persistent mapping
+    std::vector<unsigned char> staging; // fallback copy of the ring
+
+    GLsync fences[kPaletteRegions] = {};
+};
+
+// alignment: required offset alignment between regions, e.g.
+// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform buffers.
+bool InitPaletteStream(
+    PaletteStream& stream,
+    GLenum target,
+    size_t bytesPerFrame,
+    size_t alignment);
+
+void DestroyPaletteStream(PaletteStream& stream);
+
+// Waits until the GPU is done with the next region and returns it.
+int AcquirePaletteRegion(PaletteStream& stream);
+
+glm::mat4* PaletteRegionData(PaletteStream& stream, int region);
+size_t PaletteRegionOffset(const PaletteStream& stream, int region);
+
+// Makes the first `bytes` of the region visible to the GPU.
+void CommitPaletteRegion(PaletteStream& stream, int region, size_t bytes);
+
+// Call after the last draw that reads the region.
+void FencePaletteRegion(PaletteStream& stream, int region);
@@ -0,0 +1,486 @@
+#include "scene.h"
+
+#include <algorithm>
+
+/* =========================
+   Build
+   ========================= */
+
+static bool ReadPrimitiveStreams(
+    const tinygltf::Model& model,
+    const tinygltf::Primitive& primitive,
+    VertexStreams& streams)
+{
+    auto find = [&primitive](const char* name)
+    {
+        auto it = primitive.attributes.find(name);
+        return it == primitive.attributes.end() ? -1 : it->second;
+    };
+
+    int pos = find("POSITION");
+    if (pos < 0)
+        return false;
+
+    streams.positions = AccessorView<glm::vec3>(model, model.accessors[pos]);
+
+    int norm = find("NORMAL");
+    if (norm >= 0)
+        streams.normals = AccessorView<glm::vec3>(model, model.accessors[norm]);
+
+    int joints = find("JOINTS_0");
+    if (joints >= 0)
+    {
+        const auto& accessor = model.accessors[joints];
+        if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ||
+            accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+            streams.joints = AccessorView<glm::u16vec4>(model, accessor);
+        else
+            std::cerr << "JOINTS_0 must be UNSIGNED_BYTE or UNSIGNED_SHORT\n";
+    }
+
+    int weights = find("WEIGHTS_0");
+    if (weights >= 0)
+        streams.weights = AccessorView<glm::vec4>(model, model.accessors[weights]);
+
+    int uv = find("TEXCOORD_0");
+    if (uv >= 0)
+        streams.uvs = AccessorView<glm::vec2>(model, model.accessors[uv]);
+
+    return !streams.positions.Empty();
+}
+
+static bool SameLayout(const VertexLayout& a, const VertexLayout& b)
+{
+    return a.stride == b.stride &&
+        a.jointType == b.jointType &&
+        a.weightType == b.weightType;
+}
+
+// CPU side of a pool while primitives are appended
+struct PoolData
+{
+    std::vector<unsigned char> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Packs the vertices and indices straight onto the end of their pool.
+// indices null: the primitive is drawn in vertex order.
+static void AppendPrimitive(
+    Scene& scene,
+    std::vector<PoolData>& data,
+    const VertexStreams& streams,
+    const VertexLayout& layout,
+    const AccessorView<unsigned int>* indices,
+    ScenePrimitive& prim)
+{
+    int pool = -1;
+    for (size_t i = 0; i < scene.pools.size(); i++)
+    {
+        if (SameLayout(scene.pools[i].layout, layout))
+        {
+            pool = static_cast<int>(i);
+            break;
+        }
+    }
+
+    if (pool < 0)
+    {
+        pool = static_cast<int>(scene.pools.size());
+        scene.pools.push_back(ScenePool());
+        scene.pools.back().layout = layout;
+        data.push_back(PoolData());
+    }
+
+    ScenePool& p = scene.pools[pool];
+    PoolData& d = data[pool];
+
+    const size_t vertexCount = streams.positions.Size();
+    const size_t indexCount = indices ? indices->Size() : vertexCount;
+
+    prim.pool = pool;
+    prim.baseVertex = static_cast<GLint>(p.vertexCount);
+    prim.firstIndex = static_cast<GLuint>(p.indexCount);
+    prim.indexCount = static_cast<GLuint>(indexCount);
+
+    size_t vertexBase = d.vertices.size();
+    d.vertices.resize(vertexBase + vertexCount * layout.stride);
+    PackVertices(streams, layout, d.vertices.data() + vertexBase);
+
+    size_t indexBase = d.indices.size();
+    d.indices.resize(indexBase + indexCount);
+    if (indices)
+    {
+        indices->Read(0, indexCount, d.indices.data() + indexBase);
+    }
+    else
+    {
+        for (size_t i = 0; i < indexCount; i++)
+            d.indices[indexBase + i] = static_cast<unsigned int>(i);
+    }
+
+    p.vertexCount += vertexCount;
+    p.indexCount += indexCount;
+}
+
+static void UploadPools(Scene& scene, const std::vector<PoolData>& data)
+{
+    for (size_t i = 0; i < scene.pools.size(); i++)
+    {
+        ScenePool& pool = scene.pools[i];
+
+        glGenVertexArrays(1, &pool.vao);
+        glGenBuffers(1, &pool.vbo);
+        glGenBuffers(1, &pool.ebo);
+
+        glBindVertexArray(pool.vao);
+
+        glBindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+        glBufferData(GL_ARRAY_BUFFER, data[i].vertices.size(),
+            data[i].vertices.data(), GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, data[i].indices.size() * sizeof(unsigned int),
+            data[i].indices.data(), GL_STATIC_DRAW);
+
+        SetupPackedAttributes(pool.layout);
+
+        // DRAW_ID (location = 5): one value per draw, picked by baseInstance.
+        // Without multi-draw it stays a constant set per draw call.
+        if (scene.multiDraw)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, scene.drawIds);
+            glEnableVertexAttribArray(5);
+            glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+            glVertexAttribDivisor(5, 1);
+        }
+
+        glBindVertexArray(0);
+
+        // Instanced draws of single primitives (the crowd) must not step
+        // DRAW_ID per instance past the end of drawIds
+        if (scene.multiDraw)
+        {
+            glGenVertexArrays(1, &pool.meshVao);
+            glBindVertexArray(pool.meshVao);
+            glBindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.ebo);
+            SetupPackedAttributes(pool.layout);
+            glBindVertexArray(0);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+static void BuildBatches(Scene& scene)
+{
+    auto key = [&scene](const SceneDraw& d)
+    {
+        const ScenePrimitive& p = scene.primitives[d.primitive];
+        return std::make_pair(p.material, scene.pools[p.pool].vao);
+    };
+
+    // Stable, so equal keys keep scene order
+    std::stable_sort(scene.draws.begin(), scene.draws.end(),
+        [&key](const SceneDraw& a, const SceneDraw& b) { return key(a) < key(b); });
+
+    scene.batches.clear();
+    scene.commands.resize(scene.draws.size());
+
+    for (size_t i = 0; i < scene.draws.size(); i++)
+    {
+        const ScenePrimitive& p = scene.primitives[scene.draws[i].primitive];
+
+        DrawElementsIndirectCommand& cmd = scene.commands[i];
+        cmd.count = p.indexCount;
+        cmd.instanceCount = 1;
+        cmd.firstIndex = p.firstIndex;
+        cmd.baseVertex = p.baseVertex;
+        cmd.baseInstance = static_cast<GLuint>(i);
+
+        if (scene.batches.empty() ||
+            key(scene.draws[i]) != key(scene.draws[scene.batches.back().first]))
+        {
+            SceneBatch batch;
+            batch.material = p.material;
+            batch.vao = scene.pools[p.pool].vao;
+            batch.first = i;
+            scene.batches.push_back(batch);
+        }
+        scene.batches.back().count++;
+    }
+}
+
+bool BuildScene(
+    const tinygltf::Model& model,
+    const NodeHierarchy& hierarchy,
+    unsigned short rigidJoint,
+    Scene& scene)
+{
+    DestroyScene(scene);
+
+    // The draw ID comes from baseInstance, which needs base_instance too
+    scene.multiDraw = GLEW_VERSION_4_3 ||
+        (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+
+    // ---- Primitives ----
+    std::vector<PoolData> data;
+    scene.meshPrimitives.resize(model.meshes.size());
+
+    for (size_t m = 0; m < model.meshes.size(); m++)
+    {
+        const auto& mesh = model.meshes[m];
+
+        for (size_t k = 0; k < mesh.primitives.size(); k++)
+        {
+            const auto& primitive = mesh.primitives[k];
+
+            if (primitive.mode != TINYGLTF_MODE_TRIANGLES && primitive.mode != -1)
+            {
+                std::cerr << "Mesh " << m << " primitive " << k
+                    << ": only triangles are drawn\n";
+                continue;
+            }
+
+            VertexStreams streams;
+            streams.rigidJoint = rigidJoint;
+            if (!ReadPrimitiveStreams(model, primitive, streams))
+            {
+                std::cerr << "Mesh " << m << " primitive " << k << ": no POSITION\n";
+                continue;
+            }
+
+            AccessorView<unsigned int> indices;
+            if (primitive.indices >= 0)
+            {
+                const auto& accessor = model.accessors[primitive.indices];
+                if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+                    accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT &&
+                    accessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+                {
+                    std::cerr << "Unsupported index component type " << accessor.componentType << "\n";
+                    continue;
+                }
+
+                indices = AccessorView<unsigned int>(model, accessor);
+                if (indices.Empty())
+                    continue;
+            }
+
+            VertexLayout layout = ChooseVertexLayout(streams, WeightPrecision::Unorm16);
+
+            ScenePrimitive prim;
+            prim.material = primitive.material;
+            AppendPrimitive(scene, data, streams, layout,
+                primitive.indices >= 0 ? &indices : nullptr, prim);
+
+            scene.meshPrimitives[m].push_back(static_cast<int>(scene.primitives.size()));
+            scene.primitives.push_back(prim);
+        }
+    }
+
+    // ---- Draws ----
+    // Only nodes reachable from the roots are in the hierarchy
+    for (size_t slot = 0; slot < hierarchy.nodeOf.size(); slot++)
+    {
+        const auto& node = model.nodes[hierarchy.nodeOf[slot]];
+        if (node.mesh < 0)
+            continue;
+
+        if (node.skin > 0)
+            std::cerr << "Node " << hierarchy.nodeOf[slot]
+                << ": only skin 0 has a palette\n";
+
+        for (int prim : scene.meshPrimitives[node.mesh])
+        {
+            SceneDraw draw;
+            draw.primitive = prim;
+            draw.slot = static_cast<int>(slot);
+            draw.skinned = node.skin >= 0;
+            scene.draws.push_back(draw);
+        }
+    }
+
+    if (scene.draws.empty())
+        return false;
+
+    // ---- GPU ----
+    std::vector<GLuint> ids(scene.draws.size());
+    for (size_t i = 0; i < ids.size(); i++)
+        ids[i] = static_cast<GLuint>(i);
+
+    glGenBuffers(1, &scene.drawIds);
+    glBindBuffer(GL_ARRAY_BUFFER, scene.drawIds);
+    glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    UploadPools(scene, data);
+    BuildBatches(scene);
+
+    if (scene.multiDraw)
+    {
+        glGenBuffers(1, &scene.indirect);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, scene.indirect);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER,
+            scene.commands.size() * sizeof(DrawElementsIndirectCommand),
+            scene.commands.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    if (!InitPaletteStream(scene.transforms, GL_TEXTURE_BUFFER,
+            scene.draws.size() * sizeof(glm::mat4), sizeof(glm::mat4)))
+        return false;
+
+    glGenTextures(1, &scene.texture);
+    glBindTexture(GL_TEXTURE_BUFFER, scene.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, scene.transforms.buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    return true;
+}
+
+bool InitSceneGL(Scene& scene, GLuint program)
+{
+    scene.uDrawMatrices = glGetUniformLocation(program, "uDrawMatrices");
+    scene.uDrawBase = glGetUniformLocation(program, "uDrawBase");
+    return scene.uDrawMatrices >= 0;
+}
+
+Mesh ScenePrimitiveMesh(const Scene& scene, int primitive)
+{
+    Mesh mesh;
+    if (primitive < 0 || primitive >= static_cast<int>(scene.primitives.size()))
+        return mesh;
+
+    const ScenePrimitive& p = scene.primitives[primitive];
+    const ScenePool& pool = scene.pools[p.pool];
+
+    mesh.vao = pool.meshVao ? pool.meshVao : pool.vao;
+    mesh.vbo = pool.vbo;
+    mesh.ebo = pool.ebo;
+    mesh.indexCount = static_cast<int>(p.indexCount);
+    mesh.firstIndex = static_cast<int>(p.firstIndex);
+    mesh.baseVertex = p.baseVertex;
+    return mesh;
+}
+
+int FindSkinnedPrimitive(const Scene& scene)
+{
+    for (const auto& draw : scene.draws)
+    {
+        if (draw.skinned)
+            return draw.primitive;
+    }
+    return -1;
+}
+
+/* =========================
+   Draw
+   ========================= */
+
+void DrawScene(Scene& scene, const NodeHierarchy& hierarchy)
+{
+    if (scene.draws.empty())
+        return;
+
+    // ---- Per-draw world matrices ----
+    int region = AcquirePaletteRegion(scene.transforms);
+    glm::mat4* world = PaletteRegionData(scene.transforms, region);
+
+    for (size_t i = 0; i < scene.draws.size(); i++)
+    {
+        const SceneDraw& d = scene.draws[i];
+
+        // Skinned vertices are placed by the joint palette
+        world[i] = d.skinned ? glm::mat4(1.0f) : ToMat4(hierarchy.globals[d.slot]);
+    }
+
+    CommitPaletteRegion(scene.transforms, region, scene.draws.size() * sizeof(glm::mat4));
+
+    glUniform1i(scene.uDrawBase, static_cast<GLint>(
+        PaletteRegionOffset(scene.transforms, region) / 16));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, scene.texture);
+    glUniform1i(scene.uDrawMatrices, 0);
+
+    // ---- Batches ----
+    if (scene.multiDraw)
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, scene.indirect);
+
+    for (const auto& batch : scene.batches)
+    {
+        glBindVertexArray(batch.vao);
+
+        if (scene.multiDraw)
+        {
+            glMultiDrawElementsIndirect(
+                GL_TRIANGLES,
+                GL_UNSIGNED_INT,
+                (void*)(batch.first * sizeof(DrawElementsIndirectCommand)),
+                static_cast<GLsizei>(batch.count),
+                0);
+        }
+        else
+        {
+            for (size_t i = batch.first; i < batch.first + batch.count; i++)
+            {
+                const DrawElementsIndirectCommand& cmd = scene.commands[i];
+                glVertexAttribI1ui(5, cmd.baseInstance);
+                glDrawElementsBaseVertex(
+                    GL_TRIANGLES,
+                    static_cast<GLsizei>(cmd.count),
+                    GL_UNSIGNED_INT,
+                    (void*)(cmd.firstIndex * sizeof(unsigned int)),
+                    cmd.baseVertex);
+            }
+        }
+    }
+
+    glBindVertexArray(0);
+
+    if (scene.multiDraw)
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    FencePaletteRegion(scene.transforms, region);
+}
+
+/* =========================
+   Cleanup
+   ========================= */
+
+void DestroyScene(Scene& scene)
+{
+    for (auto& pool : scene.pools)
+    {
+        if (pool.vao)
+            glDeleteVertexArrays(1, &pool.vao);
+        if (pool.meshVao)
+            glDeleteVertexArrays(1, &pool.meshVao);
+        if (pool.vbo)
+            glDeleteBuffers(1, &pool.vbo);
+        if (pool.ebo)
+            glDeleteBuffers(1, &pool.ebo);
+    }
+
+    if (scene.indirect)
+        glDeleteBuffers(1, &scene.indirect);
+    if (scene.drawIds)
+        glDeleteBuffers(1, &scene.drawIds);
+    if (scene.texture)
+        glDeleteTextures(1, &scene.texture);
+    DestroyPaletteStream(scene.transforms);
+
+    scene.pools.clear();
+    scene.primitives.clear();
+    scene.meshPrimitives.clear();
+    scene.draws.clear();
+    scene.batches.clear();
+    scene.commands.clear();
+
+    scene.indirect = 0;
+    scene.drawIds = 0;
+    scene.texture = 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "loader.h"
+#include "palette_stream.h"
+#include "vertex_pack.h"
+
+/* =========================
+   Scene
+   ========================= */
+
+// Every mesh primitive of a glTF file, packed into a few shared vertex
+// and index buffers (one pool per vertex layout). Draws are sorted by
+// material and VAO, and each run of equal keys goes out as one
+// glMultiDrawElementsIndirect. The vertex shader finds its draw's world
+// matrix through aDrawID (location 5, fed by baseInstance) in a texture
+// buffer streamed once per frame.
+
+// Layout fixed by GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+struct ScenePool
+{
+    VertexLayout layout;
+    GLuint vao = 0;
+    GLuint meshVao = 0;         // same buffers without DRAW_ID, multi-draw only
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+};
+
+struct ScenePrimitive
+{
+    int pool = -1;
+    int material = -1;
+
+    GLuint indexCount = 0;
+    GLuint firstIndex = 0;      // in indices of the pool's index buffer
+    GLint baseVertex = 0;       // in vertices of the pool's vertex buffer
+};
+
+struct SceneDraw
+{
+    int primitive = -1;
+    int slot = -1;              // hierarchy slot of the node drawing it
+    bool skinned = false;       // node has a skin: joints carry the transform
+};
+
+// A run of draws sharing material and VAO
+struct SceneBatch
+{
+    int material = -1;
+    GLuint vao = 0;
+    size_t first = 0;
+    size_t count = 0;
+};
+
+struct Scene
+{
+    std::vector<ScenePool> pools;
+    std::vector<ScenePrimitive> primitives;
+    std::vector<std::vector<int>> meshPrimitives;   // mesh -> primitives
+
+    std::vector<SceneDraw> draws;                   // sorted, index == draw ID
+    std::vector<SceneBatch> batches;
+    std::vector<DrawElementsIndirectCommand> commands;
+
+    bool multiDraw = false;     // GL_ARB_multi_draw_indirect + base_instance
+    GLuint indirect = 0;
+    GLuint drawIds = 0;
+
+    PaletteStream transforms;   // one world matrix per draw
+    GLuint texture = 0;
+    GLint uDrawMatrices = -1;
+    GLint uDrawBase = -1;
+};
+
+// Uploads every primitive of the model. Primitives without JOINTS_0
+// are skinned to rigidJoint, which the palette must hold as identity.
+bool BuildScene(
+    const tinygltf::Model& model,
+    const NodeHierarchy& hierarchy,
+    unsigned short rigidJoint,
+    Scene& scene);
+
+bool InitSceneGL(Scene& scene, GLuint program);
+
+// Draw parameters of one primitive, e.g. for instancing it. The VAO has
+// no DRAW_ID attribute, so any instance count is safe.
+Mesh ScenePrimitiveMesh(const Scene& scene, int primitive);
+
+// Primitive of the first skinned draw, -1 if none
+int FindSkinnedPrimitive(const Scene& scene);
+
+// Streams world matrices from the hierarchy and submits all batches.
+// The program passed to InitSceneGL must be in use.
+void DrawScene(Scene& scene, const NodeHierarchy& hierarchy);
+
+void DestroyScene(Scene& scene);
@@ -0,0 +1,504 @@
+#include "skin_kernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SKIN_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts AVX2 intrinsics in any function; GCC/Clang need the
+// target enabled per function so the rest of the file stays baseline.
+#if defined(SKIN_KERNELS_X86) && !defined(_MSC_VER)
+#define SKIN_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define SKIN_TARGET_AVX2
+#endif
+
+/* =========================
+   Affine Helpers
+   ========================= */
+
+Affine ToAffine(const glm::mat4& m)
+{
+    Affine a;
+    for (int i = 0; i < 3; i++)
+        a.rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    return a;
+}
+
+glm::mat4 ToMat4(const Affine& a)
+{
+    glm::mat4 m(1.0f);
+    for (int i = 0; i < 3; i++)
+    {
+        m[0][i] = a.rows[i].x;
+        m[1][i] = a.rows[i].y;
+        m[2][i] = a.rows[i].z;
+        m[3][i] = a.rows[i].w;
+    }
+    return m;
+}
+
+static void MulAffineScalar(const Affine& a, const Affine& b, Affine& out)
+{
+    Affine c;
+    for (int i = 0; i < 3; i++)
+    {
+        const glm::vec4& r = a.rows[i];
+        c.rows[i] =
+            r.x * b.rows[0] +
+            r.y * b.rows[1] +
+            r.z * b.rows[2] +
+            glm::vec4(0.0f, 0.0f, 0.0f, r.w);
+    }
+    out = c;
+}
+
+#if defined(SKIN_KERNELS_X86)
+
+static inline __m128 MulAffineRow(__m128 r, __m128 b0, __m128 b1, __m128 b2, __m128 wmask)
+{
+    __m128 c = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+    c = _mm_add_ps(c, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+    c = _mm_add_ps(c, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+    return _mm_add_ps(c, _mm_and_ps(r, wmask));
+}
+
+static inline __m128 WMask()
+{
+    return _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+}
+
+#endif
+
+void MulAffine(const Affine& a, const Affine& b, Affine& out)
+{
+#if defined(SKIN_KERNELS_X86)
+    // SSE2 is part of the x64 baseline, so no dispatch is needed here
+    __m128 b0 = _mm_loadu_ps(&b.rows[0].x);
+    __m128 b1 = _mm_loadu_ps(&b.rows[1].x);
+    __m128 b2 = _mm_loadu_ps(&b.rows[2].x);
+    __m128 wm = WMask();
+
+    __m128 c0 = MulAffineRow(_mm_loadu_ps(&a.rows[0].x), b0, b1, b2, wm);
+    __m128 c1 = MulAffineRow(_mm_loadu_ps(&a.rows[1].x), b0, b1, b2, wm);
+    __m128 c2 = MulAffineRow(_mm_loadu_ps(&a.rows[2].x), b0, b1, b2, wm);
+
+    _mm_storeu_ps(&out.rows[0].x, c0);
+    _mm_storeu_ps(&out.rows[1].x, c1);
+    _mm_storeu_ps(&out.rows[2].x, c2);
+#else
+    MulAffineScalar(a, b, out);
+#endif
+}
+
+/* =========================
+   Scalar Kernels
+   ========================= */
+
+static void ComposeAffineScalar(
+    const glm::vec3* t,
+    const glm::quat* r,
+    const glm::vec3* s,
+    const int* indices,
+    size_t count,
+    Affine* out)
+{
+    for (size_t k = 0; k < count; k++)
+    {
+        int i = indices[k];
+        const glm::quat& q = r[i];
+
+        float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+        const glm::vec3& sc = s[i];
+        const glm::vec3& tr = t[i];
+
+        out[i].rows[0] = glm::vec4(
+            (1.0f - 2.0f * (yy + zz)) * sc.x,
+            2.0f * (xy - wz) * sc.y,
+            2.0f * (xz + wy) * sc.z,
+            tr.x);
+        out[i].rows[1] = glm::vec4(
+            2.0f * (xy + wz) * sc.x,
+            (1.0f - 2.0f * (xx + zz)) * sc.y,
+            2.0f * (yz - wx) * sc.z,
+            tr.y);
+        out[i].rows[2] = glm::vec4(
+            2.0f * (xz - wy) * sc.x,
+            2.0f * (yz + wx) * sc.y,
+            (1.0f - 2.0f * (xx + yy)) * sc.z,
+            tr.z);
+    }
+}
+
+static const Affine kIdentityAffine;
+
+static void BuildPaletteScalar(
+    const Affine* globals,
+    const int* slots,
+    const Affine* inverseBind,
+    size_t count,
+    glm::mat4* out)
+{
+    for (size_t j = 0; j < count; j++)
+    {
+        const Affine& g = slots[j] >= 0 ? globals[slots[j]] : kIdentityAffine;
+
+        Affine c;
+        MulAffineScalar(g, inverseBind[j], c);
+        out[j] = ToMat4(c);
+    }
+}
+
+#if defined(SKIN_KERNELS_X86)
+
+/* =========================
+   SSE Kernels
+   ========================= */
+
+// Rotation/scale terms for four nodes at once, one node per lane.
+// Writes the 12 affine entries as (row, column) lane vectors.
+static inline void ComposeLanes4(
+    __m128 qx, __m128 qy, __m128 qz, __m128 qw,
+    __m128 sx, __m128 sy, __m128 sz,
+    __m128 m[3][3])
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+    __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+    __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+    m[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+    m[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+    m[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+    m[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+    m[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+    m[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+    m[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+    m[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+    m[2][2] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+    m[2][2] = _mm_mul_ps(m[2][2], sz);
+}
+
+static void ComposeAffineSSE(
+    const glm::vec3* t,
+    const glm::quat* r,
+    const glm::vec3* s,
+    const int* indices,
+    size_t count,
+    Affine* out)
+{
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        int i0 = indices[k], i1 = indices[k + 1], i2 = indices[k + 2], i3 = indices[k + 3];
+
+        __m128 m[3][3];
+        ComposeLanes4(
+            _mm_setr_ps(r[i0].x, r[i1].x, r[i2].x, r[i3].x),
+            _mm_setr_ps(r[i0].y, r[i1].y, r[i2].y, r[i3].y),
+            _mm_setr_ps(r[i0].z, r[i1].z, r[i2].z, r[i3].z),
+            _mm_setr_ps(r[i0].w, r[i1].w, r[i2].w, r[i3].w),
+            _mm_setr_ps(s[i0].x, s[i1].x, s[i2].x, s[i3].x),
+            _mm_setr_ps(s[i0].y, s[i1].y, s[i2].y, s[i3].y),
+            _mm_setr_ps(s[i0].z, s[i1].z, s[i2].z, s[i3].z),
+            m);
+
+        __m128 tr[3] = {
+            _mm_setr_ps(t[i0].x, t[i1].x, t[i2].x, t[i3].x),
+            _mm_setr_ps(t[i0].y, t[i1].y, t[i2].y, t[i3].y),
+            _mm_setr_ps(t[i0].z, t[i1].z, t[i2].z, t[i3].z)
+        };
+
+        // Lane vectors -> one row per node
+        for (int row = 0; row < 3; row++)
+        {
+            __m128 a = m[row][0], b = m[row][1], c = m[row][2], d = tr[row];
+            _MM_TRANSPOSE4_PS(a, b, c, d);
+            _mm_storeu_ps(&out[i0].rows[row].x, a);
+            _mm_storeu_ps(&out[i1].rows[row].x, b);
+            _mm_storeu_ps(&out[i2].rows[row].x, c);
+            _mm_storeu_ps(&out[i3].rows[row].x, d);
+        }
+    }
+
+    ComposeAffineScalar(t, r, s, indices + k, count - k, out);
+}
+
+static void BuildPaletteSSE(
+    const Affine* globals,
+    const int* slots,
+    const Affine* inverseBind,
+    size_t count,
+    glm::mat4* out)
+{
+    const __m128 wm = WMask();
+    const __m128 e3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+    for (size_t j = 0; j < count; j++)
+    {
+        const Affine& g = slots[j] >= 0 ? globals[slots[j]] : kIdentityAffine;
+        const Affine& ib = inverseBind[j];
+
+        __m128 b0 = _mm_loadu_ps(&ib.rows[0].x);
+        __m128 b1 = _mm_loadu_ps(&ib.rows[1].x);
+        __m128 b2 = _mm_loadu_ps(&ib.rows[2].x);
+
+        __m128 c0 = MulAffineRow(_mm_loadu_ps(&g.rows[0].x), b0, b1, b2, wm);
+        __m128 c1 = MulAffineRow(_mm_loadu_ps(&g.rows[1].x), b0, b1, b2, wm);
+        __m128 c2 = MulAffineRow(_mm_loadu_ps(&g.rows[2].x), b0, b1, b2, wm);
+        __m128 c3 = e3;
+
+        // Rows -> glm column-major mat4
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+        float* dst = &out[j][0][0];
+        _mm_storeu_ps(dst + 0, c0);
+        _mm_storeu_ps(dst + 4, c1);
+        _mm_storeu_ps(dst + 8, c2);
+        _mm_storeu_ps(dst + 12, c3);
+    }
+}
+
+/* =========================
+   AVX2 Kernels
+   ========================= */
+
+// In-lane 4x4 transpose of two independent 4x4 blocks
+#define SKIN_TRANSPOSE4_256(r0, r1, r2, r3)               \
+    do {                                                  \
+        __m256 t0 = _mm256_unpacklo_ps(r0, r1);           \
+        __m256 t1 = _mm256_unpackhi_ps(r0, r1);           \
+        __m256 t2 = _mm256_unpacklo_ps(r2, r3);           \
+        __m256 t3 = _mm256_unpackhi_ps(r2, r3);           \
+        r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)); \
+        r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)); \
+        r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)); \
+        r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)); \
+    } while (0)
+
+SKIN_TARGET_AVX2
+static void ComposeAffineAVX2(
+    const glm::vec3* t,
+    const glm::quat* r,
+    const glm::vec3* s,
+    const int* indices,
+    size_t count,
+    Affine* out)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    size_t k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + k));
+        __m256i i3 = _mm256_add_epi32(_mm256_add_epi32(idx, idx), idx);
+        __m256i i4 = _mm256_slli_epi32(idx, 2);
+
+        // Gather eight nodes' components straight from the AoS arrays
+        __m256 qx = _mm256_i32gather_ps(&r[0].x, i4, 4);
+        __m256 qy = _mm256_i32gather_ps(&r[0].y, i4, 4);
+        __m256 qz = _mm256_i32gather_ps(&r[0].z, i4, 4);
+        __m256 qw = _mm256_i32gather_ps(&r[0].w, i4, 4);
+        __m256 sx = _mm256_i32gather_ps(&s[0].x, i3, 4);
+        __m256 sy = _mm256_i32gather_ps(&s[0].y, i3, 4);
+        __m256 sz = _mm256_i32gather_ps(&s[0].z, i3, 4);
+
+        __m256 xx = _mm256_mul_ps(qx, qx), yy = _mm256_mul_ps(qy, qy), zz = _mm256_mul_ps(qz, qz);
+        __m256 xy = _mm256_mul_ps(qx, qy), xz = _mm256_mul_ps(qx, qz), yz = _mm256_mul_ps(qy, qz);
+        __m256 wx = _mm256_mul_ps(qw, qx), wy = _mm256_mul_ps(qw, qy), wz = _mm256_mul_ps(qw, qz);
+
+        __m256 m[3][4];
+        m[0][0] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), sx);
+        m[0][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy);
+        m[0][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz);
+        m[1][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx);
+        m[1][1] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), sy);
+        m[1][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz);
+        m[2][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx);
+        m[2][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy);
+        m[2][2] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), sz);
+        m[0][3] = _mm256_i32gather_ps(&t[0].x, i3, 4);
+        m[1][3] = _mm256_i32gather_ps(&t[0].y, i3, 4);
+        m[2][3] = _mm256_i32gather_ps(&t[0].z, i3, 4);
+
+        const int* n = indices + k;
+        for (int row = 0; row < 3; row++)
+        {
+            __m256 a = m[row][0], b = m[row][1], c = m[row][2], d = m[row][3];
+            SKIN_TRANSPOSE4_256(a, b, c, d);
+
+            // Low lanes hold nodes 0-3, high lanes nodes 4-7
+            _mm_storeu_ps(&out[n[0]].rows[row].x, _mm256_castps256_ps128(a));
+            _mm_storeu_ps(&out[n[1]].rows[row].x, _mm256_castps256_ps128(b));
+            _mm_storeu_ps(&out[n[2]].rows[row].x, _mm256_castps256_ps128(c));
+            _mm_storeu_ps(&out[n[3]].rows[row].x, _mm256_castps256_ps128(d));
+            _mm_storeu_ps(&out[n[4]].rows[row].x, _mm256_extractf128_ps(a, 1));
+            _mm_storeu_ps(&out[n[5]].rows[row].x, _mm256_extractf128_ps(b, 1));
+            _mm_storeu_ps(&out[n[6]].rows[row].x, _mm256_extractf128_ps(c, 1));
+            _mm_storeu_ps(&out[n[7]].rows[row].x, _mm256_extractf128_ps(d, 1));
+        }
+    }
+
+    ComposeAffineSSE(t, r, s, indices + k, count - k, out);
+}
+
+SKIN_TARGET_AVX2
+static inline __m256 MulAffineRow2(__m256 r, __m256 b0, __m256 b1, __m256 b2, __m256 wmask)
+{
+    __m256 c = _mm256_mul_ps(_mm256_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+    c = _mm256_fmadd_ps(_mm256_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1)), b1, c);
+    c = _mm256_fmadd_ps(_mm256_shuffle_ps(r, r, _MM_SHUFFLE(2, 2, 2, 2)), b2, c);
+    return _mm256_add_ps(c, _mm256_and_ps(r, wmask));
+}
+
+SKIN_TARGET_AVX2
+static inline __m256 LoadRowPair(const Affine& a, const Affine& b, int row)
+{
+    return _mm256_insertf128_ps(
+        _mm256_castps128_ps256(_mm_loadu_ps(&a.rows[row].x)),
+        _mm_loadu_ps(&b.rows[row].x), 1);
+}
+
+// Two joints per iteration: joint a in the low 128-bit lane, joint b in
+// the high lane, so every instruction works on both matrices.
+SKIN_TARGET_AVX2
+static void BuildPaletteAVX2(
+    const Affine* globals,
+    const int* slots,
+    const Affine* inverseBind,
+    size_t count,
+    glm::mat4* out)
+{
+    const __m256 wm = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+    const __m256 e3 = _mm256_setr_ps(0, 0, 0, 1, 0, 0, 0, 1);
+
+    size_t j = 0;
+    for (; j + 2 <= count; j += 2)
+    {
+        const Affine& ga = slots[j] >= 0 ? globals[slots[j]] : kIdentityAffine;
+        const Affine& gb = slots[j + 1] >= 0 ? globals[slots[j + 1]] : kIdentityAffine;
+
+        __m256 b0 = _mm256_loadu_ps(&inverseBind[j].rows[0].x);
+        __m256 b1 = _mm256_loadu_ps(&inverseBind[j].rows[2].x);
+        __m256 b2 = _mm256_loadu_ps(&inverseBind[j + 1].rows[1].x);
+
+        // b0 = [a.r0 a.r1], b1 = [a.r2 b.r0], b2 = [b.r1 b.r2]; regroup by row
+        __m256 ib0 = _mm256_permute2f128_ps(b0, b1, 0x30);    // [a.r0 b.r0]
+        __m256 ib1 = _mm256_permute2f128_ps(b0, b2, 0x21);    // [a.r1 b.r1]
+        __m256 ib2 = _mm256_permute2f128_ps(b1, b2, 0x30);    // [a.r2 b.r2]
+
+        __m256 c0 = MulAffineRow2(LoadRowPair(ga, gb, 0), ib0, ib1, ib2, wm);
+        __m256 c1 = MulAffineRow2(LoadRowPair(ga, gb, 1), ib0, ib1, ib2, wm);
+        __m256 c2 = MulAffineRow2(LoadRowPair(ga, gb, 2), ib0, ib1, ib2, wm);
+        __m256 c3 = e3;
+
+        SKIN_TRANSPOSE4_256(c0, c1, c2, c3);
+
+        float* da = &out[j][0][0];
+        float* db = &out[j + 1][0][0];
+        _mm256_storeu_ps(da + 0, _mm256_permute2f128_ps(c0, c1, 0x20));
+        _mm256_storeu_ps(da + 8, _mm256_permute2f128_ps(c2, c3, 0x20));
+        _mm256_storeu_ps(db + 0, _mm256_permute2f128_ps(c0, c1, 0x31));
+        _mm256_storeu_ps(db + 8, _mm256_permute2f128_ps(c2, c3, 0x31));
+    }
+
+    BuildPaletteSSE(globals, slots + j, inverseBind + j, count - j, out + j);
+}
+
+#undef SKIN_TRANSPOSE4_256
+
+#endif // SKIN_KERNELS_X86
+
+/* =========================
+   Dispatch
+   ========================= */
+
+SimdLevel DetectSimdLevel()
+{
+#if defined(SKIN_KERNELS_X86)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+
+    // The OS must save YMM state as well
+    bool ymm = osxsave && (_xgetbv(0) & 6) == 6;
+
+    if (avx && avx2 && fma && ymm)
+        return SimdLevel::AVX2;
+    return SimdLevel::SSE;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE;
+    return SimdLevel::Scalar;
+#endif
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* SimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::SSE:  return "SSE";
+    default:              return "Scalar";
+    }
+}
+
+static SkinKernels KernelsFor(SimdLevel level)
+{
+    SkinKernels k = { ComposeAffineScalar, BuildPaletteScalar };
+
+#if defined(SKIN_KERNELS_X86)
+    if (level == SimdLevel::SSE)
+        k = { ComposeAffineSSE, BuildPaletteSSE };
+    else if (level == SimdLevel::AVX2)
+        k = { ComposeAffineAVX2, BuildPaletteAVX2 };
+#else
+    (void)level;
+#endif
+
+    return k;
+}
+
+static SimdLevel gKernelLevel = DetectSimdLevel();
+static SkinKernels gKernels = KernelsFor(gKernelLevel);
+
+const SkinKernels& GetSkinKernels()
+{
+    return gKernels;
+}
+
+bool SetSkinKernelLevel(SimdLevel level)
+{
+    if (static_cast<int>(level) > static_cast<int>(DetectSimdLevel()))
+        return false;
+
+    gKernelLevel = level;
+    gKernels = KernelsFor(level);
+    return true;
+}
+
+SimdLevel GetSkinKernelLevel()
+{
+    return gKernelLevel;
+}
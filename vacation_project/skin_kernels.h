@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+
+#include <gl/glm/glm.hpp>
+#include <gl/glm/gtc/quaternion.hpp>
+
+/* =========================
+   Affine Transform
+   ========================= */
+
+// Row-major 3x4 affine transform; the implied last row is (0, 0, 0, 1).
+// Each row is (linear.x, linear.y, linear.z, translation).
+struct Affine
+{
+    glm::vec4 rows[3] = {
+        glm::vec4(1, 0, 0, 0),
+        glm::vec4(0, 1, 0, 0),
+        glm::vec4(0, 0, 1, 0)
+    };
+};
+
+Affine ToAffine(const glm::mat4& m);
+glm::mat4 ToMat4(const Affine& a);
+
+// out = a * b
+void MulAffine(const Affine& a, const Affine& b, Affine& out);
+
+/* =========================
+   Skinning Kernels
+   ========================= */
+
+enum class SimdLevel { Scalar, SSE, AVX2 };
+
+// Batch kernels; one implementation per SimdLevel.
+struct SkinKernels
+{
+    // out[i] = T(t[i]) * R(r[i]) * S(s[i]) for every i in indices
+    void (*composeAffine)(
+        const glm::vec3* t,
+        const glm::quat* r,
+        const glm::vec3* s,
+        const int* indices,
+        size_t count,
+        Affine* out);
+
+    // out[j] = globals[slots[j]] * inverseBind[j], expanded to mat4.
+    // A negative slot uses identity for the global transform.
+    void (*buildPalette)(
+        const Affine* globals,
+        const int* slots,
+        const Affine* inverseBind,
+        size_t count,
+        glm::mat4* out);
+};
+
+SimdLevel DetectSimdLevel();
+const char* SimdLevelName(SimdLevel level);
+
+// Kernels for the best level this CPU supports, picked on first use.
+const SkinKernels& GetSkinKernels();
+
+// Forces a level (for benchmarks). Returns false if the CPU lacks it.
+bool SetSkinKernelLevel(SimdLevel level);
+SimdLevel GetSkinKernelLevel();
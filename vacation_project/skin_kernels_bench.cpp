@@ -0,0 +1,172 @@
+// Micro-benchmark: glm TRS/palette path vs. the skinning kernels.
+// Not part of the viewer build (excluded in the .vcxproj); build it on
+// its own, e.g.
+//   cl /O2 /EHsc /I. skin_kernels_bench.cpp skin_kernels.cpp
+//   g++ -O2 -I<include dir with gl/glm> skin_kernels_bench.cpp skin_kernels.cpp
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <gl/glm/glm.hpp>
+#include <gl/glm/gtc/matrix_transform.hpp>
+#include <gl/glm/gtc/quaternion.hpp>
+
+#include "skin_kernels.h"
+
+/* =========================
+   Test Skeleton
+   ========================= */
+
+struct BenchSkeleton
+{
+    std::vector<int> parents;           // parents[i] < i
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> inverseBind;
+    std::vector<Affine> inverseBindAffine;
+    std::vector<int> slots;
+};
+
+static BenchSkeleton MakeSkeleton(int joints)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+
+    BenchSkeleton sk;
+    for (int i = 0; i < joints; i++)
+    {
+        sk.parents.push_back(i == 0 ? -1 : (i - 1) / 2);
+        sk.translations.push_back(glm::vec3(u(rng), u(rng), u(rng)));
+        sk.rotations.push_back(glm::normalize(glm::quat(u(rng), u(rng), u(rng), u(rng))));
+        sk.scales.push_back(glm::vec3(1.0f + 0.1f * u(rng)));
+
+        glm::mat4 ib = glm::translate(glm::mat4(1.0f), glm::vec3(u(rng), u(rng), u(rng)));
+        sk.inverseBind.push_back(ib);
+        sk.inverseBindAffine.push_back(ToAffine(ib));
+        sk.slots.push_back(i);
+    }
+    return sk;
+}
+
+/* =========================
+   Paths Under Test
+   ========================= */
+
+static void RunGlm(
+    const BenchSkeleton& sk,
+    std::vector<glm::mat4>& locals,
+    std::vector<glm::mat4>& globals,
+    std::vector<glm::mat4>& palette)
+{
+    size_t n = sk.parents.size();
+    for (size_t i = 0; i < n; i++)
+        locals[i] =
+            glm::translate(glm::mat4(1), sk.translations[i]) *
+            glm::mat4_cast(sk.rotations[i]) *
+            glm::scale(glm::mat4(1), sk.scales[i]);
+
+    for (size_t i = 0; i < n; i++)
+        globals[i] = sk.parents[i] >= 0 ?
+            globals[sk.parents[i]] * locals[i] : locals[i];
+
+    for (size_t i = 0; i < n; i++)
+        palette[i] = globals[i] * sk.inverseBind[i];
+}
+
+static void RunKernels(
+    const BenchSkeleton& sk,
+    std::vector<Affine>& locals,
+    std::vector<Affine>& globals,
+    std::vector<glm::mat4>& palette)
+{
+    const SkinKernels& k = GetSkinKernels();
+    size_t n = sk.parents.size();
+
+    k.composeAffine(
+        sk.translations.data(), sk.rotations.data(), sk.scales.data(),
+        sk.slots.data(), n, locals.data());
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (sk.parents[i] >= 0)
+            MulAffine(globals[sk.parents[i]], locals[i], globals[i]);
+        else
+            globals[i] = locals[i];
+    }
+
+    k.buildPalette(
+        globals.data(), sk.slots.data(), sk.inverseBindAffine.data(),
+        n, palette.data());
+}
+
+template <typename F>
+static double NsPerJoint(int joints, int iterations, F&& body)
+{
+    for (int i = 0; i < iterations / 10; i++)   // warm-up
+        body();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++)
+        body();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / (static_cast<double>(iterations) * joints);
+}
+
+/* =========================
+   main
+   ========================= */
+
+int main()
+{
+    const int sizes[] = { 64, 256, 1024 };
+    const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2 };
+
+    std::printf("CPU best level: %s\n\n", SimdLevelName(DetectSimdLevel()));
+    std::printf("%8s %10s %10s %10s %10s   (ns/joint, TRS + hierarchy + palette)\n",
+        "joints", "glm", "Scalar", "SSE", "AVX2");
+
+    for (int joints : sizes)
+    {
+        BenchSkeleton sk = MakeSkeleton(joints);
+        int iterations = 4000000 / joints;
+
+        std::vector<glm::mat4> mLocals(joints), mGlobals(joints), palette(joints);
+        std::vector<Affine> aLocals(joints), aGlobals(joints);
+
+        double glmNs = NsPerJoint(joints, iterations,
+            [&] { RunGlm(sk, mLocals, mGlobals, palette); });
+        std::printf("%8d %10.2f", joints, glmNs);
+
+        std::vector<glm::mat4> reference = palette;
+
+        for (SimdLevel level : levels)
+        {
+            if (!SetSkinKernelLevel(level))
+            {
+                std::printf(" %10s", "n/a");
+                continue;
+            }
+
+            double ns = NsPerJoint(joints, iterations,
+                [&] { RunKernels(sk, aLocals, aGlobals, palette); });
+
+            float maxErr = 0.0f;
+            for (int j = 0; j < joints; j++)
+                for (int c = 0; c < 4; c++)
+                    maxErr = glm::max(maxErr, glm::length(palette[j][c] - reference[j][c]));
+
+            std::printf(" %10.2f", ns);
+            if (maxErr > 1e-3f)
+                std::printf("(!%g)", maxErr);
+        }
+        std::printf("\n");
+    }
+
+    SetSkinKernelLevel(DetectSimdLevel());
+    return 0;
+}
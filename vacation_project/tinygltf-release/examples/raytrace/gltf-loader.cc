@@ -90,7 +90,7 @@ bool LoadGLTF(const std::string &filename, float scale,
         const auto &indicesAccessor = model.accessors[meshPrimitive.indices];
         const auto &bufferView = model.bufferViews[indicesAccessor.bufferView];
         const auto &buffer = model.buffers[bufferView.buffer];
-        const auto dataAddress = buffer.data.data() + bufferView.byteOffset +
+        const auto dataAddress = buffer.Data() + bufferView.byteOffset +
                                  indicesAccessor.byteOffset;
         const auto byteStride = indicesAccessor.ByteStride(bufferView);
         const auto count = indicesAccessor.count;
@@ -192,7 +192,7 @@ bool LoadGLTF(const std::string &filename, float scale,
             const auto &bufferView =
                 model.bufferViews[attribAccessor.bufferView];
             const auto &buffer = model.buffers[bufferView.buffer];
-            const auto dataPtr = buffer.data.data() + bufferView.byteOffset +
+            const auto dataPtr = buffer.Data() + bufferView.byteOffset +
                                  attribAccessor.byteOffset;
             const auto byte_stride = attribAccessor.ByteStride(bufferView);
             const auto count = attribAccessor.count;
@@ -190,7 +190,8 @@ void RenderThread() {
     }
 
     if (gSceneDirty) {
-      gScene.Commit();
+      // Only node transforms have changed, so refit rather than rebuild.
+      gScene.Refit();
       gSceneDirty = false;
     }
 
@@ -42,6 +42,37 @@ THE SOFTWARE.
 #include <string>
 #include <vector>
 
+// Parallelized BVH build runs on std::thread, thus requires C++11.
+#ifndef NANORT_ENABLE_PARALLEL_BUILD
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && (_MSC_VER >= 1900))
+#define NANORT_ENABLE_PARALLEL_BUILD (1)
+#else
+#define NANORT_ENABLE_PARALLEL_BUILD (0)
+#endif
+#endif
+
+#if NANORT_ENABLE_PARALLEL_BUILD
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
+
+// SIMD paths for packet traversal. Define NANORT_NO_SIMD to use the
+// portable loops only.
+#ifndef NANORT_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define NANORT_USE_SSE2 (1)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define NANORT_USE_AVX (1)
+#include <immintrin.h>
+#endif
+#endif
+
 namespace nanort {
 
 #ifdef __clang__
@@ -51,10 +82,6 @@ namespace nanort {
 #endif
 #endif
 
-// Parallelized BVH build is not yet fully tested,
-// thus turn off if you face a problem when building BVH.
-#define NANORT_ENABLE_PARALLEL_BUILD (1)
-
 // ----------------------------------------------------------------------------
 // Small vector class useful for multi-threaded environment.
 //
@@ -385,6 +412,38 @@ class Ray {
   int dir_sign[3];  // filled internally
 };
 
+///
+/// Packet of `N` rays in SoA layout, traced together with
+/// BVHAccel::TraversePacket(). Rays in a packet should be coherent(e.g.
+/// neighboring primary rays) to benefit from packet traversal.
+/// Only lanes whose bit is set in `mask` are traced.
+/// `N` must be in [1, 32], and a multiple of 4(8 with AVX) to use SIMD.
+///
+template <typename T = float, int N = 8>
+class RayPacket {
+ public:
+  RayPacket() : mask(N >= 32 ? 0xffffffffu : ((1u << N) - 1u)) {
+    for (int i = 0; i < N; i++) {
+      org[0][i] = static_cast<T>(0.0);
+      org[1][i] = static_cast<T>(0.0);
+      org[2][i] = static_cast<T>(0.0);
+      dir[0][i] = static_cast<T>(0.0);
+      dir[1][i] = static_cast<T>(0.0);
+      dir[2][i] = static_cast<T>(-1.0);
+      min_t[i] = static_cast<T>(0.0);
+      max_t[i] = std::numeric_limits<T>::max();
+    }
+  }
+
+  static const int kWidth = N;
+
+  T org[3][N];        // must set
+  T dir[3][N];        // must set
+  T min_t[N];         // minimum ray hit distance.
+  T max_t[N];         // maximum ray hit distance.
+  unsigned int mask;  // active lanes
+};
+
 template <typename T = float>
 class BVHNode {
  public:
@@ -452,9 +511,13 @@ struct BVHBuildOptions {
   unsigned int min_leaf_primitives;
   unsigned int max_tree_depth;
   unsigned int bin_size;
-  unsigned int shallow_depth;
+  unsigned int shallow_depth;  // Not used.
   unsigned int min_primitives_for_parallel_build;
 
+  // Number of threads for parallel build. 0 = hardware concurrency.
+  // The built BVH does not depend on this value.
+  unsigned int num_threads;
+
   // Cache bounding box computation.
   // Requires more memory, but BVHbuild can be faster.
   bool cache_bbox;
@@ -468,6 +531,7 @@ struct BVHBuildOptions {
         bin_size(64),
         shallow_depth(3),
         min_primitives_for_parallel_build(1024 * 128),
+        num_threads(0),
         cache_bbox(false) {}
 };
 
@@ -479,12 +543,36 @@ class BVHBuildStatistics {
   unsigned int num_branch_nodes;
   float build_secs;
 
+  // SAH cost of the tree relative to its root bounds, after Build() and
+  // after the latest Refit(). Their ratio tells how much refits degraded
+  // the tree.
+  float build_sah_cost;
+  float sah_cost;
+  unsigned int num_refits;
+
+  // Filled by WideBVHAccel::Build(): memory and expected traversal cost of
+  // the binary BVH and of the wide BVH collapsed from it. Cost is the
+  // surface area heuristic estimate of node fetches per ray.
+  unsigned int num_wide_nodes;
+  size_t binary_bytes;
+  size_t wide_bytes;
+  float binary_node_fetches;
+  float wide_node_fetches;
+
   // Set default value: Taabb = 0.2
   BVHBuildStatistics()
       : max_tree_depth(0),
         num_leaf_nodes(0),
         num_branch_nodes(0),
-        build_secs(0.0f) {}
+        build_secs(0.0f),
+        build_sah_cost(0.0f),
+        sah_cost(0.0f),
+        num_refits(0),
+        num_wide_nodes(0),
+        binary_bytes(0),
+        wide_bytes(0),
+        binary_node_fetches(0.0f),
+        wide_node_fetches(0.0f) {}
 };
 
 /// BVH trace option.
@@ -503,6 +591,135 @@ class BVHTraceOptions {
   }
 };
 
+#if NANORT_ENABLE_PARALLEL_BUILD
+///
+/// Work-stealing thread pool used by parallel BVH build.
+/// Each thread owns a task queue: it runs its own newest task first and
+/// steals the oldest task of other threads when its queue is empty.
+/// Tasks receive the index of the thread running them, which they pass to
+/// Spawn() and ParallelFor(). The thread owning the pool has index 0.
+///
+class TaskPool {
+ public:
+  typedef std::function<void(int)> Task;
+
+  explicit TaskPool(unsigned int num_threads)
+      : num_tasks_(0), stop_(false) {
+    if (num_threads == 0) num_threads = 1;
+    for (unsigned int i = 0; i < num_threads; i++) {
+      queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (unsigned int i = 1; i < num_threads; i++) {
+      workers_.push_back(std::thread(&TaskPool::WorkerLoop, this, int(i)));
+    }
+  }
+
+  ~TaskPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (size_t i = 0; i < workers_.size(); i++) {
+      workers_[i].join();
+    }
+  }
+
+  int NumThreads() const { return static_cast<int>(queues_.size()); }
+
+  /// Queue `task` on thread `self`.
+  void Spawn(int self, const Task &task) {
+    {
+      std::lock_guard<std::mutex> lock(queues_[size_t(self)]->mutex);
+      queues_[size_t(self)]->tasks.push_back(task);
+    }
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      num_tasks_++;
+    }
+    wake_.notify_one();
+  }
+
+  /// Run tasks on thread `self` until `pending` drops to zero.
+  void Wait(int self, const std::atomic<int> &pending) {
+    while (pending.load() > 0) {
+      if (!RunOne(self)) std::this_thread::yield();
+    }
+  }
+
+  /// Call `f(i)` for i in [0, count) in parallel and wait for all of them.
+  template <class F>
+  void ParallelFor(int self, int count, const F &f) {
+    std::atomic<int> pending(count);
+    for (int i = 1; i < count; i++) {
+      Spawn(self, [&f, &pending, i](int) {
+        f(i);
+        pending--;
+      });
+    }
+    if (count > 0) {
+      f(0);
+      pending--;
+    }
+    Wait(self, pending);
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool RunOne(int self) {
+    Task task;
+    {
+      Queue &own = *queues_[size_t(self)];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        task = own.tasks.back();
+        own.tasks.pop_back();
+      }
+    }
+
+    for (int i = 1; !task && (i < NumThreads()); i++) {
+      Queue &victim = *queues_[size_t((self + i) % NumThreads())];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+      }
+    }
+
+    if (!task) return false;
+
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      num_tasks_--;
+    }
+    task(self);
+    return true;
+  }
+
+  void WorkerLoop(int self) {
+    for (;;) {
+      if (RunOne(self)) continue;
+
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      wake_.wait(lock, [this] { return stop_ || (num_tasks_ > 0); });
+      if (stop_) return;
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue> > queues_;
+  std::vector<std::thread> workers_;
+
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  int num_tasks_;  // queued tasks, guarded by sleep_mutex_
+  bool stop_;
+};
+#endif
+
 template <typename T>
 class BBox {
  public:
@@ -565,11 +782,25 @@ class BVHAccel {
   bool Build(const unsigned int num_primitives, const P &p, const Pred &pred,
              const BVHBuildOptions<T> &options = BVHBuildOptions<T>());
 
+  ///
+  /// Update bounds of built BVH in place for moved primitives(e.g. deformed
+  /// mesh). Tree topology and primitive order are kept, so the tree gets
+  /// less efficient as primitives move away from where it was built.
+  /// `p` must provide the same primitives as in Build().
+  ///
+  template <class P>
+  bool Refit(const P &p);
+
   ///
   /// Get statistics of built BVH tree. Valid after Build()
   ///
   BVHBuildStatistics GetStatistics() const { return stats_; }
 
+  ///
+  /// SAH cost of the tree relative to its root bounds.
+  ///
+  T ComputeSAHCost() const;
+
   ///
   /// Dump built BVH to the file.
   ///
@@ -590,6 +821,17 @@ class BVHAccel {
   bool Traverse(const Ray<T> &ray, const I &intersector, H *isect,
                 const BVHTraceOptions &options = BVHTraceOptions()) const;
 
+  ///
+  /// Traverse into BVH with a packet of rays and find closest hit point &
+  /// primitive for each active lane.
+  /// `isects` must have room for `N` elements.
+  /// Returns the bit mask of lanes which hit something.
+  ///
+  template <int N, class I, class H>
+  unsigned int TraversePacket(
+      const RayPacket<T, N> &packet, const I &intersector, H *isects,
+      const BVHTraceOptions &options = BVHTraceOptions()) const;
+
 #if 0
   /// Multi-hit ray traversal
   /// Returns `max_intersections` frontmost intersections
@@ -634,22 +876,27 @@ class BVHAccel {
 
  private:
 #if NANORT_ENABLE_PARALLEL_BUILD
-  typedef struct {
-    unsigned int left_idx;
-    unsigned int right_idx;
-    unsigned int offset;
-  } ShallowNodeInfo;
+  // Part of the BVH built by one task: either a branch node whose children
+  // are built by other tasks, or a subtree built with BuildTree().
+  struct BuildFragment {
+    BVHNode<T> node;
+    std::unique_ptr<BuildFragment> children[2];
 
-  // Used only during BVH construction
-  std::vector<ShallowNodeInfo> shallow_node_infos_;
+    std::vector<BVHNode<T> > subtree;
+    BVHBuildStatistics stats;
+  };
 
-  /// Builds shallow BVH tree recursively.
+  /// Builds the fragment of [left_idx, right_idx) and spawns tasks for its
+  /// children.
   template <class P, class Pred>
-  unsigned int BuildShallowTree(std::vector<BVHNode<T> > *out_nodes,
-                                unsigned int left_idx, unsigned int right_idx,
-                                unsigned int depth,
-                                unsigned int max_shallow_depth, const P &p,
-                                const Pred &pred);
+  void BuildFragmentTask(TaskPool *pool, int self, std::atomic<int> *pending,
+                         BuildFragment *fragment, unsigned int left_idx,
+                         unsigned int right_idx, unsigned int depth,
+                         const P &p, const Pred &pred);
+
+  /// Appends built fragments to `out_nodes` in depth first order.
+  unsigned int JoinFragment(const BuildFragment &fragment,
+                            std::vector<BVHNode<T> > *out_nodes);
 #endif
 
   /// Builds BVH tree recursively.
@@ -663,6 +910,11 @@ class BVHAccel {
   bool TestLeafNode(const BVHNode<T> &node, const Ray<T> &ray,
                     const I &intersector) const;
 
+  template <int N, class I>
+  unsigned int TestLeafNodePacket(const BVHNode<T> &node, T *hit_t,
+                                  unsigned int mask,
+                                  const I &intersector) const;
+
   template <class I>
   bool TestLeafNodeIntersections(
       const BVHNode<T> &node, const Ray<T> &ray, const int max_intersections,
@@ -686,6 +938,74 @@ class BVHAccel {
   unsigned int pad0_;
 };
 
+///
+/// Node of WideBVHAccel. Bounds of up to `W` children are stored as SoA and
+/// quantized to `Q`(unsigned char or unsigned short) relative to the bounds
+/// of the node: child bmin[k] = origin[k] + qmin[k][i] * scale[k].
+///
+template <typename T = float, int W = 4, typename Q = unsigned char>
+class WideBVHNode {
+ public:
+  T origin[3];
+  T scale[3];
+  Q qmin[3][W];
+  Q qmax[3][W];
+
+  // count[i] == 0 : child[i] is the index of a wide node
+  // count[i] > 0  : child[i] is the offset of `count[i]` primitive indices
+  unsigned int child[W];
+  unsigned int count[W];
+  unsigned int num_children;
+};
+
+///
+/// `W`-wide(4 or 8) BVH collapsed from a built BVHAccel. A node fetch
+/// tests all children at once(SSE2/AVX for float) and quantized bounds
+/// keep nodes small, so traversal visits fewer and more compact nodes than
+/// the binary BVH.
+/// Traverse() accepts the same intersectors as BVHAccel::Traverse().
+///
+template <typename T = float, int W = 4, typename Q = unsigned char>
+class WideBVHAccel {
+ public:
+  WideBVHAccel() {}
+  ~WideBVHAccel() {}
+
+  ///
+  /// Collapse built `bvh` into the wide layout. `bvh` is not referenced
+  /// afterwards.
+  ///
+  bool Build(const BVHAccel<T> &bvh);
+
+  ///
+  /// Get statistics of the source BVH, plus the memory and cost comparison
+  /// of both layouts. Valid after Build()
+  ///
+  BVHBuildStatistics GetStatistics() const { return stats_; }
+
+  ///
+  /// Traverse into BVH along ray and find closest hit point & primitive if
+  /// found
+  ///
+  template <class I, class H>
+  bool Traverse(const Ray<T> &ray, const I &intersector, H *isect,
+                const BVHTraceOptions &options = BVHTraceOptions()) const;
+
+  const std::vector<WideBVHNode<T, W, Q> > &GetNodes() const { return nodes_; }
+  const std::vector<unsigned int> &GetIndices() const { return indices_; }
+
+  bool IsValid() const { return nodes_.size() > 0; }
+
+ private:
+  /// Collapses the binary subtree at `index` and returns its wide node.
+  unsigned int Collapse(const std::vector<BVHNode<T> > &nodes,
+                        unsigned int index, T inv_root_area);
+
+  std::vector<WideBVHNode<T, W, Q> > nodes_;
+  std::vector<unsigned int> indices_;
+  BVHBuildStatistics stats_;
+};
+
 // Predefined SAH predicator for triangle.
 template <typename T = float>
 class TriangleSAHPred {
@@ -987,6 +1307,314 @@ class TriangleIntersector {
   int _pad_;
 };
 
+///
+/// Packet version of TriangleIntersector for BVHAccel::TraversePacket().
+/// Each lane runs the same watertight test as TriangleIntersector. When all
+/// active lanes share the dominant axis of the ray direction(the common case
+/// for primary rays), the test is done in a SoA loop over lanes which the
+/// compiler can vectorize.
+///
+template <typename T = float, int N = 8, class H = TriangleIntersection<T> >
+class TrianglePacketIntersector {
+ public:
+  TrianglePacketIntersector(const T *vertices, const unsigned int *faces,
+                            const size_t vertex_stride_bytes)
+      : vertices_(vertices),
+        faces_(faces),
+        vertex_stride_bytes_(vertex_stride_bytes) {}
+
+  /// Do ray interesection stuff for `prim_index` th primitive against the
+  /// lanes in `mask`.
+  /// Updates `t_inout[lane]` and varycentric coordinate of lanes with a
+  /// closer hit, and returns the bit mask of them.
+  unsigned int Intersect(T *t_inout, const unsigned int prim_index,
+                         const unsigned int mask) const {
+    if ((prim_index < trace_options_.prim_ids_range[0]) ||
+        (prim_index >= trace_options_.prim_ids_range[1])) {
+      return 0;
+    }
+
+    const unsigned int f0 = faces_[3 * prim_index + 0];
+    const unsigned int f1 = faces_[3 * prim_index + 1];
+    const unsigned int f2 = faces_[3 * prim_index + 2];
+
+    const real3<T> p0(get_vertex_addr(vertices_, f0 + 0, vertex_stride_bytes_));
+    const real3<T> p1(get_vertex_addr(vertices_, f1 + 0, vertex_stride_bytes_));
+    const real3<T> p2(get_vertex_addr(vertices_, f2 + 0, vertex_stride_bytes_));
+
+    unsigned int hits = 0;
+
+    if (!coherent_) {
+      for (int i = 0; i < N; i++) {
+        if ((mask & (1u << i)) && IntersectLane(i, p0, p1, p2, &t_inout[i])) {
+          hits |= (1u << i);
+        }
+      }
+      return hits;
+    }
+
+    const int kx = kx_[first_lane_];
+    const int ky = ky_[first_lane_];
+    const int kz = kz_[first_lane_];
+
+    T U[N], V[N], W[N], D[N];
+    for (int i = 0; i < N; i++) {
+      const T Ax = (p0[kx] - ray_org_[kx][i]) - Sx_[i] * (p0[kz] - ray_org_[kz][i]);
+      const T Ay = (p0[ky] - ray_org_[ky][i]) - Sy_[i] * (p0[kz] - ray_org_[kz][i]);
+      const T Bx = (p1[kx] - ray_org_[kx][i]) - Sx_[i] * (p1[kz] - ray_org_[kz][i]);
+      const T By = (p1[ky] - ray_org_[ky][i]) - Sy_[i] * (p1[kz] - ray_org_[kz][i]);
+      const T Cx = (p2[kx] - ray_org_[kx][i]) - Sx_[i] * (p2[kz] - ray_org_[kz][i]);
+      const T Cy = (p2[ky] - ray_org_[ky][i]) - Sy_[i] * (p2[kz] - ray_org_[kz][i]);
+
+      U[i] = Cx * By - Cy * Bx;
+      V[i] = Ax * Cy - Ay * Cx;
+      W[i] = Bx * Ay - By * Ax;
+
+      const T Az = Sz_[i] * (p0[kz] - ray_org_[kz][i]);
+      const T Bz = Sz_[i] * (p1[kz] - ray_org_[kz][i]);
+      const T Cz = Sz_[i] * (p2[kz] - ray_org_[kz][i]);
+      D[i] = U[i] * Az + V[i] * Bz + W[i] * Cz;
+    }
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wfloat-equal"
+#endif
+
+    for (int i = 0; i < N; i++) {
+      if (!(mask & (1u << i))) continue;
+
+      bool hit;
+      if (U[i] == static_cast<T>(0.0) || V[i] == static_cast<T>(0.0) ||
+          W[i] == static_cast<T>(0.0)) {
+        // Needs the double precision edge test. Rare, so do it per lane.
+        hit = IntersectLane(i, p0, p1, p2, &t_inout[i]);
+      } else {
+        hit = Accept(i, U[i], V[i], W[i], D[i], &t_inout[i]);
+      }
+
+      if (hit) hits |= (1u << i);
+    }
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+    return hits;
+  }
+
+  /// Update is called when initializing intesection and nearest hit is found.
+  void Update(const T *t, unsigned int prim_idx, unsigned int mask) const {
+    for (int i = 0; i < N; i++) {
+      if (mask & (1u << i)) {
+        t_[i] = t[i];
+        prim_id_[i] = prim_idx;
+      }
+    }
+  }
+
+  /// Prepare BVH traversal(e.g. compute shear constants for each lane)
+  /// This function is called only once in BVH traversal.
+  void PrepareTraversal(const RayPacket<T, N> &packet,
+                        const BVHTraceOptions &trace_options) const {
+    first_lane_ = -1;
+    coherent_ = true;
+
+    for (int i = 0; i < N; i++) {
+      ray_org_[0][i] = packet.org[0][i];
+      ray_org_[1][i] = packet.org[1][i];
+      ray_org_[2][i] = packet.org[2][i];
+
+      // Same as TriangleIntersector::PrepareTraversal()
+      int kz = 0;
+      T absDir = std::fabs(packet.dir[0][i]);
+      if (absDir < std::fabs(packet.dir[1][i])) {
+        kz = 1;
+        absDir = std::fabs(packet.dir[1][i]);
+      }
+      if (absDir < std::fabs(packet.dir[2][i])) {
+        kz = 2;
+        absDir = std::fabs(packet.dir[2][i]);
+      }
+
+      int kx = kz + 1;
+      if (kx == 3) kx = 0;
+      int ky = kx + 1;
+      if (ky == 3) ky = 0;
+
+      if (packet.dir[kz][i] < 0.0f) std::swap(kx, ky);
+
+      kx_[i] = kx;
+      ky_[i] = ky;
+      kz_[i] = kz;
+
+      Sx_[i] = packet.dir[kx][i] / packet.dir[kz][i];
+      Sy_[i] = packet.dir[ky][i] / packet.dir[kz][i];
+      Sz_[i] = 1.0f / packet.dir[kz][i];
+
+      t_min_[i] = packet.min_t[i];
+      t_[i] = packet.max_t[i];
+      u_[i] = 0.0f;
+      v_[i] = 0.0f;
+      prim_id_[i] = static_cast<unsigned int>(-1);
+
+      if (packet.mask & (1u << i)) {
+        if (first_lane_ < 0) {
+          first_lane_ = i;
+        } else if ((kx != kx_[first_lane_]) || (ky != ky_[first_lane_]) ||
+                   (kz != kz_[first_lane_])) {
+          coherent_ = false;
+        }
+      }
+    }
+
+    if (first_lane_ < 0) first_lane_ = 0;
+
+    trace_options_ = trace_options;
+  }
+
+  /// Post BVH traversal stuff.
+  /// Fill `isects[lane]` for lanes in `hit_mask`.
+  void PostTraversal(const RayPacket<T, N> &packet, unsigned int hit_mask,
+                     H *isects) const {
+    if (!isects) return;
+
+    for (int i = 0; i < N; i++) {
+      if (hit_mask & (1u << i)) {
+        isects[i].t = t_[i];
+        isects[i].u = u_[i];
+        isects[i].v = v_[i];
+        isects[i].prim_id = prim_id_[i];
+      }
+    }
+    (void)packet;
+  }
+
+ private:
+  // Scalar watertight test for lane `i`.
+  bool IntersectLane(int i, const real3<T> &p0, const real3<T> &p1,
+                     const real3<T> &p2, T *t_inout) const {
+    real3<T> org(ray_org_[0][i], ray_org_[1][i], ray_org_[2][i]);
+    const real3<T> A = p0 - org;
+    const real3<T> B = p1 - org;
+    const real3<T> C = p2 - org;
+
+    const int kx = kx_[i];
+    const int ky = ky_[i];
+    const int kz = kz_[i];
+
+    const T Ax = A[kx] - Sx_[i] * A[kz];
+    const T Ay = A[ky] - Sy_[i] * A[kz];
+    const T Bx = B[kx] - Sx_[i] * B[kz];
+    const T By = B[ky] - Sy_[i] * B[kz];
+    const T Cx = C[kx] - Sx_[i] * C[kz];
+    const T Cy = C[ky] - Sy_[i] * C[kz];
+
+    T U = Cx * By - Cy * Bx;
+    T V = Ax * Cy - Ay * Cx;
+    T W = Bx * Ay - By * Ax;
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wfloat-equal"
+#endif
+
+    // Fall back to test against edges using double precision.
+    if (U == static_cast<T>(0.0) || V == static_cast<T>(0.0) ||
+        W == static_cast<T>(0.0)) {
+      double CxBy = static_cast<double>(Cx) * static_cast<double>(By);
+      double CyBx = static_cast<double>(Cy) * static_cast<double>(Bx);
+      U = static_cast<T>(CxBy - CyBx);
+
+      double AxCy = static_cast<double>(Ax) * static_cast<double>(Cy);
+      double AyCx = static_cast<double>(Ay) * static_cast<double>(Cx);
+      V = static_cast<T>(AxCy - AyCx);
+
+      double BxAy = static_cast<double>(Bx) * static_cast<double>(Ay);
+      double ByAx = static_cast<double>(By) * static_cast<double>(Ax);
+      W = static_cast<T>(BxAy - ByAx);
+    }
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+    const T Az = Sz_[i] * A[kz];
+    const T Bz = Sz_[i] * B[kz];
+    const T Cz = Sz_[i] * C[kz];
+    const T D = U * Az + V * Bz + W * Cz;
+
+    return Accept(i, U, V, W, D, t_inout);
+  }
+
+  // Edge sign, determinant and distance tests of lane `i`.
+  bool Accept(int i, T U, T V, T W, T D, T *t_inout) const {
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wfloat-equal"
+#endif
+
+    if (trace_options_.cull_back_face) {
+      if (U < static_cast<T>(0.0) || V < static_cast<T>(0.0) ||
+          W < static_cast<T>(0.0))
+        return false;
+    } else {
+      if ((U < static_cast<T>(0.0) || V < static_cast<T>(0.0) ||
+           W < static_cast<T>(0.0)) &&
+          (U > static_cast<T>(0.0) || V > static_cast<T>(0.0) ||
+           W > static_cast<T>(0.0))) {
+        return false;
+      }
+    }
+
+    T det = U + V + W;
+    if (det == static_cast<T>(0.0)) return false;
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+    const T rcpDet = static_cast<T>(1.0) / det;
+    T tt = D * rcpDet;
+
+    if (tt > (*t_inout)) {
+      return false;
+    }
+
+    if (tt < t_min_[i]) {
+      return false;
+    }
+
+    (*t_inout) = tt;
+    // u = V, v = W. See TriangleIntersector::Intersect()
+    u_[i] = V * rcpDet;
+    v_[i] = W * rcpDet;
+
+    return true;
+  }
+
+  const T *vertices_;
+  const unsigned int *faces_;
+  const size_t vertex_stride_bytes_;
+
+  mutable T ray_org_[3][N];
+  mutable T Sx_[N];
+  mutable T Sy_[N];
+  mutable T Sz_[N];
+  mutable int kx_[N];
+  mutable int ky_[N];
+  mutable int kz_[N];
+  mutable int first_lane_;
+  mutable bool coherent_;
+  mutable BVHTraceOptions trace_options_;
+  mutable T t_min_[N];
+
+  mutable T t_[N];
+  mutable T u_[N];
+  mutable T v_[N];
+  mutable unsigned int prim_id_[N];
+};
+
 //
 // Robust BVH Ray Traversal : http://jcgt.org/published/0002/02/02/paper.pdf
 //
@@ -1240,52 +1868,6 @@ inline bool FindCutFromBinBuffer(T *cut_pos,        // [out] xyz
   return true;
 }
 
-#ifdef _OPENMP
-template <typename T, class P>
-void ComputeBoundingBoxOMP(real3<T> *bmin, real3<T> *bmax,
-                           const unsigned int *indices, unsigned int left_index,
-                           unsigned int right_index, const P &p) {
-  { p.BoundingBox(bmin, bmax, indices[left_index]); }
-
-  T local_bmin[3] = {(*bmin)[0], (*bmin)[1], (*bmin)[2]};
-  T local_bmax[3] = {(*bmax)[0], (*bmax)[1], (*bmax)[2]};
-
-  unsigned int n = right_index - left_index;
-
-#pragma omp parallel firstprivate(local_bmin, local_bmax) if (n > (1024 * 128))
-  {
-#pragma omp for
-    for (int i = left_index; i < right_index; i++) {  // for each faces
-      unsigned int idx = indices[i];
-
-      real3<T> bbox_min, bbox_max;
-      p.BoundingBox(&bbox_min, &bbox_max, idx);
-      for (int k = 0; k < 3; k++) {  // xyz
-        if ((*bmin)[k] > bbox_min[k]) (*bmin)[k] = bbox_min[k];
-        if ((*bmax)[k] < bbox_max[k]) (*bmax)[k] = bbox_max[k];
-      }
-    }
-
-#pragma omp critical
-    {
-      for (int k = 0; k < 3; k++) {
-        if (local_bmin[k] < (*bmin)[k]) {
-          {
-            if (local_bmin[k] < (*bmin)[k]) (*bmin)[k] = local_bmin[k];
-          }
-        }
-
-        if (local_bmax[k] > (*bmax)[k]) {
-          {
-            if (local_bmax[k] > (*bmax)[k]) (*bmax)[k] = local_bmax[k];
-          }
-        }
-      }
-    }
-  }
-}
-#endif
-
 template <typename T, class P>
 inline void ComputeBoundingBox(real3<T> *bmin, real3<T> *bmax,
                                const unsigned int *indices,
@@ -1353,148 +1935,220 @@ inline void GetBoundingBox(real3<T> *bmin, real3<T> *bmax,
 //
 
 #if NANORT_ENABLE_PARALLEL_BUILD
+// Primitives per chunk of parallel bounding box, binning and partitioning.
+// Fixed so that the built BVH does not depend on the number of threads.
+const unsigned int kParallelBuildChunkSize = 1024 * 16;
+
+// Ranges up to this size are built by a single BuildTree() task.
+const unsigned int kParallelBuildTaskSize = 1024 * 4;
+
 template <typename T>
 template <class P, class Pred>
-unsigned int BVHAccel<T>::BuildShallowTree(std::vector<BVHNode<T> > *out_nodes,
-                                           unsigned int left_idx,
-                                           unsigned int right_idx,
-                                           unsigned int depth,
-                                           unsigned int max_shallow_depth,
-                                           const P &p, const Pred &pred) {
+void BVHAccel<T>::BuildFragmentTask(TaskPool *pool, int self,
+                                    std::atomic<int> *pending,
+                                    BuildFragment *fragment,
+                                    unsigned int left_idx,
+                                    unsigned int right_idx, unsigned int depth,
+                                    const P &p, const Pred &pred) {
   assert(left_idx <= right_idx);
 
-  unsigned int offset = static_cast<unsigned int>(out_nodes->size());
-
-  if (stats_.max_tree_depth < depth) {
-    stats_.max_tree_depth = depth;
-  }
-
-  real3<T> bmin, bmax;
-  ComputeBoundingBox(&bmin, &bmax, &indices_.at(0), left_idx, right_idx, p);
-
   unsigned int n = right_idx - left_idx;
-  if ((n <= options_.min_leaf_primitives) ||
-      (depth >= options_.max_tree_depth)) {
-    // Create leaf node.
-    BVHNode<T> leaf;
-
-    leaf.bmin[0] = bmin[0];
-    leaf.bmin[1] = bmin[1];
-    leaf.bmin[2] = bmin[2];
-
-    leaf.bmax[0] = bmax[0];
-    leaf.bmax[1] = bmax[1];
-    leaf.bmax[2] = bmax[2];
+  if ((n <= kParallelBuildTaskSize) || (depth >= options_.max_tree_depth)) {
+    // Pred::Set() is not thread-safe, so each task uses its own copy.
+    Pred local_pred(pred);
+    BuildTree(&fragment->stats, &fragment->subtree, left_idx, right_idx, depth,
+              p, local_pred);
+    return;
+  }
 
-    assert(left_idx < std::numeric_limits<unsigned int>::max());
+  unsigned int *indices = &indices_.at(0);
+  const int num_chunks =
+      static_cast<int>((n + kParallelBuildChunkSize - 1) / kParallelBuildChunkSize);
 
-    leaf.flag = 1;  // leaf
-    leaf.data[0] = n;
-    leaf.data[1] = left_idx;
+  //
+  // Compute bounding box per chunk, then merge.
+  //
+  std::vector<BBox<T> > chunk_bboxes(static_cast<size_t>(num_chunks));
+  pool->ParallelFor(self, num_chunks, [&](int c) {
+    unsigned int l = left_idx + static_cast<unsigned int>(c) * kParallelBuildChunkSize;
+    unsigned int r = std::min(right_idx, l + kParallelBuildChunkSize);
+    BBox<T> &bbox = chunk_bboxes[size_t(c)];
+    if (!bboxes_.empty()) {
+      GetBoundingBox(&bbox.bmin, &bbox.bmax, bboxes_, indices, l, r);
+    } else {
+      ComputeBoundingBox(&bbox.bmin, &bbox.bmax, indices, l, r, p);
+    }
+  });
 
-    out_nodes->push_back(leaf);  // atomic update
+  real3<T> bmin = chunk_bboxes[0].bmin;
+  real3<T> bmax = chunk_bboxes[0].bmax;
+  for (size_t c = 1; c < chunk_bboxes.size(); c++) {
+    for (int k = 0; k < 3; k++) {
+      bmin[k] = std::min(bmin[k], chunk_bboxes[c].bmin[k]);
+      bmax[k] = std::max(bmax[k], chunk_bboxes[c].bmax[k]);
+    }
+  }
 
-    stats_.num_leaf_nodes++;
+  //
+  // Compute SAH and find best split axis and position.
+  // Bins are filled per chunk and summed up.
+  //
+  std::vector<BinBuffer> chunk_bins(static_cast<size_t>(num_chunks),
+                                    BinBuffer(options_.bin_size));
+  pool->ParallelFor(self, num_chunks, [&](int c) {
+    unsigned int l = left_idx + static_cast<unsigned int>(c) * kParallelBuildChunkSize;
+    unsigned int r = std::min(right_idx, l + kParallelBuildChunkSize);
+    ContributeBinBuffer(&chunk_bins[size_t(c)], bmin, bmax, indices, l, r, p);
+  });
 
-    return offset;
+  BinBuffer bins(options_.bin_size);
+  for (size_t c = 0; c < chunk_bins.size(); c++) {
+    for (size_t i = 0; i < bins.bin.size(); i++) {
+      bins.bin[i] += chunk_bins[c].bin[i];
+    }
   }
 
+  int min_cut_axis = 0;
+  T cut_pos[3] = {0.0, 0.0, 0.0};
+  FindCutFromBinBuffer(cut_pos, &min_cut_axis, &bins, bmin, bmax, n,
+                       options_.cost_t_aabb);
+
   //
-  // Create branch node.
+  // Try all 3 axis until good cut position avaiable.
+  // Partition is stable: count per chunk, then scatter through `scratch`.
   //
-  if (depth >= max_shallow_depth) {
-    // Delay to build tree
-    ShallowNodeInfo info;
-    info.left_idx = left_idx;
-    info.right_idx = right_idx;
-    info.offset = offset;
-    shallow_node_infos_.push_back(info);
-
-    // Add dummy node.
-    BVHNode<T> node;
-    node.axis = -1;
-    node.flag = -1;
-    out_nodes->push_back(node);
+  std::vector<unsigned char> is_left(n);
+  std::vector<unsigned int> chunk_left(static_cast<size_t>(num_chunks));
+  std::vector<unsigned int> scratch;
 
-    return offset;
+  unsigned int mid_idx = left_idx;
+  int cut_axis = min_cut_axis;
+  for (int axis_try = 0; axis_try < 3; axis_try++) {
+    // try min_cut_axis first.
+    cut_axis = (min_cut_axis + axis_try) % 3;
 
-  } else {
-    //
-    // Compute SAH and find best split axis and position
-    //
-    int min_cut_axis = 0;
-    T cut_pos[3] = {0.0, 0.0, 0.0};
-
-    BinBuffer bins(options_.bin_size);
-    ContributeBinBuffer(&bins, bmin, bmax, &indices_.at(0), left_idx, right_idx,
-                        p);
-    FindCutFromBinBuffer(cut_pos, &min_cut_axis, &bins, bmin, bmax, n,
-                         options_.cost_t_aabb);
-
-    // Try all 3 axis until good cut position avaiable.
-    unsigned int mid_idx = left_idx;
-    int cut_axis = min_cut_axis;
-    for (int axis_try = 0; axis_try < 3; axis_try++) {
-      unsigned int *begin = &indices_[left_idx];
-      unsigned int *end =
-          &indices_[right_idx - 1] + 1;  // mimics end() iterator.
-      unsigned int *mid = 0;
-
-      // try min_cut_axis first.
-      cut_axis = (min_cut_axis + axis_try) % 3;
-
-      // @fixme { We want some thing like: std::partition(begin, end,
-      // pred(cut_axis, cut_pos[cut_axis])); }
-      pred.Set(cut_axis, cut_pos[cut_axis]);
-      //
-      // Split at (cut_axis, cut_pos)
-      // indices_ will be modified.
-      //
-      mid = std::partition(begin, end, pred);
+    pool->ParallelFor(self, num_chunks, [&](int c) {
+      unsigned int l = left_idx + static_cast<unsigned int>(c) * kParallelBuildChunkSize;
+      unsigned int r = std::min(right_idx, l + kParallelBuildChunkSize);
+      Pred local_pred(pred);
+      local_pred.Set(cut_axis, cut_pos[cut_axis]);
+      unsigned int count = 0;
+      for (unsigned int i = l; i < r; i++) {
+        is_left[i - left_idx] = local_pred(indices[i]) ? 1 : 0;
+        count += is_left[i - left_idx];
+      }
+      chunk_left[size_t(c)] = count;
+    });
 
-      mid_idx = left_idx + static_cast<unsigned int>((mid - begin));
-      if ((mid_idx == left_idx) || (mid_idx == right_idx)) {
-        // Can't split well.
-        // Switch to object median(which may create unoptimized tree, but
-        // stable)
-        mid_idx = left_idx + (n >> 1);
+    unsigned int num_left = 0;
+    for (size_t c = 0; c < chunk_left.size(); c++) {
+      num_left += chunk_left[c];
+    }
 
-        // Try another axis if there's axis to try.
+    if ((num_left == 0) || (num_left == n)) {
+      // Can't split well.
+      // Switch to object median(which may create unoptimized tree, but
+      // stable)
+      mid_idx = left_idx + (n >> 1);
 
-      } else {
-        // Found good cut. exit loop.
-        break;
-      }
+      // Try another axis to find better cut.
+      continue;
     }
 
-    BVHNode<T> node;
-    node.axis = cut_axis;
-    node.flag = 0;  // 0 = branch
+    scratch.resize(n);
+    pool->ParallelFor(self, num_chunks, [&](int c) {
+      unsigned int first = static_cast<unsigned int>(c) * kParallelBuildChunkSize;
+      unsigned int last = std::min(n, first + kParallelBuildChunkSize);
 
-    out_nodes->push_back(node);
+      unsigned int left_out = 0;
+      for (int i = 0; i < c; i++) left_out += chunk_left[size_t(i)];
+      unsigned int right_out = num_left + (first - left_out);
 
-    unsigned int left_child_index = 0;
-    unsigned int right_child_index = 0;
+      for (unsigned int i = first; i < last; i++) {
+        if (is_left[i]) {
+          scratch[left_out++] = indices[left_idx + i];
+        } else {
+          scratch[right_out++] = indices[left_idx + i];
+        }
+      }
+    });
 
-    left_child_index = BuildShallowTree(out_nodes, left_idx, mid_idx, depth + 1,
-                                        max_shallow_depth, p, pred);
+    pool->ParallelFor(self, num_chunks, [&](int c) {
+      unsigned int first = static_cast<unsigned int>(c) * kParallelBuildChunkSize;
+      unsigned int last = std::min(n, first + kParallelBuildChunkSize);
+      std::copy(scratch.begin() + first, scratch.begin() + last,
+                indices + left_idx + first);
+    });
 
-    right_child_index = BuildShallowTree(out_nodes, mid_idx, right_idx,
-                                         depth + 1, max_shallow_depth, p, pred);
+    // Found good cut. exit loop.
+    mid_idx = left_idx + num_left;
+    break;
+  }
 
-    (*out_nodes)[offset].data[0] = left_child_index;
-    (*out_nodes)[offset].data[1] = right_child_index;
+  BVHNode<T> &node = fragment->node;
+  node.axis = cut_axis;
+  node.flag = 0;  // 0 = branch
+  node.bmin[0] = bmin[0];
+  node.bmin[1] = bmin[1];
+  node.bmin[2] = bmin[2];
+  node.bmax[0] = bmax[0];
+  node.bmax[1] = bmax[1];
+  node.bmax[2] = bmax[2];
 
-    (*out_nodes)[offset].bmin[0] = bmin[0];
-    (*out_nodes)[offset].bmin[1] = bmin[1];
-    (*out_nodes)[offset].bmin[2] = bmin[2];
+  fragment->stats.max_tree_depth = depth;
+  fragment->stats.num_branch_nodes = 1;
 
-    (*out_nodes)[offset].bmax[0] = bmax[0];
-    (*out_nodes)[offset].bmax[1] = bmax[1];
-    (*out_nodes)[offset].bmax[2] = bmax[2];
+  //
+  // Build children in other tasks.
+  //
+  const unsigned int child_ranges[2][2] = {{left_idx, mid_idx},
+                                           {mid_idx, right_idx}};
+  (*pending) += 2;
+  for (int i = 0; i < 2; i++) {
+    fragment->children[i].reset(new BuildFragment());
+
+    BuildFragment *child = fragment->children[i].get();
+    const unsigned int l = child_ranges[i][0];
+    const unsigned int r = child_ranges[i][1];
+    pool->Spawn(self, [this, pool, pending, child, l, r, depth, &p,
+                       &pred](int thread) {
+      BuildFragmentTask(pool, thread, pending, child, l, r, depth + 1, p,
+                        pred);
+      (*pending)--;
+    });
+  }
+}
+
+template <typename T>
+unsigned int BVHAccel<T>::JoinFragment(const BuildFragment &fragment,
+                                       std::vector<BVHNode<T> > *out_nodes) {
+  unsigned int offset = static_cast<unsigned int>(out_nodes->size());
+
+  stats_.max_tree_depth =
+      std::max(stats_.max_tree_depth, fragment.stats.max_tree_depth);
+  stats_.num_leaf_nodes += fragment.stats.num_leaf_nodes;
+  stats_.num_branch_nodes += fragment.stats.num_branch_nodes;
+
+  if (!fragment.subtree.empty()) {
+    // Add offset to child index(for branch node).
+    for (size_t i = 0; i < fragment.subtree.size(); i++) {
+      out_nodes->push_back(fragment.subtree[i]);
+      if (fragment.subtree[i].flag == 0) {
+        out_nodes->back().data[0] += offset;
+        out_nodes->back().data[1] += offset;
+      }
+    }
+    return offset;
   }
 
-  stats_.num_branch_nodes++;
+  out_nodes->push_back(fragment.node);
+
+  unsigned int left_child_index = JoinFragment(*fragment.children[0], out_nodes);
+  unsigned int right_child_index =
+      JoinFragment(*fragment.children[1], out_nodes);
+
+  (*out_nodes)[offset].data[0] = left_child_index;
+  (*out_nodes)[offset].data[1] = right_child_index;
 
   return offset;
 }
@@ -1655,11 +2309,8 @@ bool BVHAccel<T>::Build(unsigned int num_primitives, const P &p,
   //
   indices_.resize(n);
 
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-  for (int i = 0; i < static_cast<int>(n); i++) {
-    indices_[static_cast<size_t>(i)] = static_cast<unsigned int>(i);
+  for (unsigned int i = 0; i < n; i++) {
+    indices_[i] = i;
   }
 
   //
@@ -1689,89 +2340,137 @@ bool BVHAccel<T>::Build(unsigned int num_primitives, const P &p,
     }
 
   } else {
-#ifdef _OPENMP
-    ComputeBoundingBoxOMP(&bmin, &bmax, &indices_.at(0), 0, n, p);
-#else
     ComputeBoundingBox(&bmin, &bmax, &indices_.at(0), 0, n, p);
-#endif
   }
 
-//
-// 3. Build tree
-//
-#ifdef _OPENMP
+  //
+  // 3. Build tree
+  //
 #if NANORT_ENABLE_PARALLEL_BUILD
-
   // Do parallel build for enoughly large dataset.
   if (n > options.min_primitives_for_parallel_build) {
-    BuildShallowTree(&nodes_, 0, n, /* root depth */ 0, options.shallow_depth,
-                     p, pred);  // [0, n)
-
-    assert(shallow_node_infos_.size() > 0);
-
-    // Build deeper tree in parallel
-    std::vector<std::vector<BVHNode<T> > > local_nodes(
-        shallow_node_infos_.size());
-    std::vector<BVHBuildStatistics> local_stats(shallow_node_infos_.size());
-
-#pragma omp parallel for
-    for (int i = 0; i < static_cast<int>(shallow_node_infos_.size()); i++) {
-      unsigned int left_idx = shallow_node_infos_[i].left_idx;
-      unsigned int right_idx = shallow_node_infos_[i].right_idx;
-      BuildTree(&(local_stats[i]), &(local_nodes[i]), left_idx, right_idx,
-                options.shallow_depth, p, pred);
-    }
-
-    // Join local nodes
-    for (int i = 0; i < static_cast<int>(local_nodes.size()); i++) {
-      assert(!local_nodes[i].empty());
-      size_t offset = nodes_.size();
-
-      // Add offset to child index(for branch node).
-      for (size_t j = 0; j < local_nodes[i].size(); j++) {
-        if (local_nodes[i][j].flag == 0) {  // branch
-          local_nodes[i][j].data[0] += offset - 1;
-          local_nodes[i][j].data[1] += offset - 1;
-        }
-      }
-
-      // replace
-      nodes_[shallow_node_infos_[i].offset] = local_nodes[i][0];
-
-      // Skip root element of the local node.
-      nodes_.insert(nodes_.end(), local_nodes[i].begin() + 1,
-                    local_nodes[i].end());
+    unsigned int num_threads = options.num_threads;
+    if (num_threads == 0) {
+      num_threads = std::max(1U, std::thread::hardware_concurrency());
     }
 
-    // Join statistics
-    for (int i = 0; i < static_cast<int>(local_nodes.size()); i++) {
-      stats_.max_tree_depth =
-          std::max(stats_.max_tree_depth, local_stats[i].max_tree_depth);
-      stats_.num_leaf_nodes += local_stats[i].num_leaf_nodes;
-      stats_.num_branch_nodes += local_stats[i].num_branch_nodes;
-    }
+    TaskPool pool(num_threads);
 
+    BuildFragment root;
+    std::atomic<int> pending(0);
+    BuildFragmentTask(&pool, 0, &pending, &root, 0, n, /* root depth */ 0, p,
+                      pred);  // [0, n)
+    pool.Wait(0, pending);
+
+    JoinFragment(root, &nodes_);
   } else {
     BuildTree(&stats_, &nodes_, 0, n,
               /* root depth */ 0, p, pred);  // [0, n)
   }
-
-#else  // !NANORT_ENABLE_PARALLEL_BUILD
+#else
   {
     BuildTree(&stats_, &nodes_, 0, n,
               /* root depth */ 0, p, pred);  // [0, n)
   }
 #endif
-#else  // !_OPENMP
-  {
-    BuildTree(&stats_, &nodes_, 0, n,
-              /* root depth */ 0, p, pred);  // [0, n)
+
+  stats_.build_sah_cost = static_cast<float>(ComputeSAHCost());
+  stats_.sah_cost = stats_.build_sah_cost;
+
+  return true;
+}
+
+template <typename T>
+template <class P>
+bool BVHAccel<T>::Refit(const P &p) {
+  if (nodes_.empty()) {
+    return false;
+  }
+
+  if (!bboxes_.empty()) {
+    for (size_t i = 0; i < bboxes_.size(); i++) {
+      p.BoundingBox(&(bboxes_[i].bmin), &(bboxes_[i].bmax),
+                    static_cast<unsigned int>(i));
+    }
+  }
+
+  // Children are stored after their parent, so bottom-up is back to front.
+  for (size_t i = nodes_.size(); i-- > 0;) {
+    BVHNode<T> &node = nodes_[i];
+
+    real3<T> bmin, bmax;
+    if (node.flag == 1) {  // leaf
+      unsigned int left_idx = node.data[1];
+      unsigned int right_idx = node.data[1] + node.data[0];
+      if (left_idx == right_idx) continue;
+
+      if (!bboxes_.empty()) {
+        GetBoundingBox(&bmin, &bmax, bboxes_, &indices_.at(0), left_idx,
+                       right_idx);
+      } else {
+        ComputeBoundingBox(&bmin, &bmax, &indices_.at(0), left_idx, right_idx,
+                           p);
+      }
+    } else {  // branch
+      const BVHNode<T> &left = nodes_[node.data[0]];
+      const BVHNode<T> &right = nodes_[node.data[1]];
+      assert(node.data[0] > i);
+      assert(node.data[1] > i);
+
+      for (int k = 0; k < 3; k++) {
+        bmin[k] = std::min(left.bmin[k], right.bmin[k]);
+        bmax[k] = std::max(left.bmax[k], right.bmax[k]);
+      }
+    }
+
+    node.bmin[0] = bmin[0];
+    node.bmin[1] = bmin[1];
+    node.bmin[2] = bmin[2];
+
+    node.bmax[0] = bmax[0];
+    node.bmax[1] = bmax[1];
+    node.bmax[2] = bmax[2];
   }
-#endif
+
+  stats_.sah_cost = static_cast<float>(ComputeSAHCost());
+  stats_.num_refits++;
 
   return true;
 }
 
+template <typename T>
+T BVHAccel<T>::ComputeSAHCost() const {
+  if (nodes_.empty()) {
+    return static_cast<T>(0.0);
+  }
+
+  const real3<T> root_min(nodes_[0].bmin);
+  const real3<T> root_max(nodes_[0].bmax);
+  const T root_area = CalculateSurfaceArea(root_min, root_max);
+  if (!(root_area > static_cast<T>(0.0))) {
+    return static_cast<T>(0.0);
+  }
+
+  // Same costs as the SAH in BuildTree().
+  const T cost_t_aabb = options_.cost_t_aabb;
+  const T cost_t_tri = static_cast<T>(1.0) - cost_t_aabb;
+
+  T cost = static_cast<T>(0.0);
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    const real3<T> bmin(nodes_[i].bmin);
+    const real3<T> bmax(nodes_[i].bmax);
+    const T area = CalculateSurfaceArea(bmin, bmax) / root_area;
+
+    if (nodes_[i].flag == 0) {
+      cost += area * static_cast<T>(2.0) * cost_t_aabb;
+    } else {
+      cost += area * static_cast<T>(nodes_[i].data[0]) * cost_t_tri;
+    }
+  }
+
+  return cost;
+}
+
 template <typename T>
 void BVHAccel<T>::Debug() {
   for (size_t i = 0; i < indices_.size(); i++) {
@@ -1891,6 +2590,103 @@ inline bool IntersectRayAABB(T *tminOut,  // [out]
   return false;  // no hit
 }
 
+///
+/// Packet version of IntersectRayAABB().
+/// Tests lanes in `mask` against the box and returns the bit mask of lanes
+/// which hit it.
+///
+template <typename T, int N>
+inline unsigned int IntersectPacketAABB(const T bmin[3], const T bmax[3],
+                                        const T org[3][N],
+                                        const T inv_dir[3][N],
+                                        const T min_t[N], const T max_t[N],
+                                        unsigned int mask) {
+  unsigned int hit = 0;
+
+  for (int i = 0; i < N; i++) {
+    T tmin = min_t[i];
+    T tmax = max_t[i];
+
+    for (int k = 0; k < 3; k++) {
+      const T t0 = (bmin[k] - org[k][i]) * inv_dir[k][i];
+      const T t1 = (bmax[k] - org[k][i]) * inv_dir[k][i];
+
+      tmin = safemax(safemin(t0, t1), tmin);
+      // MaxMult robust BVH traversal(up to 4 ulp).
+      tmax = safemin(safemax(t0, t1) * static_cast<T>(1.00000024f), tmax);
+    }
+
+    if (tmin <= tmax) hit |= (1u << i);
+  }
+
+  return hit & mask;
+}
+
+#if defined(NANORT_USE_SSE2)
+template <int N>
+inline unsigned int IntersectPacketAABB(const float bmin[3],
+                                        const float bmax[3],
+                                        const float org[3][N],
+                                        const float inv_dir[3][N],
+                                        const float min_t[N],
+                                        const float max_t[N],
+                                        unsigned int mask) {
+  if ((N % 4) != 0) {
+    return IntersectPacketAABB<float, N>(bmin, bmax, org, inv_dir, min_t,
+                                         max_t, mask);
+  }
+
+  unsigned int hit = 0;
+
+#if defined(NANORT_USE_AVX)
+  if ((N % 8) == 0) {
+    const __m256 robust = _mm256_set1_ps(1.00000024f);
+    for (int i = 0; i < N; i += 8) {
+      if (((mask >> i) & 0xffu) == 0) continue;
+
+      __m256 tmin = _mm256_loadu_ps(min_t + i);
+      __m256 tmax = _mm256_loadu_ps(max_t + i);
+      for (int k = 0; k < 3; k++) {
+        const __m256 o = _mm256_loadu_ps(org[k] + i);
+        const __m256 inv = _mm256_loadu_ps(inv_dir[k] + i);
+        const __m256 t0 =
+            _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(bmin[k]), o), inv);
+        const __m256 t1 =
+            _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(bmax[k]), o), inv);
+        tmin = _mm256_max_ps(_mm256_min_ps(t0, t1), tmin);
+        tmax = _mm256_min_ps(_mm256_mul_ps(_mm256_max_ps(t0, t1), robust),
+                             tmax);
+      }
+      hit |= static_cast<unsigned int>(
+                 _mm256_movemask_ps(_mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ)))
+             << i;
+    }
+    return hit & mask;
+  }
+#endif
+
+  const __m128 robust = _mm_set1_ps(1.00000024f);
+  for (int i = 0; i < N; i += 4) {
+    if (((mask >> i) & 0xfu) == 0) continue;
+
+    __m128 tmin = _mm_loadu_ps(min_t + i);
+    __m128 tmax = _mm_loadu_ps(max_t + i);
+    for (int k = 0; k < 3; k++) {
+      const __m128 o = _mm_loadu_ps(org[k] + i);
+      const __m128 inv = _mm_loadu_ps(inv_dir[k] + i);
+      const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmin[k]), o), inv);
+      const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmax[k]), o), inv);
+      tmin = _mm_max_ps(_mm_min_ps(t0, t1), tmin);
+      tmax = _mm_min_ps(_mm_mul_ps(_mm_max_ps(t0, t1), robust), tmax);
+    }
+    hit |= static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(tmin, tmax)))
+           << i;
+  }
+
+  return hit & mask;
+}
+#endif
+
 template <typename T>
 template <class I>
 inline bool BVHAccel<T>::TestLeafNode(const BVHNode<T> &node, const Ray<T> &ray,
@@ -2073,6 +2869,112 @@ bool BVHAccel<T>::Traverse(const Ray<T> &ray, const I &intersector, H *isect,
   return hit;
 }
 
+template <typename T>
+template <int N, class I>
+inline unsigned int BVHAccel<T>::TestLeafNodePacket(
+    const BVHNode<T> &node, T *hit_t, unsigned int mask,
+    const I &intersector) const {
+  unsigned int hit = 0;
+
+  unsigned int num_primitives = node.data[0];
+  unsigned int offset = node.data[1];
+
+  for (unsigned int i = 0; i < num_primitives; i++) {
+    unsigned int prim_idx = indices_[i + offset];
+
+    // `hit_t` of hit lanes is updated by the intersector.
+    unsigned int lanes = intersector.Intersect(hit_t, prim_idx, mask);
+    if (lanes) {
+      intersector.Update(hit_t, prim_idx, lanes);
+      hit |= lanes;
+    }
+  }
+
+  return hit;
+}
+
+template <typename T>
+template <int N, class I, class H>
+unsigned int BVHAccel<T>::TraversePacket(const RayPacket<T, N> &packet,
+                                         const I &intersector, H *isects,
+                                         const BVHTraceOptions &options) const {
+  const int kMaxStackDepth = 512;
+
+  if (nodes_.empty() || (packet.mask == 0)) {
+    return 0;
+  }
+
+  T hit_t[N];
+  T ray_inv_dir[3][N];
+  for (int i = 0; i < N; i++) {
+    hit_t[i] = packet.max_t[i];
+
+    // @fixme { Check edge case; i.e., 1/0 }
+    ray_inv_dir[0][i] = 1.0f / (packet.dir[0][i] + 1.0e-12f);
+    ray_inv_dir[1][i] = 1.0f / (packet.dir[1][i] + 1.0e-12f);
+    ray_inv_dir[2][i] = 1.0f / (packet.dir[2][i] + 1.0e-12f);
+  }
+
+  intersector.PrepareTraversal(packet, options);
+
+  // Children are visited in the near-far order of the first active ray.
+  int first = 0;
+  while (!(packet.mask & (1u << first))) first++;
+
+  int dir_sign[3];
+  dir_sign[0] = packet.dir[0][first] < 0.0f ? 1 : 0;
+  dir_sign[1] = packet.dir[1][first] < 0.0f ? 1 : 0;
+  dir_sign[2] = packet.dir[2][first] < 0.0f ? 1 : 0;
+
+  // Each entry carries the lanes which hit its parent.
+  int node_stack_index = 0;
+  unsigned int node_stack[512];
+  unsigned int mask_stack[512];
+  node_stack[0] = 0;
+  mask_stack[0] = packet.mask;
+
+  while (node_stack_index >= 0) {
+    const BVHNode<T> &node = nodes_[node_stack[node_stack_index]];
+    const unsigned int active = mask_stack[node_stack_index];
+
+    node_stack_index--;
+
+    const unsigned int hit =
+        IntersectPacketAABB(node.bmin, node.bmax, packet.org, ray_inv_dir,
+                            packet.min_t, hit_t, active);
+    if (!hit) {
+      continue;
+    }
+
+    if (node.flag == 0) {  // branch node
+      int order_near = dir_sign[node.axis];
+      int order_far = 1 - order_near;
+
+      // Traverse near first.
+      node_stack[++node_stack_index] = node.data[order_far];
+      mask_stack[node_stack_index] = hit;
+      node_stack[++node_stack_index] = node.data[order_near];
+      mask_stack[node_stack_index] = hit;
+    } else {  // leaf node
+      TestLeafNodePacket<N>(node, hit_t, hit, intersector);
+    }
+  }
+
+  assert(node_stack_index < kMaxStackDepth);
+  (void)kMaxStackDepth;
+
+  unsigned int hit_mask = 0;
+  for (int i = 0; i < N; i++) {
+    if ((packet.mask & (1u << i)) && (hit_t[i] < packet.max_t[i])) {
+      hit_mask |= (1u << i);
+    }
+  }
+
+  intersector.PostTraversal(packet, hit_mask, isects);
+
+  return hit_mask;
+}
+
 template <typename T>
 template <class I>
 inline bool BVHAccel<T>::TestLeafNodeIntersections(
@@ -2304,6 +3206,411 @@ bool BVHAccel<T>::MultiHitTraverse(const Ray<T> &ray,
 }
 #endif
 
+template <typename T, typename Q>
+inline T WideBVHDequantize(T origin, T scale, Q q) {
+  return origin + static_cast<T>(q) * scale;
+}
+
+///
+/// Tests the children of a wide node. Stores the entry distance of each
+/// child to `tnear` and returns the bit mask of children hit.
+///
+template <typename T, int W, typename Q>
+inline unsigned int IntersectWideNode(const WideBVHNode<T, W, Q> &node,
+                                      const real3<T> &ray_org,
+                                      const real3<T> &ray_inv_dir, T min_t,
+                                      T max_t, T tnear[W]) {
+  unsigned int hit = 0;
+
+  for (int i = 0; i < W; i++) {
+    T tmin = min_t;
+    T tmax = max_t;
+
+    for (int k = 0; k < 3; k++) {
+      const T lo = WideBVHDequantize<T, Q>(node.origin[k], node.scale[k],
+                                              node.qmin[k][i]);
+      const T hi = WideBVHDequantize<T, Q>(node.origin[k], node.scale[k],
+                                              node.qmax[k][i]);
+      const T t0 = (lo - ray_org[k]) * ray_inv_dir[k];
+      const T t1 = (hi - ray_org[k]) * ray_inv_dir[k];
+
+      tmin = safemax(safemin(t0, t1), tmin);
+      // MaxMult robust BVH traversal(up to 4 ulp).
+      tmax = safemin(safemax(t0, t1) * static_cast<T>(1.00000024f), tmax);
+    }
+
+    tnear[i] = tmin;
+    if (tmin <= tmax) hit |= (1u << i);
+  }
+
+  return hit & ((1u << node.num_children) - 1u);
+}
+
+#if defined(NANORT_USE_SSE2)
+inline __m128 LoadQuantized4(const unsigned char *q) {
+  int bits;
+  memcpy(&bits, q, 4);
+  __m128i v = _mm_cvtsi32_si128(bits);
+  v = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+  v = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+  return _mm_cvtepi32_ps(v);
+}
+
+inline __m128 LoadQuantized4(const unsigned short *q) {
+  __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(q));
+  v = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+  return _mm_cvtepi32_ps(v);
+}
+
+template <int W, typename Q>
+inline unsigned int IntersectWideNode(const WideBVHNode<float, W, Q> &node,
+                                      const real3<float> &ray_org,
+                                      const real3<float> &ray_inv_dir,
+                                      float min_t, float max_t,
+                                      float tnear[W]) {
+  if ((W % 4) != 0) {
+    return IntersectWideNode<float, W, Q>(node, ray_org, ray_inv_dir, min_t,
+                                          max_t, tnear);
+  }
+
+  unsigned int hit = 0;
+
+#if defined(NANORT_USE_AVX)
+  if ((W % 8) == 0) {
+    const __m256 robust = _mm256_set1_ps(1.00000024f);
+    for (int i = 0; i < W; i += 8) {
+      __m256 tmin = _mm256_set1_ps(min_t);
+      __m256 tmax = _mm256_set1_ps(max_t);
+      for (int k = 0; k < 3; k++) {
+        const __m256 o = _mm256_set1_ps(ray_org[k]);
+        const __m256 inv = _mm256_set1_ps(ray_inv_dir[k]);
+        const __m256 origin = _mm256_set1_ps(node.origin[k]);
+        const __m256 scale = _mm256_set1_ps(node.scale[k]);
+        const __m256 qlo = _mm256_insertf128_ps(
+            _mm256_castps128_ps256(LoadQuantized4(node.qmin[k] + i)),
+            LoadQuantized4(node.qmin[k] + i + 4), 1);
+        const __m256 qhi = _mm256_insertf128_ps(
+            _mm256_castps128_ps256(LoadQuantized4(node.qmax[k] + i)),
+            LoadQuantized4(node.qmax[k] + i + 4), 1);
+        const __m256 lo = _mm256_add_ps(origin, _mm256_mul_ps(qlo, scale));
+        const __m256 hi = _mm256_add_ps(origin, _mm256_mul_ps(qhi, scale));
+        const __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(lo, o), inv);
+        const __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(hi, o), inv);
+        tmin = _mm256_max_ps(_mm256_min_ps(t0, t1), tmin);
+        tmax = _mm256_min_ps(_mm256_mul_ps(_mm256_max_ps(t0, t1), robust),
+                             tmax);
+      }
+      _mm256_storeu_ps(tnear + i, tmin);
+      hit |= static_cast<unsigned int>(
+                 _mm256_movemask_ps(_mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ)))
+             << i;
+    }
+    return hit & ((1u << node.num_children) - 1u);
+  }
+#endif
+
+  const __m128 robust = _mm_set1_ps(1.00000024f);
+  for (int i = 0; i < W; i += 4) {
+    __m128 tmin = _mm_set1_ps(min_t);
+    __m128 tmax = _mm_set1_ps(max_t);
+    for (int k = 0; k < 3; k++) {
+      const __m128 o = _mm_set1_ps(ray_org[k]);
+      const __m128 inv = _mm_set1_ps(ray_inv_dir[k]);
+      const __m128 origin = _mm_set1_ps(node.origin[k]);
+      const __m128 scale = _mm_set1_ps(node.scale[k]);
+      const __m128 lo = _mm_add_ps(
+          origin, _mm_mul_ps(LoadQuantized4(node.qmin[k] + i), scale));
+      const __m128 hi = _mm_add_ps(
+          origin, _mm_mul_ps(LoadQuantized4(node.qmax[k] + i), scale));
+      const __m128 t0 = _mm_mul_ps(_mm_sub_ps(lo, o), inv);
+      const __m128 t1 = _mm_mul_ps(_mm_sub_ps(hi, o), inv);
+      tmin = _mm_max_ps(_mm_min_ps(t0, t1), tmin);
+      tmax = _mm_min_ps(_mm_mul_ps(_mm_max_ps(t0, t1), robust), tmax);
+    }
+    _mm_storeu_ps(tnear + i, tmin);
+    hit |= static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(tmin, tmax)))
+           << i;
+  }
+
+  return hit & ((1u << node.num_children) - 1u);
+}
+#endif
+
+template <typename T, int W, typename Q>
+bool WideBVHAccel<T, W, Q>::Build(const BVHAccel<T> &bvh) {
+  nodes_.clear();
+  indices_.clear();
+  stats_ = BVHBuildStatistics();
+
+  if (!bvh.IsValid()) {
+    return false;
+  }
+
+  const std::vector<BVHNode<T> > &nodes = bvh.GetNodes();
+  indices_ = bvh.GetIndices();
+  stats_ = bvh.GetStatistics();
+
+  const real3<T> root_min(nodes[0].bmin);
+  const real3<T> root_max(nodes[0].bmax);
+  T root_area = CalculateSurfaceArea(root_min, root_max);
+  T inv_root_area = (root_area > static_cast<T>(0.0))
+                        ? static_cast<T>(1.0) / root_area
+                        : static_cast<T>(0.0);
+
+  // A binary node is fetched when its parent is hit.
+  T binary_fetches = static_cast<T>(1.0);
+  for (size_t i = 0; i < nodes.size(); i++) {
+    if (nodes[i].flag == 0) {
+      const real3<T> bmin(nodes[i].bmin);
+      const real3<T> bmax(nodes[i].bmax);
+      binary_fetches += static_cast<T>(2.0) *
+                        CalculateSurfaceArea(bmin, bmax) * inv_root_area;
+    }
+  }
+
+  stats_.wide_node_fetches = 0.0f;
+  Collapse(nodes, 0, inv_root_area);
+
+  stats_.num_wide_nodes = static_cast<unsigned int>(nodes_.size());
+  stats_.binary_bytes = nodes.size() * sizeof(BVHNode<T>) +
+                        indices_.size() * sizeof(unsigned int);
+  stats_.wide_bytes = nodes_.size() * sizeof(WideBVHNode<T, W, Q>) +
+                      indices_.size() * sizeof(unsigned int);
+  stats_.binary_node_fetches = static_cast<float>(binary_fetches);
+
+  return true;
+}
+
+template <typename T, int W, typename Q>
+unsigned int WideBVHAccel<T, W, Q>::Collapse(
+    const std::vector<BVHNode<T> > &nodes, unsigned int index,
+    T inv_root_area) {
+  const unsigned int wide_index = static_cast<unsigned int>(nodes_.size());
+  nodes_.push_back(WideBVHNode<T, W, Q>());
+
+  // Open the largest branch child until `W` children are collected.
+  unsigned int children[W];
+  int num_children = 0;
+  if (nodes[index].flag == 0) {
+    children[num_children++] = nodes[index].data[0];
+    children[num_children++] = nodes[index].data[1];
+
+    while (num_children < W) {
+      int best = -1;
+      T best_area = static_cast<T>(-1.0);
+      for (int i = 0; i < num_children; i++) {
+        const BVHNode<T> &child = nodes[children[i]];
+        if (child.flag == 0) {
+          const real3<T> bmin(child.bmin);
+          const real3<T> bmax(child.bmax);
+          T area = CalculateSurfaceArea(bmin, bmax);
+          if (area > best_area) {
+            best = i;
+            best_area = area;
+          }
+        }
+      }
+
+      if (best < 0) break;
+
+      const BVHNode<T> &opened = nodes[children[best]];
+      children[best] = opened.data[0];
+      children[num_children++] = opened.data[1];
+    }
+  } else {
+    children[num_children++] = index;  // leaf root
+  }
+
+  WideBVHNode<T, W, Q> node;
+  node.num_children = 0;
+
+  real3<T> bmin, bmax;
+  for (int k = 0; k < 3; k++) {
+    bmin[k] = std::numeric_limits<T>::max();
+    bmax[k] = -std::numeric_limits<T>::max();
+    for (int i = 0; i < num_children; i++) {
+      bmin[k] = std::min(bmin[k], nodes[children[i]].bmin[k]);
+      bmax[k] = std::max(bmax[k], nodes[children[i]].bmax[k]);
+    }
+  }
+
+  stats_.wide_node_fetches += static_cast<float>(
+      CalculateSurfaceArea(bmin, bmax) * inv_root_area);
+
+  // Quantization grid of the node. Rounded outwards so that dequantized
+  // child bounds always contain the exact bounds.
+  const T levels = static_cast<T>(std::numeric_limits<Q>::max());
+  for (int k = 0; k < 3; k++) {
+    node.origin[k] = bmin[k];
+    node.scale[k] = (bmax[k] - bmin[k]) / levels;
+    while (node.origin[k] + levels * node.scale[k] < bmax[k]) {
+      node.scale[k] *= static_cast<T>(1.0) +
+                       static_cast<T>(4.0) * std::numeric_limits<T>::epsilon();
+    }
+  }
+
+  for (int i = 0; i < W; i++) {
+    for (int k = 0; k < 3; k++) {
+      node.qmin[k][i] = static_cast<Q>(levels);
+      node.qmax[k][i] = 0;
+    }
+    node.child[i] = 0;
+    node.count[i] = 0;
+  }
+
+  for (int i = 0; i < num_children; i++) {
+    const BVHNode<T> &child = nodes[children[i]];
+
+    // Skip empty leaves.
+    if ((child.flag == 1) && (child.data[0] == 0)) continue;
+
+    const unsigned int slot = node.num_children++;
+
+    for (int k = 0; k < 3; k++) {
+      int qlo = 0;
+      int qhi = 0;
+      if (node.scale[k] > static_cast<T>(0.0)) {
+        qlo = static_cast<int>(
+            std::floor((child.bmin[k] - node.origin[k]) / node.scale[k]));
+        qhi = static_cast<int>(
+            std::ceil((child.bmax[k] - node.origin[k]) / node.scale[k]));
+        qlo = std::max(0, std::min(qlo, static_cast<int>(levels)));
+        qhi = std::max(0, std::min(qhi, static_cast<int>(levels)));
+
+        while ((qlo > 0) && (WideBVHDequantize<T, Q>(
+                                 node.origin[k], node.scale[k],
+                                 static_cast<Q>(qlo)) > child.bmin[k])) {
+          qlo--;
+        }
+        while ((qhi < static_cast<int>(levels)) &&
+               (WideBVHDequantize<T, Q>(node.origin[k], node.scale[k],
+                                           static_cast<Q>(qhi)) <
+                child.bmax[k])) {
+          qhi++;
+        }
+      }
+      node.qmin[k][slot] = static_cast<Q>(qlo);
+      node.qmax[k][slot] = static_cast<Q>(qhi);
+    }
+
+    if (child.flag == 1) {
+      node.child[slot] = child.data[1];
+      node.count[slot] = child.data[0];
+    } else {
+      node.child[slot] = Collapse(nodes, children[i], inv_root_area);
+      node.count[slot] = 0;
+    }
+  }
+
+  nodes_[wide_index] = node;
+
+  return wide_index;
+}
+
+template <typename T, int W, typename Q>
+template <class I, class H>
+bool WideBVHAccel<T, W, Q>::Traverse(const Ray<T> &ray, const I &intersector,
+                                     H *isect,
+                                     const BVHTraceOptions &options) const {
+  const int kMaxStackDepth = 1024;
+
+  T hit_t = ray.max_t;
+
+  // Init isect info as no hit
+  intersector.Update(hit_t, static_cast<unsigned int>(-1));
+
+  intersector.PrepareTraversal(ray, options);
+
+  if (nodes_.empty()) {
+    intersector.PostTraversal(ray, false, isect);
+    return false;
+  }
+
+  // @fixme { Check edge case; i.e., 1/0 }
+  real3<T> ray_inv_dir;
+  ray_inv_dir[0] = 1.0f / (ray.dir[0] + 1.0e-12f);
+  ray_inv_dir[1] = 1.0f / (ray.dir[1] + 1.0e-12f);
+  ray_inv_dir[2] = 1.0f / (ray.dir[2] + 1.0e-12f);
+
+  real3<T> ray_org;
+  ray_org[0] = ray.org[0];
+  ray_org[1] = ray.org[1];
+  ray_org[2] = ray.org[2];
+
+  // Entries are wide nodes(count == 0) or leaves, with their entry distance.
+  int stack_index = 0;
+  unsigned int stack_child[kMaxStackDepth];
+  unsigned int stack_count[kMaxStackDepth];
+  T stack_t[kMaxStackDepth];
+  stack_child[0] = 0;
+  stack_count[0] = 0;
+  stack_t[0] = ray.min_t;
+
+  while (stack_index >= 0) {
+    const unsigned int child = stack_child[stack_index];
+    const unsigned int count = stack_count[stack_index];
+    const T entry_t = stack_t[stack_index];
+
+    stack_index--;
+
+    // A closer hit was found after this entry was pushed.
+    if (entry_t > hit_t) continue;
+
+    if (count > 0) {  // leaf
+      T t = hit_t;
+      for (unsigned int i = 0; i < count; i++) {
+        unsigned int prim_idx = indices_[child + i];
+
+        T local_t = t;
+        if (intersector.Intersect(&local_t, prim_idx)) {
+          // Update isect state
+          t = local_t;
+
+          intersector.Update(t, prim_idx);
+        }
+      }
+      hit_t = t;
+      continue;
+    }
+
+    const WideBVHNode<T, W, Q> &node = nodes_[child];
+
+    T tnear[W];
+    unsigned int hit = IntersectWideNode(node, ray_org, ray_inv_dir,
+                                         ray.min_t, hit_t, tnear);
+    if (!hit) continue;
+
+    // Push hit children far to near, so the nearest is popped first.
+    int order[W];
+    int num_hits = 0;
+    for (int i = 0; i < W; i++) {
+      if (!(hit & (1u << i))) continue;
+
+      int j = num_hits++;
+      while ((j > 0) && (tnear[order[j - 1]] < tnear[i])) {
+        order[j] = order[j - 1];
+        j--;
+      }
+      order[j] = i;
+    }
+
+    for (int i = 0; i < num_hits; i++) {
+      stack_index++;
+      assert(stack_index < kMaxStackDepth);
+      stack_child[stack_index] = node.child[order[i]];
+      stack_count[stack_index] = node.count[order[i]];
+      stack_t[stack_index] = tnear[order[i]];
+    }
+  }
+
+  (void)kMaxStackDepth;
+
+  bool hit = (intersector.GetT() < ray.max_t);
+  intersector.PostTraversal(ray, hit, isect);
+
+  return hit;
+}
+
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
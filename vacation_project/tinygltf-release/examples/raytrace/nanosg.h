@@ -31,6 +31,7 @@ THE SOFTWARE.
 #endif
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <limits>
 #include <vector>
@@ -316,7 +317,10 @@ class Node {
  public:
   typedef Node<T, M> type;
 
-  explicit Node(const M *mesh) : mesh_(mesh) {
+  explicit Node(const M *mesh)
+      : rebuild_threshold_(static_cast<T>(1.5)),
+        geometry_dirty_(false),
+        mesh_(mesh) {
     xbmin_[0] = xbmin_[1] = xbmin_[2] = std::numeric_limits<T>::max();
     xbmax_[0] = xbmax_[1] = xbmax_[2] = -std::numeric_limits<T>::max();
 
@@ -357,6 +361,9 @@ class Node {
     xbmax_[1] = rhs.xbmax_[1];
     xbmax_[2] = rhs.xbmax_[2];
 
+    rebuild_threshold_ = rhs.rebuild_threshold_;
+    geometry_dirty_ = rhs.geometry_dirty_;
+
     mesh_ = rhs.mesh_;
     name_ = rhs.name_;
 
@@ -386,27 +393,53 @@ class Node {
 
   std::vector<type> &GetChildren() { return children_; }
 
+  ///
+  /// Notify that vertices of the mesh have moved(e.g. skinning, morphing).
+  /// The next `Update` refits the node's BVH instead of rebuilding it.
+  /// The number of vertices and faces must not change.
+  ///
+  void SetGeometryChanged() { geometry_dirty_ = true; }
+
+  ///
+  /// BVH is rebuilt from scratch when its SAH cost after a refit exceeds
+  /// `ratio` x the cost at the build time. Default is 1.5.
+  ///
+  void SetRebuildThreshold(const T ratio) { rebuild_threshold_ = ratio; }
+
   ///
   /// Update internal state.
   ///
   void Update(const T parent_xform[4][4]) {
-    if (!accel_.IsValid() && mesh_ && (mesh_->vertices.size() > 3) &&
-        (mesh_->faces.size() >= 3)) {
+    if (mesh_ && (mesh_->vertices.size() > 3) && (mesh_->faces.size() >= 3)) {
       // Assume mesh is composed of triangle faces only.
       nanort::TriangleMesh<float> triangle_mesh(
           mesh_->vertices.data(), mesh_->faces.data(), mesh_->stride);
-      nanort::TriangleSAHPred<float> triangle_pred(
-          mesh_->vertices.data(), mesh_->faces.data(), mesh_->stride);
 
-      bool ret =
-          accel_.Build(static_cast<unsigned int>(mesh_->faces.size()) / 3,
-                       triangle_mesh, triangle_pred);
+      bool rebuild = !accel_.IsValid();
+      if (!rebuild && geometry_dirty_) {
+        accel_.Refit(triangle_mesh);
+
+        // Refit keeps the tree topology, so its quality degrades as vertices
+        // move far from the build time positions.
+        nanort::BVHBuildStatistics stats = accel_.GetStatistics();
+        rebuild = stats.sah_cost > stats.build_sah_cost * rebuild_threshold_;
+      }
+
+      bool ret = accel_.IsValid();
+      if (rebuild) {
+        nanort::TriangleSAHPred<float> triangle_pred(
+            mesh_->vertices.data(), mesh_->faces.data(), mesh_->stride);
+
+        ret = accel_.Build(static_cast<unsigned int>(mesh_->faces.size()) / 3,
+                           triangle_mesh, triangle_pred);
+      }
 
       // Update local bbox.
-      if (ret) {
+      if (ret && (rebuild || geometry_dirty_)) {
         accel_.BoundingBox(lbmin_, lbmax_);
       }
     }
+    geometry_dirty_ = false;
 
     // xform = parent_xform x local_xform
     Matrix<T>::Mult(xform_, parent_xform, local_xform_);
@@ -489,6 +522,8 @@ class Node {
   T xbmax_[3];
 
   nanort::BVHAccel<T> accel_;
+  T rebuild_threshold_;
+  bool geometry_dirty_;  // Vertices moved since the last `Update`.
 
   std::string name_;
 
@@ -639,10 +674,118 @@ class NodeBBoxIntersector {
   mutable int ray_dir_sign_[3];
 };
 
+///
+/// Packet version of NodeBBoxIntersector. Used to collect nodes whose world
+/// bounding box is hit by any lane of a ray packet. Never reports a hit, so
+/// the whole toplevel BVH along the packet is visited.
+///
+template <typename T, class M, int N>
+class NodeBBoxPacketIntersector {
+ public:
+  static const int kMaxNodes = 128;
+
+  NodeBBoxPacketIntersector(const std::vector<Node<T, M> > *nodes)
+      : nodes_(nodes), num_hits_(0), overflow_(false) {}
+
+  unsigned int Intersect(T *t_inout, unsigned int prim_index,
+                         unsigned int mask) const {
+    T bmin[3], bmax[3];
+
+    (*nodes_)[prim_index].GetWorldBoundingBox(bmin, bmax);
+
+    unsigned int hit = 0;
+    T t_min[N];
+    for (int i = 0; i < N; i++) {
+      t_min[i] = std::numeric_limits<T>::max();
+      if (!(mask & (1u << i))) continue;
+
+      T tmin = -std::numeric_limits<T>::max();
+      T tmax = std::numeric_limits<T>::max();
+      for (int k = 0; k < 3; k++) {
+        const T t0 = (bmin[k] - ray_org_[k][i]) * ray_inv_dir_[k][i];
+        const T t1 = (bmax[k] - ray_org_[k][i]) * ray_inv_dir_[k][i];
+        tmin = nanort::safemax(nanort::safemin(t0, t1), tmin);
+        tmax = nanort::safemin(nanort::safemax(t0, t1), tmax);
+      }
+
+      if (tmin <= tmax) {
+        t_min[i] = tmin;
+        hit |= (1u << i);
+      }
+    }
+
+    if (hit) {
+      if (num_hits_ < kMaxNodes) {
+        NodeHit &h = hits_[num_hits_++];
+        h.node_id = prim_index;
+        h.mask = hit;
+        h.nearest = std::numeric_limits<T>::max();
+        for (int i = 0; i < N; i++) {
+          h.t_min[i] = t_min[i];
+          h.nearest = std::min(h.nearest, t_min[i]);
+        }
+
+        // Keep frontmost order, like ListNodeIntersections().
+        for (int j = num_hits_ - 1;
+             (j > 0) && (hits_[j].nearest < hits_[j - 1].nearest); j--) {
+          std::swap(hits_[j], hits_[j - 1]);
+        }
+      } else {
+        overflow_ = true;
+      }
+    }
+
+    (void)t_inout;
+    return 0;
+  }
+
+  void Update(const T *t, unsigned int prim_idx, unsigned int mask) const {
+    (void)t;
+    (void)prim_idx;
+    (void)mask;
+  }
+
+  void PrepareTraversal(const nanort::RayPacket<T, N> &packet,
+                        const nanort::BVHTraceOptions &trace_options) const {
+    for (int i = 0; i < N; i++) {
+      for (int k = 0; k < 3; k++) {
+        ray_org_[k][i] = packet.org[k][i];
+        // FIXME(syoyo): Consider zero div case.
+        ray_inv_dir_[k][i] = static_cast<T>(1.0) / packet.dir[k][i];
+      }
+    }
+    num_hits_ = 0;
+    overflow_ = false;
+    (void)trace_options;
+  }
+
+  template <class H>
+  void PostTraversal(const nanort::RayPacket<T, N> &packet,
+                     unsigned int hit_mask, H *isects) const {
+    (void)packet;
+    (void)hit_mask;
+    (void)isects;
+  }
+
+  struct NodeHit {
+    unsigned int node_id;
+    unsigned int mask;  // lanes hitting the node's bounding box
+    T t_min[N];
+    T nearest;  // smallest t_min over lanes
+  };
+
+  const std::vector<Node<T, M> > *nodes_;
+  mutable T ray_org_[3][N];
+  mutable T ray_inv_dir_[3][N];
+  mutable NodeHit hits_[kMaxNodes];
+  mutable int num_hits_;
+  mutable bool overflow_;  // true when more than kMaxNodes nodes were hit
+};
+
 template <typename T, class M>
 class Scene {
  public:
-  Scene() {
+  Scene() : rebuild_threshold_(static_cast<T>(1.5)) {
     bmin_[0] = bmin_[1] = bmin_[2] = std::numeric_limits<T>::max();
     bmax_[0] = bmax_[1] = bmax_[2] = -std::numeric_limits<T>::max();
   }
@@ -659,6 +802,14 @@ class Scene {
 
   const std::vector<Node<T, M> > &GetNodes() const { return nodes_; }
 
+  std::vector<Node<T, M> > &GetNodes() { return nodes_; }
+
+  ///
+  /// Toplevel BVH is rebuilt in `Refit` when its SAH cost exceeds `ratio` x
+  /// the cost at the build time. Default is 1.5.
+  ///
+  void SetRebuildThreshold(const T ratio) { rebuild_threshold_ = ratio; }
+
   bool FindNode(const std::string &name, Node<T, M> **found_node) {
     if (!found_node) {
       return false;
@@ -733,6 +884,51 @@ class Scene {
     return ret;
   }
 
+  ///
+  /// Cheaper `Commit` for animation, when only node transforms or mesh
+  /// vertices(see `Node::SetGeometryChanged`) have changed since the last
+  /// commit. Nodes refit their BVH and the toplevel BVH is refit to the new
+  /// node bounds. Each BVH is rebuilt when refits have degraded it too much.
+  /// Falls back to `Commit` when nodes were added or removed.
+  ///
+  bool Refit() {
+    if (!toplevel_accel_.IsValid() ||
+        (toplevel_accel_.GetIndices().size() != nodes_.size())) {
+      return Commit();
+    }
+
+    // Update nodes.
+    for (size_t i = 0; i < nodes_.size(); i++) {
+      T ident[4][4];
+      Matrix<T>::Identity(ident);
+
+      nodes_[i].Update(ident);
+    }
+
+    NodeBBoxGeometry<T, M> geom(&nodes_);
+    if (!toplevel_accel_.Refit(geom)) {
+      return Commit();
+    }
+
+    nanort::BVHBuildStatistics stats = toplevel_accel_.GetStatistics();
+    if (stats.sah_cost > stats.build_sah_cost * rebuild_threshold_) {
+      // Nodes have moved too far from where the toplevel BVH was built.
+      NodeBBoxPred<T, M> pred(&nodes_);
+
+      nanort::BVHBuildOptions<T> build_options;
+      build_options.min_leaf_primitives = 1;
+
+      if (!toplevel_accel_.Build(static_cast<unsigned int>(nodes_.size()),
+                                 geom, pred, build_options)) {
+        return false;
+      }
+    }
+
+    toplevel_accel_.BoundingBox(bmin_, bmax_);
+
+    return true;
+  }
+
   ///
   /// Get the scene bounding box.
   ///
@@ -846,6 +1042,146 @@ class Scene {
     return has_hit;
   }
 
+  ///
+  /// Trace a packet of rays into the scene.
+  /// Same as Traverse() for each active lane, but nodes and their BVHs are
+  /// traversed once for the whole packet.
+  /// `isects` must have room for `N` elements.
+  /// Returns the bit mask of lanes which hit something.
+  ///
+  template <int N, class H>
+  unsigned int TraversePacket(const nanort::RayPacket<T, N> &packet,
+                              H *isects,
+                              const bool cull_back_face = false) const {
+    if (!toplevel_accel_.IsValid()) {
+      return 0;
+    }
+
+    NodeBBoxPacketIntersector<T, M, N> isector(&nodes_);
+    toplevel_accel_.TraversePacket(packet, isector,
+                                   static_cast<H *>(NULL));
+
+    if (isector.overflow_) {
+      // Too many nodes along the packet. Trace each lane separately.
+      unsigned int hit_mask = 0;
+      for (int i = 0; i < N; i++) {
+        if (!(packet.mask & (1u << i))) continue;
+
+        nanort::Ray<T> ray;
+        for (int k = 0; k < 3; k++) {
+          ray.org[k] = packet.org[k][i];
+          ray.dir[k] = packet.dir[k][i];
+        }
+        ray.min_t = packet.min_t[i];
+        ray.max_t = packet.max_t[i];
+        if (Traverse(ray, &isects[i], cull_back_face)) {
+          hit_mask |= (1u << i);
+        }
+      }
+      return hit_mask;
+    }
+
+    T t_nearest[N];
+    for (int i = 0; i < N; i++) {
+      t_nearest[i] = std::numeric_limits<T>::max();
+    }
+
+    nanort::BVHTraceOptions trace_options;
+    trace_options.cull_back_face = cull_back_face;
+
+    unsigned int hit_mask = 0;
+
+    for (int n = 0; n < isector.num_hits_; n++) {
+      const typename NodeBBoxPacketIntersector<T, M, N>::NodeHit &node_hit =
+          isector.hits_[n];
+
+      // Early cull test.
+      unsigned int mask = 0;
+      for (int i = 0; i < N; i++) {
+        if ((node_hit.mask & (1u << i)) &&
+            !(t_nearest[i] < node_hit.t_min[i])) {
+          mask |= (1u << i);
+        }
+      }
+      if (!mask) continue;
+
+      assert(node_hit.node_id < nodes_.size());
+      const Node<T, M> &node = nodes_[node_hit.node_id];
+
+      // Transform rays into node's local space
+      nanort::RayPacket<T, N> local_packet;
+      local_packet.mask = mask;
+      for (int i = 0; i < N; i++) {
+        T org[3], dir[3], local_org[3], local_dir[3];
+        for (int k = 0; k < 3; k++) {
+          org[k] = packet.org[k][i];
+          dir[k] = packet.dir[k][i];
+        }
+        Matrix<T>::MultV(local_org, node.inv_xform_, org);
+        Matrix<T>::MultV(local_dir, node.inv_xform33_, dir);
+        for (int k = 0; k < 3; k++) {
+          local_packet.org[k][i] = local_org[k];
+          local_packet.dir[k][i] = local_dir[k];
+        }
+      }
+
+      nanort::TrianglePacketIntersector<T, N, H> triangle_intersector(
+          node.GetMesh()->vertices.data(), node.GetMesh()->faces.data(),
+          node.GetMesh()->stride);
+      H local_isects[N];
+
+      unsigned int hits = node.GetAccel().TraversePacket(
+          local_packet, triangle_intersector, local_isects, trace_options);
+
+      for (int i = 0; i < N; i++) {
+        if (!(hits & (1u << i))) continue;
+
+        const H &local_isect = local_isects[i];
+
+        // Calulcate hit distance in world coordiante.
+        T local_P[3];
+        for (int k = 0; k < 3; k++) {
+          local_P[k] = local_packet.org[k][i] +
+                       local_isect.t * local_packet.dir[k][i];
+        }
+
+        T world_P[3];
+        Matrix<T>::MultV(world_P, node.xform_, local_P);
+
+        nanort::real3<T> po;
+        po[0] = world_P[0] - packet.org[0][i];
+        po[1] = world_P[1] - packet.org[1][i];
+        po[2] = world_P[2] - packet.org[2][i];
+
+        float t_world = vlength(po);
+
+        if (t_world < t_nearest[i]) {
+          t_nearest[i] = t_world;
+          hit_mask |= (1u << i);
+
+          H *isect = &isects[i];
+          isect->node_id = node_hit.node_id;
+          isect->prim_id = local_isect.prim_id;
+          isect->u = local_isect.u;
+          isect->v = local_isect.v;
+
+          T Ng[3], Ns[3];  // geometric normal, shading normal.
+
+          node.GetMesh()->GetNormal(Ng, Ns, isect->prim_id, isect->u,
+                                    isect->v);
+
+          // Convert position and normal into world coordinate.
+          isect->t = t_world;
+          Matrix<T>::MultV(isect->P, node.xform_, local_P);
+          Matrix<T>::MultV(isect->Ng, node.inv_transpose_xform33_, Ng);
+          Matrix<T>::MultV(isect->Ns, node.inv_transpose_xform33_, Ns);
+        }
+      }
+    }
+
+    return hit_mask;
+  }
+
  private:
   ///
   /// Find a node by name.
@@ -874,6 +1210,7 @@ class Scene {
 
   // Toplevel BVH accel.
   nanort::BVHAccel<T> toplevel_accel_;
+  T rebuild_threshold_;
   std::vector<Node<T, M> > nodes_;
 };
 
@@ -103,6 +103,22 @@ bool LoadRenderConfig(example::RenderConfig* config, const char* filename) {
     }
   }
 
+  config->adaptive_threshold = 0.005f;
+  if (o.find("adaptive_threshold") != o.end()) {
+    if (o["adaptive_threshold"].is<double>()) {
+      config->adaptive_threshold =
+          static_cast<float>(o["adaptive_threshold"].get<double>());
+    }
+  }
+
+  config->adaptive_min_samples = 4;
+  if (o.find("adaptive_min_samples") != o.end()) {
+    if (o["adaptive_min_samples"].is<double>()) {
+      config->adaptive_min_samples =
+          static_cast<int>(o["adaptive_min_samples"].get<double>());
+    }
+  }
+
   config->width = 512;
   if (o.find("width") != o.end()) {
     if (o["width"].is<double>()) {
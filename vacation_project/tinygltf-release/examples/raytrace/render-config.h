@@ -20,6 +20,10 @@ typedef struct {
   int pass;
   int max_passes;
 
+  // adaptive sampling
+  float adaptive_threshold;  // Relative error to stop sampling a tile. 0 = off.
+  int adaptive_min_samples;  // Samples per pixel before a tile may stop.
+
   // For debugging. Array size = width * height * 4.
   float *normalImage;
   float *positionImage;
@@ -34,7 +34,10 @@ THE SOFTWARE.
 
 #include "render.h"
 
+#include <algorithm>
 #include <chrono>  // C++11
+#include <cmath>
+#include <limits>
 #include <sstream>
 #include <thread>  // C++11
 #include <vector>
@@ -234,6 +237,293 @@ void FetchTexture(const Texture &texture, float u, float v, float* col) {
   col[2] = texture.image[idx_offset + 2] / 255.f;
 }
 
+// Shades pixel (x, y) whose primary ray(`org`, `dir`) hit `isect`, and
+// stores the hit into the debug images.
+// `aux_rgba` accumulates the squared color for the variance estimation.
+static void ShadeHit(int x, int y, const float3 &org, const float3 &dir,
+                     const nanosg::Intersection<float> &isect,
+                     const example::Asset &asset, const RenderConfig &config,
+                     float *rgba, float *aux_rgba, int *sample_counts) {
+  const std::vector<Material> &materials = asset.materials;
+  const std::vector<Texture> &textures = asset.textures;
+  const Mesh<float> &mesh = asset.meshes[isect.node_id];
+
+  //tigra: add default material
+  const Material &default_material = asset.default_material;
+
+  float3 p;
+  p[0] =
+      org[0] + isect.t * dir[0];
+  p[1] =
+      org[1] + isect.t * dir[1];
+  p[2] =
+      org[2] + isect.t * dir[2];
+
+  config.positionImage[4 * (y * config.width + x) + 0] = p.x();
+  config.positionImage[4 * (y * config.width + x) + 1] = p.y();
+  config.positionImage[4 * (y * config.width + x) + 2] = p.z();
+  config.positionImage[4 * (y * config.width + x) + 3] = 1.0f;
+
+  config.varycoordImage[4 * (y * config.width + x) + 0] =
+      isect.u;
+  config.varycoordImage[4 * (y * config.width + x) + 1] =
+      isect.v;
+  config.varycoordImage[4 * (y * config.width + x) + 2] = 0.0f;
+  config.varycoordImage[4 * (y * config.width + x) + 3] = 1.0f;
+
+  unsigned int prim_id = isect.prim_id;
+
+  float3 N;
+  if (mesh.facevarying_normals.size() > 0) {
+    float3 n0, n1, n2;
+    n0[0] = mesh.facevarying_normals[9 * prim_id + 0];
+    n0[1] = mesh.facevarying_normals[9 * prim_id + 1];
+    n0[2] = mesh.facevarying_normals[9 * prim_id + 2];
+    n1[0] = mesh.facevarying_normals[9 * prim_id + 3];
+    n1[1] = mesh.facevarying_normals[9 * prim_id + 4];
+    n1[2] = mesh.facevarying_normals[9 * prim_id + 5];
+    n2[0] = mesh.facevarying_normals[9 * prim_id + 6];
+    n2[1] = mesh.facevarying_normals[9 * prim_id + 7];
+    n2[2] = mesh.facevarying_normals[9 * prim_id + 8];
+    N = Lerp3(n0, n1, n2, isect.u, isect.v);
+  } else {
+    unsigned int f0, f1, f2;
+    f0 = mesh.faces[3 * prim_id + 0];
+    f1 = mesh.faces[3 * prim_id + 1];
+    f2 = mesh.faces[3 * prim_id + 2];
+
+    float3 v0, v1, v2;
+    v0[0] = mesh.vertices[3 * f0 + 0];
+    v0[1] = mesh.vertices[3 * f0 + 1];
+    v0[2] = mesh.vertices[3 * f0 + 2];
+    v1[0] = mesh.vertices[3 * f1 + 0];
+    v1[1] = mesh.vertices[3 * f1 + 1];
+    v1[2] = mesh.vertices[3 * f1 + 2];
+    v2[0] = mesh.vertices[3 * f2 + 0];
+    v2[1] = mesh.vertices[3 * f2 + 1];
+    v2[2] = mesh.vertices[3 * f2 + 2];
+    CalcNormal(N, v0, v1, v2);
+  }
+
+  config.normalImage[4 * (y * config.width + x) + 0] =
+      0.5f * N[0] + 0.5f;
+  config.normalImage[4 * (y * config.width + x) + 1] =
+      0.5f * N[1] + 0.5f;
+  config.normalImage[4 * (y * config.width + x) + 2] =
+      0.5f * N[2] + 0.5f;
+  config.normalImage[4 * (y * config.width + x) + 3] = 1.0f;
+
+  config.depthImage[4 * (y * config.width + x) + 0] =
+      isect.t;
+  config.depthImage[4 * (y * config.width + x) + 1] =
+      isect.t;
+  config.depthImage[4 * (y * config.width + x) + 2] =
+      isect.t;
+  config.depthImage[4 * (y * config.width + x) + 3] = 1.0f;
+
+  float3 UV;
+  if (mesh.facevarying_uvs.size() > 0) {
+    float3 uv0, uv1, uv2;
+    uv0[0] = mesh.facevarying_uvs[6 * prim_id + 0];
+    uv0[1] = mesh.facevarying_uvs[6 * prim_id + 1];
+    uv1[0] = mesh.facevarying_uvs[6 * prim_id + 2];
+    uv1[1] = mesh.facevarying_uvs[6 * prim_id + 3];
+    uv2[0] = mesh.facevarying_uvs[6 * prim_id + 4];
+    uv2[1] = mesh.facevarying_uvs[6 * prim_id + 5];
+
+    UV = Lerp3(uv0, uv1, uv2, isect.u, isect.v);
+
+    config.texcoordImage[4 * (y * config.width + x) + 0] = UV[0];
+    config.texcoordImage[4 * (y * config.width + x) + 1] = UV[1];
+  }
+
+  // Fetch texture
+  unsigned int material_id =
+      mesh.material_ids[isect.prim_id];
+
+  //printf("material_id=%d materials=%lld\n", material_id, materials.size());
+
+  float diffuse_col[3];
+
+  float specular_col[3];
+
+  //tigra: material_id is ok
+  if(material_id<materials.size())
+  {
+    //printf("ok mat\n");
+
+    int diffuse_texid = materials[material_id].diffuse_texid;
+    if (diffuse_texid >= 0) {
+      FetchTexture(textures[diffuse_texid], UV[0], UV[1], diffuse_col);
+    } else {
+      diffuse_col[0] = materials[material_id].diffuse[0];
+      diffuse_col[1] = materials[material_id].diffuse[1];
+      diffuse_col[2] = materials[material_id].diffuse[2];
+    }
+
+    int specular_texid = materials[material_id].specular_texid;
+    if (specular_texid >= 0) {
+      FetchTexture(textures[specular_texid], UV[0], UV[1], specular_col);
+    } else {
+      specular_col[0] = materials[material_id].specular[0];
+      specular_col[1] = materials[material_id].specular[1];
+      specular_col[2] = materials[material_id].specular[2];
+    }
+  }
+  else
+    //tigra: wrong material_id, use default_material
+    {
+
+    //printf("default_material\n");
+
+      diffuse_col[0] = default_material.diffuse[0];
+      diffuse_col[1] = default_material.diffuse[1];
+      diffuse_col[2] = default_material.diffuse[2];
+      specular_col[0] = default_material.specular[0];
+      specular_col[1] = default_material.specular[1];
+      specular_col[2] = default_material.specular[2];
+    }
+
+  // Simple shading
+  float NdotV = fabsf(vdot(N, dir));
+  float col[3] = {NdotV * diffuse_col[0], NdotV * diffuse_col[1],
+                  NdotV * diffuse_col[2]};
+
+  if (config.pass == 0) {
+    rgba[4 * (y * config.width + x) + 0] = col[0];
+    rgba[4 * (y * config.width + x) + 1] = col[1];
+    rgba[4 * (y * config.width + x) + 2] = col[2];
+    rgba[4 * (y * config.width + x) + 3] = 1.0f;
+    aux_rgba[4 * (y * config.width + x) + 0] = col[0] * col[0];
+    aux_rgba[4 * (y * config.width + x) + 1] = col[1] * col[1];
+    aux_rgba[4 * (y * config.width + x) + 2] = col[2] * col[2];
+    aux_rgba[4 * (y * config.width + x) + 3] = 1.0f;
+    sample_counts[y * config.width + x] =
+        1;  // Set 1 for the first pass
+  } else {  // additive.
+    rgba[4 * (y * config.width + x) + 0] += col[0];
+    rgba[4 * (y * config.width + x) + 1] += col[1];
+    rgba[4 * (y * config.width + x) + 2] += col[2];
+    rgba[4 * (y * config.width + x) + 3] += 1.0f;
+    aux_rgba[4 * (y * config.width + x) + 0] += col[0] * col[0];
+    aux_rgba[4 * (y * config.width + x) + 1] += col[1] * col[1];
+    aux_rgba[4 * (y * config.width + x) + 2] += col[2] * col[2];
+    aux_rgba[4 * (y * config.width + x) + 3] += 1.0f;
+    sample_counts[y * config.width + x]++;
+  }
+}
+
+// Clears pixel (x, y) whose primary ray hit nothing.
+static void ShadeMiss(int x, int y, const RenderConfig &config, float *rgba,
+                      float *aux_rgba, int *sample_counts) {
+  if (config.pass == 0) {
+    // clear pixel
+    rgba[4 * (y * config.width + x) + 0] = 0.0f;
+    rgba[4 * (y * config.width + x) + 1] = 0.0f;
+    rgba[4 * (y * config.width + x) + 2] = 0.0f;
+    rgba[4 * (y * config.width + x) + 3] = 0.0f;
+    aux_rgba[4 * (y * config.width + x) + 0] = 0.0f;
+    aux_rgba[4 * (y * config.width + x) + 1] = 0.0f;
+    aux_rgba[4 * (y * config.width + x) + 2] = 0.0f;
+    aux_rgba[4 * (y * config.width + x) + 3] = 0.0f;
+    sample_counts[y * config.width + x] =
+        1;  // Set 1 for the first pass
+  } else {
+    sample_counts[y * config.width + x]++;
+  }
+
+  // No super sampling
+  config.normalImage[4 * (y * config.width + x) + 0] = 0.0f;
+  config.normalImage[4 * (y * config.width + x) + 1] = 0.0f;
+  config.normalImage[4 * (y * config.width + x) + 2] = 0.0f;
+  config.normalImage[4 * (y * config.width + x) + 3] = 0.0f;
+  config.positionImage[4 * (y * config.width + x) + 0] = 0.0f;
+  config.positionImage[4 * (y * config.width + x) + 1] = 0.0f;
+  config.positionImage[4 * (y * config.width + x) + 2] = 0.0f;
+  config.positionImage[4 * (y * config.width + x) + 3] = 0.0f;
+  config.depthImage[4 * (y * config.width + x) + 0] = 0.0f;
+  config.depthImage[4 * (y * config.width + x) + 1] = 0.0f;
+  config.depthImage[4 * (y * config.width + x) + 2] = 0.0f;
+  config.depthImage[4 * (y * config.width + x) + 3] = 0.0f;
+  config.texcoordImage[4 * (y * config.width + x) + 0] = 0.0f;
+  config.texcoordImage[4 * (y * config.width + x) + 1] = 0.0f;
+  config.texcoordImage[4 * (y * config.width + x) + 2] = 0.0f;
+  config.texcoordImage[4 * (y * config.width + x) + 3] = 0.0f;
+  config.varycoordImage[4 * (y * config.width + x) + 0] = 0.0f;
+  config.varycoordImage[4 * (y * config.width + x) + 1] = 0.0f;
+  config.varycoordImage[4 * (y * config.width + x) + 2] = 0.0f;
+  config.varycoordImage[4 * (y * config.width + x) + 3] = 0.0f;
+}
+
+// Interleaves the bits of `x` and `y`(Z-order curve).
+static uint32_t MortonCode2D(uint32_t x, uint32_t y) {
+  uint32_t c[2] = {x, y};
+  for (int i = 0; i < 2; i++) {
+    c[i] &= 0x0000ffff;
+    c[i] = (c[i] | (c[i] << 8)) & 0x00ff00ff;
+    c[i] = (c[i] | (c[i] << 4)) & 0x0f0f0f0f;
+    c[i] = (c[i] | (c[i] << 2)) & 0x33333333;
+    c[i] = (c[i] | (c[i] << 1)) & 0x55555555;
+  }
+  return c[0] | (c[1] << 1);
+}
+
+// Max samples per pixel a noisy tile takes in one pass.
+static const int kMaxTileSamplesPerPass = 4;
+
+// Returns the number of samples to trace for the tile in this pass, from the
+// standard error of its pixels estimated with `rgba`(sum of samples),
+// `aux_rgba`(sum of squared samples) and `sample_counts`.
+// 0 means the tile has converged.
+static int TileSampleCount(int tile_x, int tile_y, int tile_w, int tile_h,
+                           const RenderConfig &config, const float *rgba,
+                           const float *aux_rgba, const int *sample_counts) {
+  if ((config.pass == 0) || (config.adaptive_threshold <= 0.0f)) {
+    return 1;
+  }
+
+  double sum_variance = 0.0;  // variance of the pixel mean.
+  double sum_mean = 0.0;
+  int min_count = std::numeric_limits<int>::max();
+  for (int y = tile_y; y < tile_y + tile_h; y++) {
+    for (int x = tile_x; x < tile_x + tile_w; x++) {
+      const int idx = y * config.width + x;
+      const int n = sample_counts[idx];
+      min_count = std::min(min_count, n);
+      if (n < std::max(2, config.adaptive_min_samples)) {
+        return 1;
+      }
+
+      // Channel average of the sample variance.
+      double variance = 0.0;
+      double mean = 0.0;
+      for (int k = 0; k < 3; k++) {
+        double m = rgba[4 * idx + k] / n;
+        variance += std::max(0.0, aux_rgba[4 * idx + k] / n - m * m);
+        mean += m;
+      }
+      sum_variance += variance / (3.0 * n);
+      sum_mean += mean / 3.0;
+    }
+  }
+
+  // Relative standard error of the tile. Dark tiles are compared against
+  // the absolute error.
+  const double num_pixels = double(tile_w) * double(tile_h);
+  const double error = std::sqrt(sum_variance / num_pixels) /
+                       std::max(sum_mean / num_pixels, 1.0e-2);
+  if (error <= config.adaptive_threshold) {
+    return 0;
+  }
+
+  // The error falls by 1/sqrt(samples), so estimate the samples to reach the
+  // threshold.
+  const double ratio = error / config.adaptive_threshold;
+  const double needed = min_count * (ratio * ratio - 1.0);
+  return std::max(1, std::min(kMaxTileSamplesPerPass,
+                              static_cast<int>(std::ceil(needed))));
+}
+
 bool Renderer::Render(float* rgba, float* aux_rgba, int* sample_counts,
                       float quat[4], 
                       const nanosg::Scene<float, example::Mesh<float>> &scene,
@@ -263,6 +553,24 @@ bool Renderer::Render(float* rgba, float* aux_rgba, int* sample_counts,
 
   auto kCancelFlagCheckMilliSeconds = 300;
 
+  typedef nanort::RayPacket<float, 8> RayPacket;
+  const int kPacketWidth = 4;
+  const int kPacketHeight = RayPacket::kWidth / kPacketWidth;
+  const int kTileSize = 16;
+
+  const int num_tiles_x = (width + kTileSize - 1) / kTileSize;
+  const int num_tiles_y = (height + kTileSize - 1) / kTileSize;
+  const int num_tiles = num_tiles_x * num_tiles_y;
+
+  // Hand out tiles in Morton order, so that tiles traced at the same time
+  // stay close to each other on the screen.
+  std::vector<std::pair<uint32_t, int> > tiles(num_tiles);
+  for (int t = 0; t < num_tiles; t++) {
+    tiles[t].first = MortonCode2D(t % num_tiles_x, t / num_tiles_x);
+    tiles[t].second = t;
+  }
+  std::sort(tiles.begin(), tiles.end());
+
   std::vector<std::thread> workers;
   std::atomic<int> i(0);
 
@@ -278,8 +586,10 @@ bool Renderer::Render(float* rgba, float* aux_rgba, int* sample_counts,
       pcg32_srandom(&rng, config.pass,
                     t);  // seed = combination of render pass + thread no.
 
-      int y = 0;
-      while ((y = i++) < config.height) {
+      // Primary rays are traced in 16x16 pixel tiles of 4x2 ray packets, so
+      // that rays in a packet stay coherent.
+      int next = 0;
+      while ((next = i++) < num_tiles) {
         auto currT = std::chrono::system_clock::now();
 
         std::chrono::duration<double, std::milli> ms = currT - startT;
@@ -290,262 +600,84 @@ bool Renderer::Render(float* rgba, float* aux_rgba, int* sample_counts,
           }
         }
 
-        // draw dash line to aux buffer for progress.
-        // for (int x = 0; x < config.width; x++) {
-        //  float c = (x / 8) % 2;
-        //  aux_rgba[4*(y*config.width+x)+0] = c;
-        //  aux_rgba[4*(y*config.width+x)+1] = c;
-        //  aux_rgba[4*(y*config.width+x)+2] = c;
-        //  aux_rgba[4*(y*config.width+x)+3] = 0.0f;
-        //}
-
-        for (int x = 0; x < config.width; x++) {
-          nanort::Ray<float> ray;
-          ray.org[0] = origin[0];
-          ray.org[1] = origin[1];
-          ray.org[2] = origin[2];
-
-          float u0 = pcg32_random(&rng);
-          float u1 = pcg32_random(&rng);
-
-          float3 dir;
-        
-        //for modes not a "color"
-		    if(_showBufferMode != SHOW_BUFFER_COLOR)
-		    {
-          //only one pass
-			    if(config.pass > 0)
-				    continue;
-				  
-          //to the center of pixel
-			      u0 = 0.5f;
-			      u1 = 0.5f;
-		      }
-      
-          dir = corner + (float(x) + u0) * u +
-                (float(config.height - y - 1) + u1) * v;
-          dir = vnormalize(dir);
-          ray.dir[0] = dir[0];
-          ray.dir[1] = dir[1];
-          ray.dir[2] = dir[2];
-
-          float kFar = 1.0e+30f;
-          ray.min_t = 0.0f;
-          ray.max_t = kFar;
-
-          
-          nanosg::Intersection<float> isect;
-          bool hit = scene.Traverse(ray, &isect, /* cull_back_face */false);
-
-          if (hit) {
-
-            const std::vector<Material> &materials = asset.materials;
-            const std::vector<Texture> &textures = asset.textures;
-            const Mesh<float> &mesh = asset.meshes[isect.node_id];
-			
-			//tigra: add default material
-			const Material &default_material = asset.default_material;
-
-            float3 p;
-            p[0] =
-                ray.org[0] + isect.t * ray.dir[0];
-            p[1] =
-                ray.org[1] + isect.t * ray.dir[1];
-            p[2] =
-                ray.org[2] + isect.t * ray.dir[2];
-
-            config.positionImage[4 * (y * config.width + x) + 0] = p.x();
-            config.positionImage[4 * (y * config.width + x) + 1] = p.y();
-            config.positionImage[4 * (y * config.width + x) + 2] = p.z();
-            config.positionImage[4 * (y * config.width + x) + 3] = 1.0f;
-
-            config.varycoordImage[4 * (y * config.width + x) + 0] =
-                isect.u;
-            config.varycoordImage[4 * (y * config.width + x) + 1] =
-                isect.v;
-            config.varycoordImage[4 * (y * config.width + x) + 2] = 0.0f;
-            config.varycoordImage[4 * (y * config.width + x) + 3] = 1.0f;
-
-            unsigned int prim_id = isect.prim_id;
-
-            float3 N;
-            if (mesh.facevarying_normals.size() > 0) {
-              float3 n0, n1, n2;
-              n0[0] = mesh.facevarying_normals[9 * prim_id + 0];
-              n0[1] = mesh.facevarying_normals[9 * prim_id + 1];
-              n0[2] = mesh.facevarying_normals[9 * prim_id + 2];
-              n1[0] = mesh.facevarying_normals[9 * prim_id + 3];
-              n1[1] = mesh.facevarying_normals[9 * prim_id + 4];
-              n1[2] = mesh.facevarying_normals[9 * prim_id + 5];
-              n2[0] = mesh.facevarying_normals[9 * prim_id + 6];
-              n2[1] = mesh.facevarying_normals[9 * prim_id + 7];
-              n2[2] = mesh.facevarying_normals[9 * prim_id + 8];
-              N = Lerp3(n0, n1, n2, isect.u, isect.v);
-            } else {
-              unsigned int f0, f1, f2;
-              f0 = mesh.faces[3 * prim_id + 0];
-              f1 = mesh.faces[3 * prim_id + 1];
-              f2 = mesh.faces[3 * prim_id + 2];
-
-              float3 v0, v1, v2;
-              v0[0] = mesh.vertices[3 * f0 + 0];
-              v0[1] = mesh.vertices[3 * f0 + 1];
-              v0[2] = mesh.vertices[3 * f0 + 2];
-              v1[0] = mesh.vertices[3 * f1 + 0];
-              v1[1] = mesh.vertices[3 * f1 + 1];
-              v1[2] = mesh.vertices[3 * f1 + 2];
-              v2[0] = mesh.vertices[3 * f2 + 0];
-              v2[1] = mesh.vertices[3 * f2 + 1];
-              v2[2] = mesh.vertices[3 * f2 + 2];
-              CalcNormal(N, v0, v1, v2);
-            }
+        const int tile = tiles[next].second;
+        const int tile_x = (tile % num_tiles_x) * kTileSize;
+        const int tile_y = (tile / num_tiles_x) * kTileSize;
+        const int tile_w = std::min(kTileSize, config.width - tile_x);
+        const int tile_h = std::min(kTileSize, config.height - tile_y);
 
-            config.normalImage[4 * (y * config.width + x) + 0] =
-                0.5f * N[0] + 0.5f;
-            config.normalImage[4 * (y * config.width + x) + 1] =
-                0.5f * N[1] + 0.5f;
-            config.normalImage[4 * (y * config.width + x) + 2] =
-                0.5f * N[2] + 0.5f;
-            config.normalImage[4 * (y * config.width + x) + 3] = 1.0f;
-
-            config.depthImage[4 * (y * config.width + x) + 0] =
-                isect.t;
-            config.depthImage[4 * (y * config.width + x) + 1] =
-                isect.t;
-            config.depthImage[4 * (y * config.width + x) + 2] =
-                isect.t;
-            config.depthImage[4 * (y * config.width + x) + 3] = 1.0f;
-
-            float3 UV;
-            if (mesh.facevarying_uvs.size() > 0) {
-              float3 uv0, uv1, uv2;
-              uv0[0] = mesh.facevarying_uvs[6 * prim_id + 0];
-              uv0[1] = mesh.facevarying_uvs[6 * prim_id + 1];
-              uv1[0] = mesh.facevarying_uvs[6 * prim_id + 2];
-              uv1[1] = mesh.facevarying_uvs[6 * prim_id + 3];
-              uv2[0] = mesh.facevarying_uvs[6 * prim_id + 4];
-              uv2[1] = mesh.facevarying_uvs[6 * prim_id + 5];
-
-              UV = Lerp3(uv0, uv1, uv2, isect.u, isect.v);
-
-              config.texcoordImage[4 * (y * config.width + x) + 0] = UV[0];
-              config.texcoordImage[4 * (y * config.width + x) + 1] = UV[1];
-            }
+        // for modes not a "color", only one pass
+        bool skip = (_showBufferMode != SHOW_BUFFER_COLOR) && (config.pass > 0);
 
-            // Fetch texture
-            unsigned int material_id =
-                mesh.material_ids[isect.prim_id];
-				
-			//printf("material_id=%d materials=%lld\n", material_id, materials.size());
-
-            float diffuse_col[3];
-
-            float specular_col[3];
-			
-			//tigra: material_id is ok
-			if(material_id<materials.size())
-			{
-				//printf("ok mat\n");
-				
-				int diffuse_texid = materials[material_id].diffuse_texid;
-				if (diffuse_texid >= 0) {
-				  FetchTexture(textures[diffuse_texid], UV[0], UV[1], diffuse_col);
-				} else {
-				  diffuse_col[0] = materials[material_id].diffuse[0];
-				  diffuse_col[1] = materials[material_id].diffuse[1];
-				  diffuse_col[2] = materials[material_id].diffuse[2];
-				}
-				
-				int specular_texid = materials[material_id].specular_texid;
-				if (specular_texid >= 0) {
-				  FetchTexture(textures[specular_texid], UV[0], UV[1], specular_col);
-				} else {
-				  specular_col[0] = materials[material_id].specular[0];
-				  specular_col[1] = materials[material_id].specular[1];
-				  specular_col[2] = materials[material_id].specular[2];
-				}
-			}
-			else
-				//tigra: wrong material_id, use default_material
-				{
-					
-				//printf("default_material\n");
-				
-					diffuse_col[0] = default_material.diffuse[0];
-					diffuse_col[1] = default_material.diffuse[1];
-					diffuse_col[2] = default_material.diffuse[2];
-					specular_col[0] = default_material.specular[0];
-					specular_col[1] = default_material.specular[1];
-					specular_col[2] = default_material.specular[2];
-				}
-
-            // Simple shading
-            float NdotV = fabsf(vdot(N, dir));
-
-            if (config.pass == 0) {
-              rgba[4 * (y * config.width + x) + 0] = NdotV * diffuse_col[0];
-              rgba[4 * (y * config.width + x) + 1] = NdotV * diffuse_col[1];
-              rgba[4 * (y * config.width + x) + 2] = NdotV * diffuse_col[2];
-              rgba[4 * (y * config.width + x) + 3] = 1.0f;
-              sample_counts[y * config.width + x] =
-                  1;  // Set 1 for the first pass
-            } else {  // additive.
-              rgba[4 * (y * config.width + x) + 0] += NdotV * diffuse_col[0];
-              rgba[4 * (y * config.width + x) + 1] += NdotV * diffuse_col[1];
-              rgba[4 * (y * config.width + x) + 2] += NdotV * diffuse_col[2];
-              rgba[4 * (y * config.width + x) + 3] += 1.0f;
-              sample_counts[y * config.width + x]++;
-            }
+        // Converged tiles are skipped, and noisy ones take more samples.
+        int num_samples = 1;
+        if (_showBufferMode == SHOW_BUFFER_COLOR) {
+          num_samples = TileSampleCount(tile_x, tile_y, tile_w, tile_h, config,
+                                        rgba, aux_rgba, sample_counts);
+        }
 
-          } else {
-            {
-              if (config.pass == 0) {
-                // clear pixel
-                rgba[4 * (y * config.width + x) + 0] = 0.0f;
-                rgba[4 * (y * config.width + x) + 1] = 0.0f;
-                rgba[4 * (y * config.width + x) + 2] = 0.0f;
-                rgba[4 * (y * config.width + x) + 3] = 0.0f;
-                aux_rgba[4 * (y * config.width + x) + 0] = 0.0f;
-                aux_rgba[4 * (y * config.width + x) + 1] = 0.0f;
-                aux_rgba[4 * (y * config.width + x) + 2] = 0.0f;
-                aux_rgba[4 * (y * config.width + x) + 3] = 0.0f;
-                sample_counts[y * config.width + x] =
-                    1;  // Set 1 for the first pass
-              } else {
-                sample_counts[y * config.width + x]++;
+        for (int s = 0; !skip && (s < num_samples); s++) {
+          for (int py = 0; py < tile_h; py += kPacketHeight) {
+            for (int px = 0; px < tile_w; px += kPacketWidth) {
+              RayPacket packet;
+              packet.mask = 0;
+
+              for (int lane = 0; lane < RayPacket::kWidth; lane++) {
+                int x = tile_x + px + (lane % kPacketWidth);
+                int y = tile_y + py + (lane / kPacketWidth);
+
+                float u0 = pcg32_random(&rng);
+                float u1 = pcg32_random(&rng);
+
+                if (_showBufferMode != SHOW_BUFFER_COLOR) {
+                  // to the center of pixel
+                  u0 = 0.5f;
+                  u1 = 0.5f;
+                }
+
+                // Keep out-of-image lanes valid but inactive.
+                float3 dir = corner + (float(x) + u0) * u +
+                             (float(config.height - y - 1) + u1) * v;
+                dir = vnormalize(dir);
+
+                for (int k = 0; k < 3; k++) {
+                  packet.org[k][lane] = origin[k];
+                  packet.dir[k][lane] = dir[k];
+                }
+
+                float kFar = 1.0e+30f;
+                packet.min_t[lane] = 0.0f;
+                packet.max_t[lane] = kFar;
+
+                if ((x < config.width) && (y < config.height)) {
+                  packet.mask |= (1u << lane);
+                }
               }
 
-              // No super sampling
-              config.normalImage[4 * (y * config.width + x) + 0] = 0.0f;
-              config.normalImage[4 * (y * config.width + x) + 1] = 0.0f;
-              config.normalImage[4 * (y * config.width + x) + 2] = 0.0f;
-              config.normalImage[4 * (y * config.width + x) + 3] = 0.0f;
-              config.positionImage[4 * (y * config.width + x) + 0] = 0.0f;
-              config.positionImage[4 * (y * config.width + x) + 1] = 0.0f;
-              config.positionImage[4 * (y * config.width + x) + 2] = 0.0f;
-              config.positionImage[4 * (y * config.width + x) + 3] = 0.0f;
-              config.depthImage[4 * (y * config.width + x) + 0] = 0.0f;
-              config.depthImage[4 * (y * config.width + x) + 1] = 0.0f;
-              config.depthImage[4 * (y * config.width + x) + 2] = 0.0f;
-              config.depthImage[4 * (y * config.width + x) + 3] = 0.0f;
-              config.texcoordImage[4 * (y * config.width + x) + 0] = 0.0f;
-              config.texcoordImage[4 * (y * config.width + x) + 1] = 0.0f;
-              config.texcoordImage[4 * (y * config.width + x) + 2] = 0.0f;
-              config.texcoordImage[4 * (y * config.width + x) + 3] = 0.0f;
-              config.varycoordImage[4 * (y * config.width + x) + 0] = 0.0f;
-              config.varycoordImage[4 * (y * config.width + x) + 1] = 0.0f;
-              config.varycoordImage[4 * (y * config.width + x) + 2] = 0.0f;
-              config.varycoordImage[4 * (y * config.width + x) + 3] = 0.0f;
+              nanosg::Intersection<float> isects[RayPacket::kWidth];
+              unsigned int hits = scene.TraversePacket(
+                  packet, isects, /* cull_back_face */ false);
+
+              for (int lane = 0; lane < RayPacket::kWidth; lane++) {
+                if (!(packet.mask & (1u << lane))) continue;
+
+                int x = tile_x + px + (lane % kPacketWidth);
+                int y = tile_y + py + (lane / kPacketWidth);
+
+                if (hits & (1u << lane)) {
+                  float3 org(packet.org[0][lane], packet.org[1][lane],
+                             packet.org[2][lane]);
+                  float3 dir(packet.dir[0][lane], packet.dir[1][lane],
+                             packet.dir[2][lane]);
+                  ShadeHit(x, y, org, dir, isects[lane], asset, config, rgba,
+                           aux_rgba, sample_counts);
+                } else {
+                  ShadeMiss(x, y, config, rgba, aux_rgba, sample_counts);
+                }
+              }
             }
           }
         }
-
-        for (int x = 0; x < config.width; x++) {
-          aux_rgba[4 * (y * config.width + x) + 0] = 0.0f;
-          aux_rgba[4 * (y * config.width + x) + 1] = 0.0f;
-          aux_rgba[4 * (y * config.width + x) + 2] = 0.0f;
-          aux_rgba[4 * (y * config.width + x) + 3] = 0.0f;
-        }
       }
     }));
   }
@@ -0,0 +1,176 @@
+// Base64 throughput of TinyGLTF against the previous implementation.
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "tiny_gltf.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace legacy {
+
+// base64.cpp, Copyright (C) 2004-2008 René Nyffenegger, as TinyGLTF used it
+// before the table-driven rewrite.
+
+static inline bool is_base64(unsigned char c) {
+  return (isalnum(c) || (c == '+') || (c == '/'));
+}
+
+std::string base64_encode(unsigned char const *bytes_to_encode,
+                          unsigned int in_len) {
+  std::string ret;
+  int i = 0;
+  int j = 0;
+  unsigned char char_array_3[3];
+  unsigned char char_array_4[4];
+
+  const char *base64_chars =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+      "abcdefghijklmnopqrstuvwxyz"
+      "0123456789+/";
+
+  while (in_len--) {
+    char_array_3[i++] = *(bytes_to_encode++);
+    if (i == 3) {
+      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+      char_array_4[1] =
+          ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+      char_array_4[2] =
+          ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+      char_array_4[3] = char_array_3[2] & 0x3f;
+
+      for (i = 0; (i < 4); i++) ret += base64_chars[char_array_4[i]];
+      i = 0;
+    }
+  }
+
+  if (i) {
+    for (j = i; j < 3; j++) char_array_3[j] = '\0';
+
+    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+    char_array_4[1] =
+        ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+    char_array_4[2] =
+        ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+
+    for (j = 0; (j < i + 1); j++) ret += base64_chars[char_array_4[j]];
+
+    while ((i++ < 3)) ret += '=';
+  }
+
+  return ret;
+}
+
+std::string base64_decode(std::string const &encoded_string) {
+  int in_len = static_cast<int>(encoded_string.size());
+  int i = 0;
+  int j = 0;
+  int in_ = 0;
+  unsigned char char_array_4[4], char_array_3[3];
+  std::string ret;
+
+  const std::string base64_chars =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+      "abcdefghijklmnopqrstuvwxyz"
+      "0123456789+/";
+
+  while (in_len-- && (encoded_string[in_] != '=') &&
+         is_base64(encoded_string[in_])) {
+    char_array_4[i++] = encoded_string[in_];
+    in_++;
+    if (i == 4) {
+      for (i = 0; i < 4; i++)
+        char_array_4[i] =
+            static_cast<unsigned char>(base64_chars.find(char_array_4[i]));
+
+      char_array_3[0] =
+          (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+      char_array_3[1] =
+          ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+      for (i = 0; (i < 3); i++) ret += char_array_3[i];
+      i = 0;
+    }
+  }
+
+  if (i) {
+    for (j = i; j < 4; j++) char_array_4[j] = 0;
+
+    for (j = 0; j < 4; j++)
+      char_array_4[j] =
+          static_cast<unsigned char>(base64_chars.find(char_array_4[j]));
+
+    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+    char_array_3[1] =
+        ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+    for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
+  }
+
+  return ret;
+}
+
+}  // namespace legacy
+
+template <typename F>
+static double Seconds(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  return d.count();
+}
+
+static void Report(const char *name, size_t bytes, double seconds) {
+  printf("  %-28s %8.1f ms %10.1f MB/s\n", name, seconds * 1e3,
+         double(bytes) / (1024.0 * 1024.0) / seconds);
+}
+
+int main(int argc, char **argv) {
+  size_t mb = 64;
+  if (argc > 1) {
+    mb = size_t(atoi(argv[1]));
+  }
+
+  std::vector<unsigned char> data(mb * 1024 * 1024);
+  unsigned int seed = 12345;
+  for (auto &b : data) {
+    seed = seed * 1664525u + 1013904223u;
+    b = static_cast<unsigned char>(seed >> 24);
+  }
+  const unsigned int size = static_cast<unsigned int>(data.size());
+
+  printf("base64, %u MB (rates in raw bytes)\n", unsigned(mb));
+
+  std::string text_old, text_new;
+  printf("encode\n");
+  Report("legacy", data.size(), Seconds([&] {
+           text_old = legacy::base64_encode(data.data(), size);
+         }));
+  Report("tinygltf", data.size(), Seconds([&] {
+           text_new = tinygltf::base64_encode(data.data(), size);
+         }));
+
+  // The data URI path used to decode to a string and copy it
+  std::vector<unsigned char> out_old, out_new;
+  printf("decode\n");
+  Report("legacy (string + copy)", data.size(), Seconds([&] {
+           std::string s = legacy::base64_decode(text_old);
+           out_old.assign(s.begin(), s.end());
+         }));
+  Report("tinygltf (into vector)", data.size(), Seconds([&] {
+           tinygltf::base64_decode(text_new.data(), text_new.size(),
+                                   &out_new);
+         }));
+
+  if (text_old != text_new || out_old != data || out_new != data) {
+    fprintf(stderr, "mismatch between implementations\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
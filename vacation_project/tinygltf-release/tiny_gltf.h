@@ -46,10 +46,18 @@
 #include <functional>
 #include <limits>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#ifdef TINYGLTF_USE_ARENA
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#endif
+
 #ifdef __ANDROID__
 #ifdef TINYGLTF_ANDROID_LOAD_FROM_ASSETS
 #include <android/asset_manager.h>
@@ -245,6 +253,123 @@ bool IsDataURI(const std::string &in);
 bool DecodeDataURI(std::vector<unsigned char> *out, std::string &mime_type,
                    const std::string &in, size_t reqBytes, bool checkSize);
 
+#ifdef TINYGLTF_USE_ARENA
+
+///
+/// Monotonic arena for a Model's Value trees (extras, extensions).
+/// Memory is only handed out, never returned; the blocks are released
+/// together when the arena is destroyed. Allocation is thread-safe.
+///
+class Arena {
+ public:
+  explicit Arena(size_t block_size = 64 * 1024)
+      : block_size_(block_size) {}
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *Allocate(size_t n, size_t align);
+
+  /// Bytes handed out so far
+  size_t BytesUsed() const { return used_.load(std::memory_order_relaxed); }
+
+  /// Arena new containers on this thread allocate from; null: the heap
+  static std::shared_ptr<Arena> Current();
+
+  /// Makes `arena` current on this thread for the scope's lifetime
+  class Scope {
+   public:
+    explicit Scope(std::shared_ptr<Arena> arena);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+   private:
+    std::shared_ptr<Arena> arena_;
+    const std::shared_ptr<Arena> *prev_;
+  };
+
+ private:
+  struct Block {
+    Block *next;
+    size_t size;
+    std::atomic<size_t> used;
+    unsigned char *Data() { return reinterpret_cast<unsigned char *>(this + 1); }
+  };
+
+  static Block *NewBlock(size_t size, Block *next);
+  Block *Grow(Block *seen);
+  void *AllocateLarge(size_t n, size_t align);
+
+  size_t block_size_;
+  std::atomic<Block *> head_{nullptr};
+  Block *large_ = nullptr;  // oversized allocations, one block each
+  std::atomic<size_t> used_{0};
+  std::mutex grow_mutex_;
+};
+
+///
+/// Allocator drawing from the arena current where the container was
+/// created, or the heap outside any arena. Deallocation into an arena is
+/// a no-op. Every container shares ownership of its arena, so the blocks
+/// go once the last container using them does. Copies allocate from the
+/// arena current at copy time; moves keep the source's arena.
+///
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+  typedef std::false_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  ArenaAllocator() noexcept : arena_(Arena::Current()) {}
+  explicit ArenaAllocator(std::shared_ptr<Arena> arena) noexcept
+      : arena_(std::move(arena)) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) noexcept
+      : arena_(other.shared_arena()) {}
+
+  T *allocate(size_t n) {
+    if (arena_) {
+      return static_cast<T *>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    }
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, size_t) noexcept {
+    if (!arena_) {
+      ::operator delete(p);
+    }
+  }
+
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+
+  Arena *arena() const noexcept { return arena_.get(); }
+  const std::shared_ptr<Arena> &shared_arena() const noexcept {
+    return arena_;
+  }
+
+ private:
+  std::shared_ptr<Arena> arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return a.arena() != b.arena();
+}
+
+#endif  // TINYGLTF_USE_ARENA
+
 #ifdef __clang__
 #pragma clang diagnostic push
 // Suppress warning for : static Value null_value
@@ -255,8 +380,15 @@ bool DecodeDataURI(std::vector<unsigned char> *out, std::string &mime_type,
 // Simple class to represent JSON object
 class Value {
  public:
+#ifdef TINYGLTF_USE_ARENA
+  typedef std::vector<Value, ArenaAllocator<Value>> Array;
+  typedef std::map<std::string, Value, std::less<std::string>,
+                   ArenaAllocator<std::pair<const std::string, Value>>>
+      Object;
+#else
   typedef std::vector<Value> Array;
   typedef std::map<std::string, Value> Object;
+#endif
 
   Value() = default;
 
@@ -513,7 +645,7 @@ struct Parameter {
 #endif
 
 typedef std::map<std::string, Parameter> ParameterMap;
-typedef std::map<std::string, Value> ExtensionMap;
+typedef Value::Object ExtensionMap;
 
 struct AnimationChannel {
   int sampler{-1};          // required
@@ -646,6 +778,13 @@ struct Image {
   // parsing).
   bool as_is{false};
 
+  // Set when loaded with TinyGLTF::SetDeferImageDecoding: `image` stays
+  // empty until TinyGLTF::DecodeImage. The encoded bytes are in
+  // `bufferView`, in `encoded` (data URI) or in the file `encoded_path`.
+  bool deferred{false};
+  std::vector<unsigned char> encoded;
+  std::string encoded_path;
+
   Image() = default;
   DEFAULT_METHODS(Image)
 
@@ -1037,6 +1176,19 @@ struct Buffer {
   std::string extras_json_string;
   std::string extensions_json_string;
 
+  // Non-owning, read-only view used instead of `data` when the GLB BIN
+  // chunk was memory mapped (see TinyGLTF::SetMapBinaryFiles). `mapping`
+  // keeps the file mapped while any Buffer refers to it.
+  const unsigned char *mapped_data = nullptr;
+  size_t mapped_size = 0;
+  std::shared_ptr<const void> mapping;
+
+  // Buffer contents, owned or mapped.
+  const unsigned char *Data() const {
+    return mapped_data ? mapped_data : data.data();
+  }
+  size_t Size() const { return mapped_data ? mapped_size : data.size(); }
+
   Buffer() = default;
   DEFAULT_METHODS(Buffer)
   bool operator==(const Buffer &) const;
@@ -1203,6 +1355,12 @@ class Model {
 
   bool operator==(const Model &) const;
 
+#ifdef TINYGLTF_USE_ARENA
+  /// Arena of the extras and extensions of a loaded Model. Their containers
+  /// hold it too; it is released in one go with the last of them.
+  std::shared_ptr<Arena> arena;
+#endif
+
   std::vector<Accessor> accessors;
   std::vector<Animation> animations;
   std::vector<Buffer> buffers;
@@ -1349,6 +1507,14 @@ bool WriteWholeFile(std::string *err, const std::string &filepath,
 
 bool GetFileSizeInBytes(size_t *filesize_out, std::string *err,
                         const std::string &filepath, void *);
+
+///
+/// Maps a whole file read-only. `*keep_alive` unmaps it when its last copy
+/// is released.
+///
+bool MapWholeFile(const unsigned char **out, size_t *size,
+                  std::shared_ptr<const void> *keep_alive, std::string *err,
+                  const std::string &filepath);
 #endif
 
 ///
@@ -1385,6 +1551,17 @@ bool WriteImageData(const std::string *basepath, const std::string *filename,
                     std::string *out_uri, void *);
 #endif
 
+///
+/// Part of an asset to load (see TinyGLTF::SetLoadSubset): the nodes of
+/// `scene`, or `nodes` and their descendants when any are given. With
+/// neither, the default scene (else scene 0), or every root node when the
+/// asset has no scenes.
+///
+struct ModelSubset {
+  int scene{-1};
+  std::vector<int> nodes;
+};
+
 ///
 /// glTF Parser/Serializer context.
 ///
@@ -1543,6 +1720,82 @@ class TinyGLTF {
 
   bool GetImagesAsIs() const { return images_as_is_; }
 
+  ///
+  /// Memory map files in `LoadBinaryFromFile` instead of reading them.
+  /// The embedded BIN chunk is then not copied: the buffer refers to the
+  /// mapping through `Buffer::mapped_data` (read it with `Buffer::Data()`).
+  /// Uses the built-in file system, not the ReadWholeFile callback.
+  /// Falls back to reading the file when it cannot be mapped.
+  ///
+  void SetMapBinaryFiles(bool onoff) { map_binary_files_ = onoff; }
+
+  bool GetMapBinaryFiles() const { return map_binary_files_; }
+
+  ///
+  /// Number of threads decoding images while loading. 0 (default) uses all
+  /// hardware threads with the built-in loader and one thread with a loader
+  /// set by `SetImageLoader`, which must be thread-safe to use more.
+  /// Images land in `Model::images` in file order either way.
+  /// (Always 1 when TINYGLTF_NO_THREADS is defined)
+  ///
+  void SetImageDecodeThreads(unsigned int n) { image_decode_threads_ = n; }
+
+  unsigned int GetImageDecodeThreads() const { return image_decode_threads_; }
+
+  ///
+  /// Number of threads building the Model from the parsed JSON (default 1).
+  /// 0 uses all hardware threads. The elements of each top-level array
+  /// (nodes, accessors, meshes, ...) are then parsed concurrently; the
+  /// Model, errors and warnings are the same as with one thread.
+  /// Buffers and images stay on the calling thread, as they may call
+  /// user file system and URI callbacks.
+  /// (Always 1 when TINYGLTF_NO_THREADS is defined)
+  ///
+  void SetParseThreads(unsigned int n) { parse_threads_ = n; }
+
+  unsigned int GetParseThreads() const { return parse_threads_; }
+
+  ///
+  /// Load only part of each asset. Nodes, meshes, skins, accessors, buffer
+  /// views, materials and animations are limited to what the subset
+  /// references and renumbered; the Model holds one scene (index 0) with
+  /// the subset's roots. Animations keep just the channels driving loaded
+  /// nodes. Accessors of EXT_mesh_gpu_instancing and materials of
+  /// KHR_materials_variants mappings are kept and renumbered too. Images
+  /// not used by a loaded material are left empty, so image, texture,
+  /// sampler, camera and light indices stay those of the file.
+  /// Buffers are cut down to the byte ranges of the loaded views; only the
+  /// buffers those views use are read, and with `SetMapBinaryFiles` only
+  /// the touched pages of a GLB BIN chunk. Draco compressed meshes are not
+  /// supported.
+  ///
+  void SetLoadSubset(const ModelSubset &subset) {
+    subset_ = subset;
+    load_subset_ = true;
+  }
+
+  /// Load whole assets again (the default)
+  void ClearLoadSubset() { load_subset_ = false; }
+
+  ///
+  /// Leave images encoded while loading (default false). Each image records
+  /// where its bytes are and is marked `Image::deferred`; decode it later
+  /// with `DecodeImage`. External image files are located but not read.
+  ///
+  void SetDeferImageDecoding(bool onoff) { defer_image_decoding_ = onoff; }
+
+  bool GetDeferImageDecoding() const { return defer_image_decoding_; }
+
+  ///
+  /// Decodes a deferred image into `Image::image` with this loader's image
+  /// settings. Does nothing for images that are not deferred. May run
+  /// concurrently for different images of one model, provided the image
+  /// loader is thread-safe (the built-in one is) and the model's buffers
+  /// are not modified meanwhile.
+  ///
+  bool DecodeImage(Model *model, int image_idx, std::string *err,
+                   std::string *warn) const;
+
   ///
   /// Set maximum allowed external file size in bytes.
   /// Default: 2GB
@@ -1567,6 +1820,7 @@ class TinyGLTF {
 
   const unsigned char *bin_data_ = nullptr;
   size_t bin_size_ = 0;
+  std::shared_ptr<const void> bin_mapping_;  // set while loading a mapped GLB
   bool is_binary_ = false;
 
   ParseStrictness strictness_ = ParseStrictness::Strict;
@@ -1580,6 +1834,16 @@ class TinyGLTF {
 
   bool images_as_is_ = false; /// Default false (decode/decompress images)
 
+  bool map_binary_files_ = false;  /// Default false (read GLB into memory)
+
+  unsigned int image_decode_threads_ = 0;  /// Default 0 (automatic)
+  unsigned int parse_threads_ = 1;         /// Default 1 (serial)
+
+  bool defer_image_decoding_ = false;  /// Default false (decode during load)
+
+  bool load_subset_ = false;  /// Default false (load everything)
+  ModelSubset subset_;
+
   size_t max_external_file_size_{
       size_t((std::numeric_limits<int32_t>::max)())};  // Default 2GB
 
@@ -1646,9 +1910,37 @@ class TinyGLTF {
 
 #include <cstdio>
 #include <fstream>
+
+#if !defined(_WIN32) && !defined(TINYGLTF_ANDROID_LOAD_FROM_ASSETS)
+#include <fcntl.h>     // open
+#include <sys/mman.h>  // mmap
+#include <unistd.h>    // close
+#endif
 #endif
 #include <sstream>
 
+#ifndef TINYGLTF_NO_THREADS
+#include <atomic>
+#include <thread>
+#endif
+
+#ifdef TINYGLTF_USE_TAPE_JSON
+#ifdef TINYGLTF_USE_RAPIDJSON
+#error "TINYGLTF_USE_TAPE_JSON and TINYGLTF_USE_RAPIDJSON are exclusive"
+#endif
+#include <cerrno>     // strtoll/strtoull range errors
+#include <cfloat>     // FLT_EVAL_METHOD
+#include <stdexcept>  // parse errors
+#endif
+
+#ifndef TINYGLTF_NO_SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>  // base64 AVX2 and SSSE3 paths
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>  // base64 SSSE3 path
+#endif
+#endif
+
 #ifdef __clang__
 // Disable some warnings for external files.
 #pragma clang diagnostic push
@@ -1871,90 +2163,872 @@ using json_const_array_iterator = json_const_iterator;
 using JsonDocument = json;
 #endif
 
-void JsonParse(JsonDocument &doc, const char *str, size_t length,
-               bool throwExc = false) {
-#ifdef TINYGLTF_USE_RAPIDJSON
-  (void)throwExc;
-  doc.Parse(str, length);
-#else
-  doc = detail::json::parse(str, str + length, nullptr, throwExc);
-#endif
-}
-}  // namespace detail
-}  // namespace tinygltf
+#ifdef TINYGLTF_USE_TAPE_JSON
+// Read-only JSON used for loading. One pass over the text fills flat
+// arrays (values, object members, array elements) instead of a tree of
+// maps and strings. Strings without escapes are not copied: they point
+// into the input, which must outlive the document. Members are sorted by
+// key, keeping the last of duplicates, so objects read exactly as they do
+// through nlohmann::json.
+
+struct JsonTape;
+
+struct JsonTapeValue {
+  enum Type : unsigned char {
+    kNull,
+    kBoolean,
+    kInteger,   // negative integer
+    kUnsigned,  // non-negative integer
+    kFloat,
+    kString,
+    kArray,
+    kObject
+  };
 
-#ifdef __APPLE__
-#include "TargetConditionals.h"
-#endif
+  const JsonTape *tape;
+  Type type;
+  bool decoded;    // string is in the tape's arena, not the input
+  uint32_t first;  // string offset, or first member/element
+  uint32_t count;  // string length, or member/element count
+  union {
+    bool boolean;
+    int64_t integer;
+    uint64_t unsigned_integer;
+    double number;
+  };
+};
 
-#ifdef __clang__
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wc++98-compat"
-#endif
+struct JsonTapeMember {
+  uint32_t key;  // offset in the input, or in the arena when decoded
+  uint32_t key_length;
+  uint32_t value;  // index in JsonTape::values
+  bool key_decoded;
+};
 
-namespace tinygltf {
+struct JsonTape {
+  const char *input = nullptr;
+  std::vector<JsonTapeValue> values;    // values[0] is the root
+  std::vector<JsonTapeMember> members;  // per object, contiguous
+  std::vector<uint32_t> elements;       // per array, contiguous
+  std::vector<char> arena;              // strings that had escapes
 
-///
-/// Internal LoadImageDataOption struct.
-/// This struct is passed through `user_pointer` in LoadImageData.
-/// The struct is not passed when the user supply their own LoadImageData
-/// callbacks.
-///
-struct LoadImageDataOption {
-  // true: preserve image channels(e.g. load as RGB image if the image has RGB
-  // channels) default `false`(channels are expanded to RGBA for backward
-  // compatibility).
-  bool preserve_channels{false};
-  // true: do not decode/decompress image data.
-  // default `false`: decode/decompress image data.
-  bool as_is{false};
+  const char *String(uint32_t offset, bool decoded) const {
+    return decoded ? arena.data() + offset : input + offset;
+  }
 };
 
-// Equals function for Value, for recursivity
-static bool Equals(const tinygltf::Value &one, const tinygltf::Value &other) {
-  if (one.Type() != other.Type()) return false;
+// Values point at their tape, which therefore stays put when the
+// document is moved
+struct JsonTapeDocument {
+  std::unique_ptr<JsonTape> tape{new JsonTape()};
 
-  switch (one.Type()) {
-    case NULL_TYPE:
-      return true;
-    case BOOL_TYPE:
-      return one.Get<bool>() == other.Get<bool>();
-    case REAL_TYPE:
-      return TINYGLTF_DOUBLE_EQUAL(one.Get<double>(), other.Get<double>());
-    case INT_TYPE:
-      return one.Get<int>() == other.Get<int>();
-    case OBJECT_TYPE: {
-      auto oneObj = one.Get<tinygltf::Value::Object>();
-      auto otherObj = other.Get<tinygltf::Value::Object>();
-      if (oneObj.size() != otherObj.size()) return false;
-      for (auto &it : oneObj) {
-        auto otherIt = otherObj.find(it.first);
-        if (otherIt == otherObj.end()) return false;
+  // The root; null when parsing failed
+  operator const JsonTapeValue &() const {
+    static const JsonTapeValue null_value = {nullptr, JsonTapeValue::kNull,
+                                             false, 0, 0, {false}};
+    return tape->values.empty() ? null_value : tape->values[0];
+  }
+};
 
-        if (!Equals(it.second, otherIt->second)) return false;
+struct JsonTapeMemberIterator {
+  const JsonTape *tape = nullptr;
+  const JsonTapeMember *member = nullptr;
+
+  JsonTapeMemberIterator &operator++() {
+    ++member;
+    return *this;
+  }
+  bool operator==(const JsonTapeMemberIterator &rhs) const {
+    return member == rhs.member;
+  }
+  bool operator!=(const JsonTapeMemberIterator &rhs) const {
+    return member != rhs.member;
+  }
+};
+
+struct JsonTapeArrayIterator {
+  const JsonTape *tape = nullptr;
+  const uint32_t *element = nullptr;
+
+  const JsonTapeValue &operator*() const { return tape->values[*element]; }
+  JsonTapeArrayIterator &operator++() {
+    ++element;
+    return *this;
+  }
+  bool operator==(const JsonTapeArrayIterator &rhs) const {
+    return element == rhs.element;
+  }
+  bool operator!=(const JsonTapeArrayIterator &rhs) const {
+    return element != rhs.element;
+  }
+};
+
+class JsonTapeParser {
+ public:
+  JsonTapeParser(JsonTape *tape, const char *str, size_t length)
+      : tape_(tape), begin_(str), p_(str), end_(str + length) {}
+
+  bool Parse() {
+    tape_->input = begin_;
+    tape_->values.clear();
+    tape_->members.clear();
+    tape_->elements.clear();
+    tape_->arena.clear();
+
+    // UTF-8 byte order mark
+    if (end_ - p_ >= 3 && p_[0] == '\xEF' && p_[1] == '\xBB' &&
+        p_[2] == '\xBF') {
+      p_ += 3;
+    }
+
+    for (;;) {
+      // A value starts here
+      SkipWhitespace();
+      if (p_ == end_) {
+        return Fail("unexpected end of input");
+      }
+
+      const char c = *p_;
+      if (c == '{' || c == '[') {
+        ++p_;
+        const bool object = c == '{';
+        Frame frame;
+        frame.value = NewValue(object ? JsonTapeValue::kObject
+                                      : JsonTapeValue::kArray);
+        frame.scratch =
+            object ? scratch_members_.size() : scratch_elements_.size();
+        frame.object = object;
+        stack_.push_back(frame);
+
+        SkipWhitespace();
+        if (p_ != end_ && *p_ == (object ? '}' : ']')) {
+          ++p_;
+          Close();
+        } else {
+          if (object && !ParseKey()) {
+            return false;
+          }
+          continue;
+        }
+      } else if (!ParseScalar()) {
+        return false;
+      }
+
+      // After a value: the next one in its container, or close containers
+      for (;;) {
+        if (stack_.empty()) {
+          SkipWhitespace();
+          return p_ == end_ ? true : Fail("unexpected trailing characters");
+        }
+
+        const bool object = stack_.back().object;
+        SkipWhitespace();
+        if (p_ == end_) {
+          return Fail("unexpected end of input");
+        }
+        if (*p_ == ',') {
+          ++p_;
+          if (object && !ParseKey()) {
+            return false;
+          }
+          break;
+        }
+        if (*p_ != (object ? '}' : ']')) {
+          return Fail(object ? "expected ',' or '}'" : "expected ',' or ']'");
+        }
+        ++p_;
+        Close();
+      }
+    }
+  }
+
+  const std::string &error() const { return error_; }
+
+ private:
+  struct Frame {
+    uint32_t value;
+    size_t scratch;  // where this container's entries start
+    bool object;
+  };
+
+  bool Fail(const char *message) {
+    error_ = "JSON parse error at byte " + std::to_string(p_ - begin_) +
+             ": " + message;
+    return false;
+  }
+
+  void SkipWhitespace() {
+    while (p_ != end_ &&
+           (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) {
+      ++p_;
+    }
+  }
+
+  // Appends a value and attaches it to the open container, if any
+  uint32_t NewValue(JsonTapeValue::Type type) {
+    JsonTapeValue value;
+    value.tape = tape_;
+    value.type = type;
+    value.decoded = false;
+    value.first = 0;
+    value.count = 0;
+    value.unsigned_integer = 0;
+
+    const uint32_t index = static_cast<uint32_t>(tape_->values.size());
+    tape_->values.push_back(value);
+
+    if (!stack_.empty()) {
+      if (stack_.back().object) {
+        scratch_members_.back().value = index;
+      } else {
+        scratch_elements_.push_back(index);
+      }
+    }
+    return index;
+  }
+
+  // Moves the innermost container's entries to the tape
+  void Close() {
+    const Frame frame = stack_.back();
+    stack_.pop_back();
+    JsonTapeValue &value = tape_->values[frame.value];
+
+    if (!frame.object) {
+      value.first = static_cast<uint32_t>(tape_->elements.size());
+      value.count =
+          static_cast<uint32_t>(scratch_elements_.size() - frame.scratch);
+      tape_->elements.insert(tape_->elements.end(),
+                             scratch_elements_.begin() + long(frame.scratch),
+                             scratch_elements_.end());
+      scratch_elements_.resize(frame.scratch);
+      return;
+    }
+
+    auto first = scratch_members_.begin() + long(frame.scratch);
+    auto last = scratch_members_.end();
+    const JsonTape *tape = tape_;
+    auto less = [tape](const JsonTapeMember &a, const JsonTapeMember &b) {
+      return KeyCompare(tape, a, b) < 0;
+    };
+    if (last - first > 16) {
+      std::stable_sort(first, last, less);
+    } else {
+      // Insertion sort: stable, in place, and objects are small
+      for (auto it = first + (first != last); it < last; ++it) {
+        const JsonTapeMember m = *it;
+        auto hole = it;
+        for (; hole != first && less(m, *(hole - 1)); --hole) {
+          *hole = *(hole - 1);
+        }
+        *hole = m;
+      }
+    }
+
+    value.first = static_cast<uint32_t>(tape_->members.size());
+    for (auto it = first; it != last; ++it) {
+      // A repeated key replaces the earlier member
+      if (tape_->members.size() > value.first &&
+          KeyCompare(tape, tape_->members.back(), *it) == 0) {
+        tape_->members.back() = *it;
+      } else {
+        tape_->members.push_back(*it);
+      }
+    }
+    value.count = static_cast<uint32_t>(tape_->members.size() - value.first);
+    scratch_members_.resize(frame.scratch);
+  }
+
+  static int KeyCompare(const JsonTape *tape, const JsonTapeMember &a,
+                        const JsonTapeMember &b) {
+    const size_t n = std::min(a.key_length, b.key_length);
+    const int c = n ? memcmp(tape->String(a.key, a.key_decoded),
+                             tape->String(b.key, b.key_decoded), n)
+                    : 0;
+    if (c != 0) return c;
+    return a.key_length < b.key_length ? -1
+                                       : (a.key_length > b.key_length ? 1 : 0);
+  }
+
+  bool ParseKey() {
+    SkipWhitespace();
+    if (p_ == end_ || *p_ != '"') {
+      return Fail("expected a string as object key");
+    }
+
+    JsonTapeMember member;
+    if (!ParseString(&member.key, &member.key_length, &member.key_decoded)) {
+      return false;
+    }
+    member.value = 0;
+
+    SkipWhitespace();
+    if (p_ == end_ || *p_ != ':') {
+      return Fail("expected ':'");
+    }
+    ++p_;
+
+    scratch_members_.push_back(member);
+    return true;
+  }
+
+  bool ParseScalar() {
+    const char c = *p_;
+    if (c == '"') {
+      uint32_t offset, length;
+      bool decoded;
+      if (!ParseString(&offset, &length, &decoded)) {
+        return false;
       }
+      JsonTapeValue &value = tape_->values[NewValue(JsonTapeValue::kString)];
+      value.first = offset;
+      value.count = length;
+      value.decoded = decoded;
       return true;
     }
-    case ARRAY_TYPE: {
-      if (one.Size() != other.Size()) return false;
-      for (size_t i = 0; i < one.Size(); ++i)
-        if (!Equals(one.Get(i), other.Get(i))) return false;
+    if (c == '-' || (c >= '0' && c <= '9')) {
+      return ParseNumber();
+    }
+    if (Literal("true")) {
+      tape_->values[NewValue(JsonTapeValue::kBoolean)].boolean = true;
       return true;
     }
-    case STRING_TYPE:
-      return one.Get<std::string>() == other.Get<std::string>();
-    case BINARY_TYPE:
-      return one.Get<std::vector<unsigned char> >() ==
-             other.Get<std::vector<unsigned char> >();
-    default: {
-      // unhandled type
+    if (Literal("false")) {
+      tape_->values[NewValue(JsonTapeValue::kBoolean)].boolean = false;
+      return true;
+    }
+    if (Literal("null")) {
+      NewValue(JsonTapeValue::kNull);
+      return true;
+    }
+    return Fail("invalid value");
+  }
+
+  bool Literal(const char *word) {
+    const size_t n = strlen(word);
+    if (size_t(end_ - p_) < n || memcmp(p_, word, n) != 0) {
       return false;
     }
+    p_ += n;
+    return true;
   }
-}
 
-// Equals function for std::vector<double> using TINYGLTF_DOUBLE_EPSILON
-static bool Equals(const std::vector<double> &one,
+  // Same grammar and conversions as nlohmann::json: integers that fit are
+  // kept as integers, everything else goes through strtod.
+  bool ParseNumber() {
+    const char *start = p_;
+    bool integer = true;
+
+    if (*p_ == '-') ++p_;
+    if (p_ == end_ || !IsDigit(*p_)) return Fail("invalid number");
+    if (*p_ == '0') {
+      ++p_;
+    } else {
+      while (p_ != end_ && IsDigit(*p_)) ++p_;
+    }
+    if (p_ != end_ && *p_ == '.') {
+      integer = false;
+      ++p_;
+      if (p_ == end_ || !IsDigit(*p_)) return Fail("invalid number");
+      while (p_ != end_ && IsDigit(*p_)) ++p_;
+    }
+    if (p_ != end_ && (*p_ == 'e' || *p_ == 'E')) {
+      integer = false;
+      ++p_;
+      if (p_ != end_ && (*p_ == '+' || *p_ == '-')) ++p_;
+      if (p_ == end_ || !IsDigit(*p_)) return Fail("invalid number");
+      while (p_ != end_ && IsDigit(*p_)) ++p_;
+    }
+
+    if (FastNumber(start, integer)) {
+      return true;
+    }
+
+    // strto* need a terminated string
+    number_.assign(start, p_);
+    char *number_end = nullptr;
+
+    if (integer) {
+      errno = 0;
+      if (*start == '-') {
+        const long long x = std::strtoll(number_.c_str(), &number_end, 10);
+        if (errno == 0) {
+          tape_->values[NewValue(JsonTapeValue::kInteger)].integer = x;
+          return true;
+        }
+      } else {
+        const unsigned long long x =
+            std::strtoull(number_.c_str(), &number_end, 10);
+        if (errno == 0) {
+          tape_->values[NewValue(JsonTapeValue::kUnsigned)].unsigned_integer =
+              x;
+          return true;
+        }
+      }
+    }
+
+    tape_->values[NewValue(JsonTapeValue::kFloat)].number =
+        std::strtod(number_.c_str(), &number_end);
+    return true;
+  }
+
+  // Numbers strtod would convert exactly: integers of up to 18 digits,
+  // and decimals whose digits fit a double's mantissa scaled by an exact
+  // power of ten (Clinger's fast path). false leaves the rest to strto*.
+  bool FastNumber(const char *s, bool integer) {
+    static const double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                    1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                    1e18, 1e19, 1e20, 1e21, 1e22};
+    const bool negative = *s == '-';
+    if (negative) ++s;
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int scale = 0;
+    for (; s != p_ && IsDigit(*s); ++s, ++digits) {
+      mantissa = mantissa * 10 + uint64_t(*s - '0');
+    }
+    if (s != p_ && *s == '.') {
+      for (++s; s != p_ && IsDigit(*s); ++s, ++digits, --scale) {
+        mantissa = mantissa * 10 + uint64_t(*s - '0');
+      }
+    }
+    if (digits > 18) {
+      return false;
+    }
+
+    if (integer) {
+      if (negative) {
+        tape_->values[NewValue(JsonTapeValue::kInteger)].integer =
+            -int64_t(mantissa);
+      } else {
+        tape_->values[NewValue(JsonTapeValue::kUnsigned)].unsigned_integer =
+            mantissa;
+      }
+      return true;
+    }
+
+    if (s != p_) {  // exponent
+      ++s;
+      const bool negative_exponent = *s == '-';
+      if (*s == '+' || *s == '-') ++s;
+      int exponent = 0;
+      for (; s != p_; ++s) {
+        if (exponent > 1000) return false;
+        exponent = exponent * 10 + (*s - '0');
+      }
+      scale += negative_exponent ? -exponent : exponent;
+    }
+
+    if (mantissa > (uint64_t(1) << 53) || scale < -22 || scale > 22) {
+      return false;
+    }
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+    return false;  // extended precision would round twice
+#endif
+
+    double value = double(mantissa);
+    value = scale < 0 ? value / kPow10[-scale] : value * kPow10[scale];
+    tape_->values[NewValue(JsonTapeValue::kFloat)].number =
+        negative ? -value : value;
+    return true;
+  }
+
+  static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+  static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  bool ParseHex4(unsigned int *cp) {
+    if (end_ - p_ < 4) return false;
+    unsigned int v = 0;
+    for (int i = 0; i < 4; i++) {
+      const int h = HexValue(p_[i]);
+      if (h < 0) return false;
+      v = (v << 4) | unsigned(h);
+    }
+    p_ += 4;
+    (*cp) = v;
+    return true;
+  }
+
+  // Validates one multi-byte UTF-8 sequence (RFC 3629) and skips it
+  bool SkipUtf8() {
+    const unsigned char c = static_cast<unsigned char>(*p_);
+    int n = 0;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+      n = 1;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+      n = 2;
+      if (c == 0xE0) lo = 0xA0;
+      if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+      n = 3;
+      if (c == 0xF0) lo = 0x90;
+      if (c == 0xF4) hi = 0x8F;
+    } else {
+      return false;
+    }
+    if (end_ - p_ <= n) return false;
+    for (int i = 1; i <= n; i++) {
+      const unsigned char t = static_cast<unsigned char>(p_[i]);
+      if (t < lo || t > hi) return false;
+      lo = 0x80;
+      hi = 0xBF;
+    }
+    p_ += n + 1;
+    return true;
+  }
+
+  void AppendUtf8(unsigned int cp) {
+    std::vector<char> &a = tape_->arena;
+    if (cp < 0x80) {
+      a.push_back(char(cp));
+    } else if (cp < 0x800) {
+      a.push_back(char(0xC0 | (cp >> 6)));
+      a.push_back(char(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+      a.push_back(char(0xE0 | (cp >> 12)));
+      a.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+      a.push_back(char(0x80 | (cp & 0x3F)));
+    } else {
+      a.push_back(char(0xF0 | (cp >> 18)));
+      a.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+      a.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+      a.push_back(char(0x80 | (cp & 0x3F)));
+    }
+  }
+
+  // After the backslash; appends the character to the arena
+  bool ParseEscape() {
+    if (p_ == end_) return Fail("unterminated string");
+    const char c = *p_++;
+    switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        tape_->arena.push_back(c);
+        return true;
+      case 'b':
+        tape_->arena.push_back('\b');
+        return true;
+      case 'f':
+        tape_->arena.push_back('\f');
+        return true;
+      case 'n':
+        tape_->arena.push_back('\n');
+        return true;
+      case 'r':
+        tape_->arena.push_back('\r');
+        return true;
+      case 't':
+        tape_->arena.push_back('\t');
+        return true;
+      case 'u': {
+        unsigned int cp = 0;
+        if (!ParseHex4(&cp)) return Fail("invalid \\u escape");
+        if (cp >= 0xDC00 && cp <= 0xDFFF) {
+          return Fail("unpaired UTF-16 low surrogate");
+        }
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+          unsigned int low = 0;
+          if (end_ - p_ < 2 || p_[0] != '\\' || p_[1] != 'u') {
+            return Fail("unpaired UTF-16 high surrogate");
+          }
+          p_ += 2;
+          if (!ParseHex4(&low) || low < 0xDC00 || low > 0xDFFF) {
+            return Fail("unpaired UTF-16 high surrogate");
+          }
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        AppendUtf8(cp);
+        return true;
+      }
+      default:
+        return Fail("invalid escape");
+    }
+  }
+
+  // At the opening quote. Strings without escapes stay in the input.
+  bool ParseString(uint32_t *offset, uint32_t *length, bool *decoded) {
+    ++p_;
+    const char *start = p_;
+    std::vector<char> &arena = tape_->arena;
+    size_t arena_start = 0;
+    bool escaped = false;
+
+    for (;;) {
+      if (p_ == end_) {
+        return Fail("unterminated string");
+      }
+
+      const unsigned char c = static_cast<unsigned char>(*p_);
+      if (c == '"') {
+        break;
+      }
+      if (c == '\\') {
+        if (!escaped) {
+          escaped = true;
+          arena_start = arena.size();
+          arena.insert(arena.end(), start, p_);
+        }
+        ++p_;
+        if (!ParseEscape()) {
+          return false;
+        }
+        continue;
+      }
+      if (c < 0x20) {
+        return Fail("control character in string");
+      }
+
+      const char *run = p_;
+      if (c < 0x80) {
+        ++p_;
+      } else if (!SkipUtf8()) {
+        return Fail("invalid UTF-8 in string");
+      }
+      if (escaped) {
+        arena.insert(arena.end(), run, p_);
+      }
+    }
+
+    if (escaped) {
+      (*offset) = static_cast<uint32_t>(arena_start);
+      (*length) = static_cast<uint32_t>(arena.size() - arena_start);
+    } else {
+      (*offset) = static_cast<uint32_t>(start - begin_);
+      (*length) = static_cast<uint32_t>(p_ - start);
+    }
+    (*decoded) = escaped;
+    ++p_;  // closing quote
+    return true;
+  }
+
+  JsonTape *tape_;
+  const char *begin_;
+  const char *p_;
+  const char *end_;
+
+  // Entries of the open containers; reused at every depth
+  std::vector<Frame> stack_;
+  std::vector<JsonTapeMember> scratch_members_;
+  std::vector<uint32_t> scratch_elements_;
+  std::string number_;
+  std::string error_;
+};
+
+using json_in = JsonTapeValue;
+using json_in_const_iterator = JsonTapeMemberIterator;
+using json_in_array_iterator = JsonTapeArrayIterator;
+using JsonInDocument = JsonTapeDocument;
+
+void JsonParse(JsonInDocument &doc, const char *str, size_t length,
+               bool throwExc = false) {
+  JsonTapeParser parser(doc.tape.get(), str, length);
+  if (!parser.Parse()) {
+    doc.tape->values.clear();
+#if (defined(__cpp_exceptions) || defined(__EXCEPTIONS) || \
+     defined(_CPPUNWIND)) &&                               \
+    !defined(TINYGLTF_NOEXCEPTION)
+    if (throwExc) {
+      throw std::runtime_error(parser.error());
+    }
+#else
+    (void)throwExc;
+#endif
+  }
+}
+#else
+// The loader reads the same JSON type the writer builds
+using json_in = json;
+using json_in_const_iterator = json_const_iterator;
+using json_in_array_iterator = json_const_array_iterator;
+using JsonInDocument = JsonDocument;
+#endif
+
+void JsonParse(JsonDocument &doc, const char *str, size_t length,
+               bool throwExc = false) {
+#ifdef TINYGLTF_USE_RAPIDJSON
+  (void)throwExc;
+  doc.Parse(str, length);
+#else
+  doc = detail::json::parse(str, str + length, nullptr, throwExc);
+#endif
+}
+}  // namespace detail
+}  // namespace tinygltf
+
+#ifdef __APPLE__
+#include "TargetConditionals.h"
+#endif
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wc++98-compat"
+#endif
+
+namespace tinygltf {
+
+///
+/// Internal LoadImageDataOption struct.
+/// This struct is passed through `user_pointer` in LoadImageData.
+/// The struct is not passed when the user supply their own LoadImageData
+/// callbacks.
+///
+struct LoadImageDataOption {
+  // true: preserve image channels(e.g. load as RGB image if the image has RGB
+  // channels) default `false`(channels are expanded to RGBA for backward
+  // compatibility).
+  bool preserve_channels{false};
+  // true: do not decode/decompress image data.
+  // default `false`: decode/decompress image data.
+  bool as_is{false};
+};
+
+#ifdef TINYGLTF_USE_ARENA
+
+namespace {
+// Points at the innermost Scope's arena
+thread_local const std::shared_ptr<Arena> *current_arena = nullptr;
+}  // namespace
+
+Arena::~Arena() {
+  Block *lists[] = {head_.load(), large_};
+  for (Block *b : lists) {
+    while (b) {
+      Block *next = b->next;
+      b->~Block();
+      ::operator delete(b);
+      b = next;
+    }
+  }
+}
+
+void *Arena::Allocate(size_t n, size_t align) {
+  if (n + align > block_size_ / 4) {
+    return AllocateLarge(n, align);
+  }
+
+  Block *b = head_.load(std::memory_order_acquire);
+  for (;;) {
+    if (b) {
+      // Bump the block's cursor; offsets are aligned as addresses
+      const uintptr_t base = reinterpret_cast<uintptr_t>(b->Data());
+      size_t off = b->used.load(std::memory_order_relaxed);
+      for (;;) {
+        size_t start = static_cast<size_t>(
+            ((base + off + align - 1) & ~(uintptr_t(align) - 1)) - base);
+        if (start + n > b->size) break;
+        if (b->used.compare_exchange_weak(off, start + n,
+                                          std::memory_order_relaxed)) {
+          used_.fetch_add(n, std::memory_order_relaxed);
+          return b->Data() + start;
+        }
+      }
+    }
+    b = Grow(b);
+  }
+}
+
+Arena::Block *Arena::NewBlock(size_t size, Block *next) {
+  void *p = ::operator new(sizeof(Block) + size);
+  Block *b = new (p) Block;
+  b->next = next;
+  b->size = size;
+  b->used.store(0, std::memory_order_relaxed);
+  return b;
+}
+
+Arena::Block *Arena::Grow(Block *seen) {
+  std::lock_guard<std::mutex> lock(grow_mutex_);
+
+  // Another thread may have grown the arena already
+  Block *head = head_.load(std::memory_order_acquire);
+  if (head != seen) {
+    return head;
+  }
+
+  Block *b = NewBlock(block_size_, head);
+  head_.store(b, std::memory_order_release);
+  return b;
+}
+
+// Requests past a quarter block get a block of their own, leaving the
+// current one to fill up
+void *Arena::AllocateLarge(size_t n, size_t align) {
+  std::lock_guard<std::mutex> lock(grow_mutex_);
+  large_ = NewBlock(n + align, large_);
+  used_.fetch_add(n, std::memory_order_relaxed);
+
+  const uintptr_t base = reinterpret_cast<uintptr_t>(large_->Data());
+  return large_->Data() +
+         (((base + align - 1) & ~(uintptr_t(align) - 1)) - base);
+}
+
+std::shared_ptr<Arena> Arena::Current() {
+  return current_arena ? *current_arena : std::shared_ptr<Arena>();
+}
+
+Arena::Scope::Scope(std::shared_ptr<Arena> arena)
+    : arena_(std::move(arena)), prev_(current_arena) {
+  current_arena = &arena_;
+}
+
+Arena::Scope::~Scope() { current_arena = prev_; }
+
+#endif  // TINYGLTF_USE_ARENA
+
+// Equals function for Value, for recursivity
+static bool Equals(const tinygltf::Value &one, const tinygltf::Value &other) {
+  if (one.Type() != other.Type()) return false;
+
+  switch (one.Type()) {
+    case NULL_TYPE:
+      return true;
+    case BOOL_TYPE:
+      return one.Get<bool>() == other.Get<bool>();
+    case REAL_TYPE:
+      return TINYGLTF_DOUBLE_EQUAL(one.Get<double>(), other.Get<double>());
+    case INT_TYPE:
+      return one.Get<int>() == other.Get<int>();
+    case OBJECT_TYPE: {
+      auto oneObj = one.Get<tinygltf::Value::Object>();
+      auto otherObj = other.Get<tinygltf::Value::Object>();
+      if (oneObj.size() != otherObj.size()) return false;
+      for (auto &it : oneObj) {
+        auto otherIt = otherObj.find(it.first);
+        if (otherIt == otherObj.end()) return false;
+
+        if (!Equals(it.second, otherIt->second)) return false;
+      }
+      return true;
+    }
+    case ARRAY_TYPE: {
+      if (one.Size() != other.Size()) return false;
+      for (size_t i = 0; i < one.Size(); ++i)
+        if (!Equals(one.Get(i), other.Get(i))) return false;
+      return true;
+    }
+    case STRING_TYPE:
+      return one.Get<std::string>() == other.Get<std::string>();
+    case BINARY_TYPE:
+      return one.Get<std::vector<unsigned char> >() ==
+             other.Get<std::vector<unsigned char> >();
+    default: {
+      // unhandled type
+      return false;
+    }
+  }
+}
+
+// Equals function for std::vector<double> using TINYGLTF_DOUBLE_EPSILON
+static bool Equals(const std::vector<double> &one,
                    const std::vector<double> &other) {
   if (one.size() != other.size()) return false;
   for (int i = 0; i < int(one.size()); ++i) {
@@ -1997,7 +3071,10 @@ bool Asset::operator==(const Asset &other) const {
          this->minVersion == other.minVersion && this->version == other.version;
 }
 bool Buffer::operator==(const Buffer &other) const {
-  return this->data == other.data && this->extensions == other.extensions &&
+  return this->Size() == other.Size() &&
+         (this->Size() == 0 ||
+          memcmp(this->Data(), other.Data(), this->Size()) == 0) &&
+         this->extensions == other.extensions &&
          this->extras == other.extras && this->name == other.name &&
          this->uri == other.uri;
 }
@@ -2268,6 +3345,7 @@ static std::string GetBaseFilename(const std::string &filepath) {
 
 std::string base64_encode(unsigned char const *, unsigned int len);
 std::string base64_decode(std::string const &s);
+void base64_decode(const char *in, size_t len, std::vector<unsigned char> *out);
 
 /*
    base64.cpp and base64.h
@@ -2296,110 +3374,269 @@ std::string base64_decode(std::string const &s);
 
 */
 
+// Altered for TinyGLTF: table-driven, with SSSE3/AVX2 paths (vectorized as
+// in Muła and Lemire, "Faster Base64 Encoding and Decoding using AVX2
+// Instructions"), decoding straight into the destination vector.
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wsign-conversion"
 #pragma clang diagnostic ignored "-Wconversion"
 #endif
 
-static inline bool is_base64(unsigned char c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
-}
-
-std::string base64_encode(unsigned char const *bytes_to_encode,
-                          unsigned int in_len) {
-  std::string ret;
-  int i = 0;
-  int j = 0;
-  unsigned char char_array_3[3];
-  unsigned char char_array_4[4];
-
-  const char *base64_chars =
-      "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-      "abcdefghijklmnopqrstuvwxyz"
-      "0123456789+/";
+namespace detail {
 
-  while (in_len--) {
-    char_array_3[i++] = *(bytes_to_encode++);
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] =
-          ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] =
-          ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
+static const char kBase64Chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+// Sextet of each character, 255 outside the alphabet ('=' included)
+static const unsigned char kBase64Values[256] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 62, 255, 255, 255, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 255, 255, 255, 255, 255, 255,
+    255, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 255, 255, 255, 255, 255,
+    255, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+};
 
-      for (i = 0; (i < 4); i++) ret += base64_chars[char_array_4[i]];
-      i = 0;
-    }
+#if !defined(TINYGLTF_NO_SIMD) && (defined(__SSSE3__) || defined(__AVX2__))
+#define TINYGLTF_BASE64_SSSE3
+
+// 12 bytes from in[0..15] -> 16 characters
+static inline __m128i Base64EncodeSSSE3(__m128i in) {
+  // Each 32-bit lane gets bytes [b1 b0 b2 b1] so every sextet sits in a
+  // 16-bit half that multiplies can shift into place.
+  in = _mm_shuffle_epi8(
+      in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  const __m128i sextets = _mm_or_si128(t1, t3);
+
+  // Offset to add per range: A-Z, a-z, 0-9, '+', '/'
+  __m128i range = _mm_subs_epu8(sextets, _mm_set1_epi8(51));
+  const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), sextets);
+  range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+  const __m128i offsets = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), sextets);
+}
+
+// Sextets of 16 characters, false if any is outside the alphabet
+static inline bool Base64ValuesSSSE3(__m128i in, __m128i *values) {
+  const __m128i hi = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+  const __m128i lo = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+  const __m128i lut_lo =
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lut_hi =
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lut_roll =
+      _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+
+  const __m128i invalid = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo),
+                                        _mm_shuffle_epi8(lut_hi, hi));
+  if (_mm_movemask_epi8(_mm_cmpgt_epi8(invalid, _mm_setzero_si128()))) {
+    return false;
   }
 
-  if (i) {
-    for (j = i; j < 3; j++) char_array_3[j] = '\0';
-
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] =
-        ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] =
-        ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+  const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+  const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(slash, hi));
+  (*values) = _mm_add_epi8(in, roll);
+  return true;
+}
 
-    for (j = 0; (j < i + 1); j++) ret += base64_chars[char_array_4[j]];
+// 16 sextets -> 12 bytes in the low lanes
+static inline __m128i Base64PackSSSE3(__m128i values) {
+  const __m128i ab_bc =
+      _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  const __m128i abc = _mm_madd_epi16(ab_bc, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(abc, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+                                             13, 12, -1, -1, -1, -1));
+}
+#endif
 
-    while ((i++ < 3)) ret += '=';
+#if !defined(TINYGLTF_NO_SIMD) && defined(__AVX2__)
+#define TINYGLTF_BASE64_AVX2
+
+// 32 characters -> 24 bytes in the low lanes, false on a bad character
+static inline bool Base64DecodeAVX2(__m256i in, __m256i *out) {
+  const __m256i hi =
+      _mm256_and_si256(_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0f));
+  const __m256i lo = _mm256_and_si256(in, _mm256_set1_epi8(0x0f));
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+      0x1B, 0x1B, 0x1B, 0x1A, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 19, 4,
+      -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+
+  const __m256i invalid = _mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo),
+                                           _mm256_shuffle_epi8(lut_hi, hi));
+  if (_mm256_movemask_epi8(
+          _mm256_cmpgt_epi8(invalid, _mm256_setzero_si256()))) {
+    return false;
   }
 
-  return ret;
+  const __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+  const __m256i roll =
+      _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(slash, hi));
+  const __m256i values = _mm256_add_epi8(in, roll);
+
+  const __m256i ab_bc =
+      _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+  const __m256i abc = _mm256_madd_epi16(ab_bc, _mm256_set1_epi32(0x00011000));
+  const __m256i packed = _mm256_shuffle_epi8(
+      abc, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1,
+                            -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                            -1, -1));
+  // Close the gap between the two 12-byte halves
+  (*out) = _mm256_permutevar8x32_epi32(
+      packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+  return true;
 }
+#endif
 
-std::string base64_decode(std::string const &encoded_string) {
-  int in_len = static_cast<int>(encoded_string.size());
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  unsigned char char_array_4[4], char_array_3[3];
-  std::string ret;
+}  // namespace detail
 
-  const std::string base64_chars =
-      "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-      "abcdefghijklmnopqrstuvwxyz"
-      "0123456789+/";
+std::string base64_encode(unsigned char const *bytes_to_encode,
+                          unsigned int in_len) {
+  std::string ret(((size_t(in_len) + 2) / 3) * 4, '\0');
+  char *out = &ret[0];
+  const unsigned char *in = bytes_to_encode;
+  size_t remaining = in_len;
+
+#ifdef TINYGLTF_BASE64_SSSE3
+  // Loads 16 bytes per 12 encoded
+  while (remaining >= 16) {
+    const __m128i chars = detail::Base64EncodeSSSE3(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), chars);
+    in += 12;
+    out += 16;
+    remaining -= 12;
+  }
+#endif
 
-  while (in_len-- && (encoded_string[in_] != '=') &&
-         is_base64(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_];
-    in_++;
-    if (i == 4) {
-      for (i = 0; i < 4; i++)
-        char_array_4[i] =
-            static_cast<unsigned char>(base64_chars.find(char_array_4[i]));
+  for (; remaining >= 3; remaining -= 3, in += 3, out += 4) {
+    const unsigned int v = (unsigned(in[0]) << 16) | (unsigned(in[1]) << 8) |
+                           unsigned(in[2]);
+    out[0] = detail::kBase64Chars[(v >> 18) & 0x3f];
+    out[1] = detail::kBase64Chars[(v >> 12) & 0x3f];
+    out[2] = detail::kBase64Chars[(v >> 6) & 0x3f];
+    out[3] = detail::kBase64Chars[v & 0x3f];
+  }
 
-      char_array_3[0] =
-          (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] =
-          ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+  if (remaining) {
+    const unsigned int v =
+        (unsigned(in[0]) << 16) | (remaining > 1 ? unsigned(in[1]) << 8 : 0u);
+    out[0] = detail::kBase64Chars[(v >> 18) & 0x3f];
+    out[1] = detail::kBase64Chars[(v >> 12) & 0x3f];
+    out[2] = remaining > 1 ? detail::kBase64Chars[(v >> 6) & 0x3f] : '=';
+    out[3] = '=';
+  }
 
-      for (i = 0; (i < 3); i++) ret += char_array_3[i];
-      i = 0;
+  return ret;
+}
+
+// Decodes up to the first '=' or character outside the alphabet into
+// `*out` (replacing its contents). A trailing partial group yields the
+// whole bytes it holds.
+void base64_decode(const char *in, size_t len,
+                   std::vector<unsigned char> *out) {
+  // Vector stores write up to 8 bytes past the last decoded one
+  out->resize((len / 4) * 3 + 8);
+  unsigned char *dst = out->data();
+  size_t pos = 0;
+
+#ifdef TINYGLTF_BASE64_AVX2
+  while (len - pos >= 32) {
+    __m256i bytes;
+    if (!detail::Base64DecodeAVX2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + pos)),
+            &bytes)) {
+      break;
     }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), bytes);
+    pos += 32;
+    dst += 24;
   }
+#endif
 
-  if (i) {
-    for (j = i; j < 4; j++) char_array_4[j] = 0;
-
-    for (j = 0; j < 4; j++)
-      char_array_4[j] =
-          static_cast<unsigned char>(base64_chars.find(char_array_4[j]));
+#ifdef TINYGLTF_BASE64_SSSE3
+  while (len - pos >= 16) {
+    __m128i values;
+    if (!detail::Base64ValuesSSSE3(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + pos)),
+            &values)) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+                     detail::Base64PackSSSE3(values));
+    pos += 16;
+    dst += 12;
+  }
+#endif
 
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] =
-        ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+  // Whole groups, then the tail up to the first bad character
+  for (; len - pos >= 4; pos += 4, dst += 3) {
+    const unsigned int a = detail::kBase64Values[(unsigned char)in[pos + 0]];
+    const unsigned int b = detail::kBase64Values[(unsigned char)in[pos + 1]];
+    const unsigned int c = detail::kBase64Values[(unsigned char)in[pos + 2]];
+    const unsigned int d = detail::kBase64Values[(unsigned char)in[pos + 3]];
+    if ((a | b | c | d) > 63) {
+      break;
+    }
+    const unsigned int v = (a << 18) | (b << 12) | (c << 6) | d;
+    dst[0] = static_cast<unsigned char>(v >> 16);
+    dst[1] = static_cast<unsigned char>(v >> 8);
+    dst[2] = static_cast<unsigned char>(v);
+  }
 
-    for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
+  // At most 3 valid characters remain before the end or a bad one
+  unsigned int v = 0;
+  int n = 0;
+  for (; pos < len && n < 3; pos++, n++) {
+    const unsigned int c = detail::kBase64Values[(unsigned char)in[pos]];
+    if (c > 63) {
+      break;
+    }
+    v = (v << 6) | c;
+  }
+  if (n >= 2) {
+    v <<= 6 * (4 - n);
+    dst[0] = static_cast<unsigned char>(v >> 16);
+    if (n == 3) dst[1] = static_cast<unsigned char>(v >> 8);
+    dst += n - 1;
   }
 
-  return ret;
+  out->resize(size_t(dst - out->data()));
+}
+
+std::string base64_decode(std::string const &encoded_string) {
+  std::vector<unsigned char> bytes;
+  base64_decode(encoded_string.data(), encoded_string.size(), &bytes);
+  return std::string(bytes.begin(), bytes.end());
 }
 #ifdef __clang__
 #pragma clang diagnostic pop
@@ -3223,6 +4460,101 @@ bool ReadWholeFile(std::vector<unsigned char> *out, std::string *err,
 #endif
 }
 
+bool MapWholeFile(const unsigned char **out, size_t *size,
+                  std::shared_ptr<const void> *keep_alive, std::string *err,
+                  const std::string &filepath) {
+#if defined(TINYGLTF_ANDROID_LOAD_FROM_ASSETS)
+  (void)out;
+  (void)size;
+  (void)keep_alive;
+  if (err) {
+    (*err) += "File mapping is not supported for Android assets : " +
+              filepath + "\n";
+  }
+  return false;
+#elif defined(_WIN32)
+  HANDLE file = CreateFileW(UTF8ToWchar(filepath).c_str(), GENERIC_READ,
+                            FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    if (err) {
+      (*err) += "File open error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  LARGE_INTEGER sz;
+  if (!GetFileSizeEx(file, &sz) || sz.QuadPart <= 0) {
+    CloseHandle(file);
+    if (err) {
+      (*err) += "File is empty or invalid : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping) {
+    if (err) {
+      (*err) += "File mapping error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  // The view keeps the mapping object alive.
+  void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!view) {
+    if (err) {
+      (*err) += "File mapping error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  (*out) = static_cast<const unsigned char *>(view);
+  (*size) = static_cast<size_t>(sz.QuadPart);
+  keep_alive->reset(view, [](const void *p) {
+    UnmapViewOfFile(const_cast<void *>(p));
+  });
+  return true;
+#else
+  int fd = open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (err) {
+      (*err) += "File open error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    close(fd);
+    if (err) {
+      (*err) += "File is empty or invalid : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  size_t sz = static_cast<size_t>(st.st_size);
+  void *addr = mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  // The mapping stays valid after closing.
+  if (addr == MAP_FAILED) {
+    if (err) {
+      (*err) += "File mapping error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  (*out) = static_cast<const unsigned char *>(addr);
+  (*size) = sz;
+  keep_alive->reset(addr, [sz](const void *p) {
+    munmap(const_cast<void *>(p), sz);
+  });
+  return true;
+#endif
+}
+
 bool WriteWholeFile(std::string *err, const std::string &filepath,
                     const std::vector<unsigned char> &contents, void *) {
 #ifdef _WIN32
@@ -3367,74 +4699,42 @@ bool IsDataURI(const std::string &in) {
 
 bool DecodeDataURI(std::vector<unsigned char> *out, std::string &mime_type,
                    const std::string &in, size_t reqBytes, bool checkSize) {
-  std::string header = "data:application/octet-stream;base64,";
-  std::string data;
-  if (in.find(header) == 0) {
-    data = base64_decode(in.substr(header.size()));  // cut mime string.
-  }
-
-  if (data.empty()) {
-    header = "data:image/jpeg;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/jpeg";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
-    }
-  }
+  // Header and the mime type it implies ("" to leave mime_type as is)
+  static const char *const kHeaders[][2] = {
+      {"data:application/octet-stream;base64,", ""},
+      {"data:image/jpeg;base64,", "image/jpeg"},
+      {"data:image/png;base64,", "image/png"},
+      {"data:image/bmp;base64,", "image/bmp"},
+      {"data:image/gif;base64,", "image/gif"},
+      {"data:text/plain;base64,", "text/plain"},
+      {"data:application/gltf-buffer;base64,", ""},
+  };
 
-  if (data.empty()) {
-    header = "data:image/png;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/png";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
+  for (const auto &header : kHeaders) {
+    const size_t header_len = strlen(header[0]);
+    if (in.compare(0, header_len, header[0]) != 0) {
+      continue;
     }
-  }
 
-  if (data.empty()) {
-    header = "data:image/bmp;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/bmp";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
-    }
-  }
+    // Decoded in place, without an intermediate string
+    base64_decode(in.data() + header_len, in.size() - header_len, out);
 
-  if (data.empty()) {
-    header = "data:image/gif;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/gif";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
+    // TODO(syoyo): Allow empty buffer? #229
+    if (out->empty()) {
+      return false;
     }
-  }
 
-  if (data.empty()) {
-    header = "data:text/plain;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "text/plain";
-      data = base64_decode(in.substr(header.size()));
+    if (checkSize && out->size() != reqBytes) {
+      return false;
     }
-  }
 
-  if (data.empty()) {
-    header = "data:application/gltf-buffer;base64,";
-    if (in.find(header) == 0) {
-      data = base64_decode(in.substr(header.size()));
+    if (header[1][0] != '\0') {
+      mime_type = header[1];
     }
+    return true;
   }
 
-  // TODO(syoyo): Allow empty buffer? #229
-  if (data.empty()) {
-    return false;
-  }
-
-  if (checkSize) {
-    if (data.size() != reqBytes) {
-      return false;
-    }
-    out->resize(reqBytes);
-  } else {
-    out->resize(data.size());
-  }
-  std::copy(data.begin(), data.end(), out->begin());
-  return true;
+  return false;
 }
 
 namespace detail {
@@ -3541,6 +4841,14 @@ detail::json_const_array_iterator ArrayEnd(const detail::json &o) {
 #endif
 }
 
+size_t ArraySize(const detail::json &o) {
+#ifdef TINYGLTF_USE_RAPIDJSON
+  return o.Size();
+#else
+  return o.size();
+#endif
+}
+
 bool IsObject(const detail::json &o) {
 #ifdef TINYGLTF_USE_RAPIDJSON
   return o.IsObject();
@@ -3659,9 +4967,223 @@ std::string JsonToString(const detail::json &o, int spacing = -1) {
 #endif
 }
 
+#ifdef TINYGLTF_USE_RAPIDJSON
+// RapidJSON output stream writing through to a std::ostream
+struct JsonOStream {
+  typedef char Ch;
+  explicit JsonOStream(std::ostream &s) : stream(s) {}
+  void Put(Ch c) { stream.put(c); }
+  void Flush() {}
+  std::ostream &stream;
+};
+#endif
+
+// Writes `o` as JsonToString formats it, straight to `stream` without
+// building the string. `spacing` > 0 pretty prints.
+bool JsonWrite(std::ostream &stream, const detail::json &o, int spacing = -1) {
+#ifdef TINYGLTF_USE_RAPIDJSON
+  using namespace rapidjson;
+  JsonOStream out(stream);
+  if (spacing > 0) {
+    PrettyWriter<JsonOStream> writer(out);
+    writer.SetIndent(' ', uint32_t(spacing));
+    if (!o.Accept(writer)) return false;
+  } else {
+    Writer<JsonOStream> writer(out);
+    if (!o.Accept(writer)) return false;
+  }
+#else
+  const char fill = stream.fill(' ');
+  stream.width(spacing > 0 ? spacing : 0);
+  stream << o;
+  stream.fill(fill);
+#endif
+  return stream.good();
+}
+
+// Stream buffer that only counts the bytes written to it
+class CountingStreamBuf : public std::streambuf {
+ public:
+  size_t count = 0;
+
+ protected:
+  std::streamsize xsputn(const char *, std::streamsize n) override {
+    count += size_t(n);
+    return n;
+  }
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) count++;
+    return traits_type::not_eof(c);
+  }
+};
+
+#ifdef TINYGLTF_USE_TAPE_JSON
+// ---- Readers for the tape the loader parses into ----
+
+bool GetInt(const detail::json_in &o, int &val) {
+  if (o.type == json_in::kInteger) {
+    val = static_cast<int>(o.integer);
+    return true;
+  }
+  if (o.type == json_in::kUnsigned) {
+    val = static_cast<int>(static_cast<int64_t>(o.unsigned_integer));
+    return true;
+  }
+  return false;
+}
+
+bool GetNumber(const detail::json_in &o, double &val) {
+  switch (o.type) {
+    case json_in::kInteger:
+      val = static_cast<double>(o.integer);
+      return true;
+    case json_in::kUnsigned:
+      val = static_cast<double>(o.unsigned_integer);
+      return true;
+    case json_in::kFloat:
+      val = o.number;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool GetString(const detail::json_in &o, std::string &val) {
+  if (o.type == json_in::kString) {
+    val.assign(o.tape->String(o.first, o.decoded), o.count);
+    return true;
+  }
+  return false;
+}
+
+bool IsArray(const detail::json_in &o) { return o.type == json_in::kArray; }
+
+detail::json_in_array_iterator ArrayBegin(const detail::json_in &o) {
+  detail::json_in_array_iterator it;
+  it.tape = o.tape;
+  if (o.type == json_in::kArray) {
+    it.element = o.tape->elements.data() + o.first;
+  }
+  return it;
+}
+
+detail::json_in_array_iterator ArrayEnd(const detail::json_in &o) {
+  detail::json_in_array_iterator it = ArrayBegin(o);
+  if (o.type == json_in::kArray) {
+    it.element += o.count;
+  }
+  return it;
+}
+
+size_t ArraySize(const detail::json_in &o) {
+  return o.type == json_in::kArray ? o.count : 0;
+}
+
+bool IsObject(const detail::json_in &o) { return o.type == json_in::kObject; }
+
+detail::json_in_const_iterator ObjectBegin(const detail::json_in &o) {
+  detail::json_in_const_iterator it;
+  it.tape = o.tape;
+  if (o.type == json_in::kObject) {
+    it.member = o.tape->members.data() + o.first;
+  }
+  return it;
+}
+
+detail::json_in_const_iterator ObjectEnd(const detail::json_in &o) {
+  detail::json_in_const_iterator it = ObjectBegin(o);
+  if (o.type == json_in::kObject) {
+    it.member += o.count;
+  }
+  return it;
+}
+
+std::string GetKey(const detail::json_in_const_iterator &it) {
+  return std::string(it.tape->String(it.member->key, it.member->key_decoded),
+                     it.member->key_length);
+}
+
+// Members are sorted by key
+bool FindMember(const detail::json_in &o, const char *member,
+                detail::json_in_const_iterator &it) {
+  if (o.type != json_in::kObject) {
+    return false;
+  }
+
+  const size_t length = strlen(member);
+  const JsonTapeMember *first = o.tape->members.data() + o.first;
+  size_t count = o.count;
+  while (count > 0) {
+    const size_t half = count / 2;
+    const JsonTapeMember &m = first[half];
+    const size_t n = std::min(size_t(m.key_length), length);
+    int c = n ? memcmp(o.tape->String(m.key, m.key_decoded), member, n) : 0;
+    if (c == 0) {
+      c = m.key_length < length ? -1 : (m.key_length > length ? 1 : 0);
+    }
+    if (c == 0) {
+      it.tape = o.tape;
+      it.member = &m;
+      return true;
+    }
+    if (c < 0) {
+      first += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  return false;
+}
+
+const detail::json_in &GetValue(const detail::json_in_const_iterator &it) {
+  return it.tape->values[it.member->value];
+}
+
+static detail::json JsonTapeToJson(const detail::json_in &o) {
+  switch (o.type) {
+    case json_in::kBoolean:
+      return detail::json(o.boolean);
+    case json_in::kInteger:
+      return detail::json(static_cast<json::number_integer_t>(o.integer));
+    case json_in::kUnsigned:
+      return detail::json(
+          static_cast<json::number_unsigned_t>(o.unsigned_integer));
+    case json_in::kFloat:
+      return detail::json(o.number);
+    case json_in::kString: {
+      std::string s;
+      GetString(o, s);
+      return detail::json(std::move(s));
+    }
+    case json_in::kArray: {
+      detail::json j = detail::json::array();
+      for (auto it = ArrayBegin(o); it != ArrayEnd(o); ++it) {
+        j.push_back(JsonTapeToJson(*it));
+      }
+      return j;
+    }
+    case json_in::kObject: {
+      detail::json j = detail::json::object();
+      for (auto it = ObjectBegin(o); it != ObjectEnd(o); ++it) {
+        j[GetKey(it)] = JsonTapeToJson(GetValue(it));
+      }
+      return j;
+    }
+    case json_in::kNull:
+      break;
+  }
+  return detail::json();
+}
+
+std::string JsonToString(const detail::json_in &o, int spacing = -1) {
+  return JsonTapeToJson(o).dump(spacing);
+}
+#endif  // TINYGLTF_USE_TAPE_JSON
+
 }  // namespace detail
 
-static bool ParseJsonAsValue(Value *ret, const detail::json &o) {
+static bool ParseJsonAsValue(Value *ret, const detail::json_in &o) {
   Value val{};
 #ifdef TINYGLTF_USE_RAPIDJSON
   using rapidjson::Type;
@@ -3709,6 +5231,50 @@ static bool ParseJsonAsValue(Value *ret, const detail::json &o) {
       break;
       // all types are covered, so no `case default`
   }
+#elif defined(TINYGLTF_USE_TAPE_JSON)
+  switch (o.type) {
+    case detail::json_in::kObject: {
+      Value::Object value_object;
+      for (auto it = detail::ObjectBegin(o); it != detail::ObjectEnd(o);
+           ++it) {
+        Value entry;
+        ParseJsonAsValue(&entry, detail::GetValue(it));
+        if (entry.Type() != NULL_TYPE)
+          value_object.emplace(detail::GetKey(it), std::move(entry));
+      }
+      if (value_object.size() > 0) val = Value(std::move(value_object));
+    } break;
+    case detail::json_in::kArray: {
+      Value::Array value_array;
+      value_array.reserve(o.count);
+      for (auto it = detail::ArrayBegin(o); it != detail::ArrayEnd(o); ++it) {
+        Value entry;
+        ParseJsonAsValue(&entry, *it);
+        if (entry.Type() != NULL_TYPE)
+          value_array.emplace_back(std::move(entry));
+      }
+      if (value_array.size() > 0) val = Value(std::move(value_array));
+    } break;
+    case detail::json_in::kString: {
+      std::string s;
+      detail::GetString(o, s);
+      val = Value(std::move(s));
+    } break;
+    case detail::json_in::kBoolean:
+      val = Value(o.boolean);
+      break;
+    case detail::json_in::kInteger:
+    case detail::json_in::kUnsigned: {
+      int i = 0;
+      detail::GetInt(o, i);
+      val = Value(i);
+    } break;
+    case detail::json_in::kFloat:
+      val = Value(o.number);
+      break;
+    case detail::json_in::kNull:
+      break;
+  }
 #else
   switch (o.type()) {
     case detail::json::value_t::object: {
@@ -3759,8 +5325,8 @@ static bool ParseJsonAsValue(Value *ret, const detail::json &o) {
   return isNotNull;
 }
 
-static bool ParseExtrasProperty(Value *ret, const detail::json &o) {
-  detail::json_const_iterator it;
+static bool ParseExtrasProperty(Value *ret, const detail::json_in &o) {
+  detail::json_in_const_iterator it;
   if (!detail::FindMember(o, "extras", it)) {
     return false;
   }
@@ -3769,11 +5335,11 @@ static bool ParseExtrasProperty(Value *ret, const detail::json &o) {
 }
 
 static bool ParseBooleanProperty(bool *ret, std::string *err,
-                                 const detail::json &o,
+                                 const detail::json_in &o,
                                  const std::string &property,
                                  const bool required,
                                  const std::string &parent_node = "") {
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
   if (!detail::FindMember(o, property.c_str(), it)) {
     if (required) {
       if (err) {
@@ -3796,6 +5362,11 @@ static bool ParseBooleanProperty(bool *ret, std::string *err,
   if (isBoolean) {
     boolValue = value.GetBool();
   }
+#elif defined(TINYGLTF_USE_TAPE_JSON)
+  isBoolean = value.type == detail::json_in::kBoolean;
+  if (isBoolean) {
+    boolValue = value.boolean;
+  }
 #else
   isBoolean = value.is_boolean();
   if (isBoolean) {
@@ -3819,11 +5390,11 @@ static bool ParseBooleanProperty(bool *ret, std::string *err,
 }
 
 static bool ParseIntegerProperty(int *ret, std::string *err,
-                                 const detail::json &o,
+                                 const detail::json_in &o,
                                  const std::string &property,
                                  const bool required,
                                  const std::string &parent_node = "") {
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
   if (!detail::FindMember(o, property.c_str(), it)) {
     if (required) {
       if (err) {
@@ -3856,11 +5427,11 @@ static bool ParseIntegerProperty(int *ret, std::string *err,
 }
 
 static bool ParseUnsignedProperty(size_t *ret, std::string *err,
-                                  const detail::json &o,
+                                  const detail::json_in &o,
                                   const std::string &property,
                                   const bool required,
                                   const std::string &parent_node = "") {
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
   if (!detail::FindMember(o, property.c_str(), it)) {
     if (required) {
       if (err) {
@@ -3887,6 +5458,11 @@ static bool ParseUnsignedProperty(size_t *ret, std::string *err,
     uValue = value.GetUint64();
     isUValue = true;
   }
+#elif defined(TINYGLTF_USE_TAPE_JSON)
+  isUValue = value.type == detail::json_in::kUnsigned;
+  if (isUValue) {
+    uValue = static_cast<size_t>(value.unsigned_integer);
+  }
 #else
   isUValue = value.is_number_unsigned();
   if (isUValue) {
@@ -3910,11 +5486,11 @@ static bool ParseUnsignedProperty(size_t *ret, std::string *err,
 }
 
 static bool ParseNumberProperty(double *ret, std::string *err,
-                                const detail::json &o,
+                                const detail::json_in &o,
                                 const std::string &property,
                                 const bool required,
                                 const std::string &parent_node = "") {
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
 
   if (!detail::FindMember(o, property.c_str(), it)) {
     if (required) {
@@ -3949,10 +5525,10 @@ static bool ParseNumberProperty(double *ret, std::string *err,
 }
 
 static bool ParseNumberArrayProperty(std::vector<double> *ret, std::string *err,
-                                     const detail::json &o,
+                                     const detail::json_in &o,
                                      const std::string &property, bool required,
                                      const std::string &parent_node = "") {
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
   if (!detail::FindMember(o, property.c_str(), it)) {
     if (required) {
       if (err) {
@@ -3980,6 +5556,7 @@ static bool ParseNumberArrayProperty(std::vector<double> *ret, std::string *err,
   }
 
   ret->clear();
+  ret->reserve(detail::ArraySize(detail::GetValue(it)));
   auto end = detail::ArrayEnd(detail::GetValue(it));
   for (auto i = detail::ArrayBegin(detail::GetValue(it)); i != end; ++i) {
     double numberValue;
@@ -4003,11 +5580,11 @@ static bool ParseNumberArrayProperty(std::vector<double> *ret, std::string *err,
 }
 
 static bool ParseIntegerArrayProperty(std::vector<int> *ret, std::string *err,
-                                      const detail::json &o,
+                                      const detail::json_in &o,
                                       const std::string &property,
                                       bool required,
                                       const std::string &parent_node = "") {
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
   if (!detail::FindMember(o, property.c_str(), it)) {
     if (required) {
       if (err) {
@@ -4035,6 +5612,7 @@ static bool ParseIntegerArrayProperty(std::vector<int> *ret, std::string *err,
   }
 
   ret->clear();
+  ret->reserve(detail::ArraySize(detail::GetValue(it)));
   auto end = detail::ArrayEnd(detail::GetValue(it));
   for (auto i = detail::ArrayBegin(detail::GetValue(it)); i != end; ++i) {
     int numberValue;
@@ -4058,10 +5636,10 @@ static bool ParseIntegerArrayProperty(std::vector<int> *ret, std::string *err,
 }
 
 static bool ParseStringProperty(
-    std::string *ret, std::string *err, const detail::json &o,
+    std::string *ret, std::string *err, const detail::json_in &o,
     const std::string &property, bool required,
     const std::string &parent_node = std::string()) {
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
   if (!detail::FindMember(o, property.c_str(), it)) {
     if (required) {
       if (err) {
@@ -4094,11 +5672,11 @@ static bool ParseStringProperty(
 }
 
 static bool ParseStringIntegerProperty(std::map<std::string, int> *ret,
-                                       std::string *err, const detail::json &o,
+                                       std::string *err, const detail::json_in &o,
                                        const std::string &property,
                                        bool required,
                                        const std::string &parent = "") {
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
   if (!detail::FindMember(o, property.c_str(), it)) {
     if (required) {
       if (err) {
@@ -4113,7 +5691,7 @@ static bool ParseStringIntegerProperty(std::map<std::string, int> *ret,
     return false;
   }
 
-  const detail::json &dict = detail::GetValue(it);
+  const detail::json_in &dict = detail::GetValue(it);
 
   // Make sure we are dealing with an object / dictionary.
   if (!detail::IsObject(dict)) {
@@ -4127,8 +5705,8 @@ static bool ParseStringIntegerProperty(std::map<std::string, int> *ret,
 
   ret->clear();
 
-  detail::json_const_iterator dictIt(detail::ObjectBegin(dict));
-  detail::json_const_iterator dictItEnd(detail::ObjectEnd(dict));
+  detail::json_in_const_iterator dictIt(detail::ObjectBegin(dict));
+  detail::json_in_const_iterator dictItEnd(detail::ObjectEnd(dict));
 
   for (; dictIt != dictItEnd; ++dictIt) {
     int intVal;
@@ -4148,9 +5726,9 @@ static bool ParseStringIntegerProperty(std::map<std::string, int> *ret,
 }
 
 static bool ParseJSONProperty(std::map<std::string, double> *ret,
-                              std::string *err, const detail::json &o,
+                              std::string *err, const detail::json_in &o,
                               const std::string &property, bool required) {
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
   if (!detail::FindMember(o, property.c_str(), it)) {
     if (required) {
       if (err) {
@@ -4160,7 +5738,7 @@ static bool ParseJSONProperty(std::map<std::string, double> *ret,
     return false;
   }
 
-  const detail::json &obj = detail::GetValue(it);
+  const detail::json_in &obj = detail::GetValue(it);
 
   if (!detail::IsObject(obj)) {
     if (required) {
@@ -4173,8 +5751,8 @@ static bool ParseJSONProperty(std::map<std::string, double> *ret,
 
   ret->clear();
 
-  detail::json_const_iterator it2(detail::ObjectBegin(obj));
-  detail::json_const_iterator itEnd(detail::ObjectEnd(obj));
+  detail::json_in_const_iterator it2(detail::ObjectBegin(obj));
+  detail::json_in_const_iterator itEnd(detail::ObjectEnd(obj));
   for (; it2 != itEnd; ++it2) {
     double numVal;
     if (detail::GetNumber(detail::GetValue(it2), numVal))
@@ -4185,7 +5763,7 @@ static bool ParseJSONProperty(std::map<std::string, double> *ret,
 }
 
 static bool ParseParameterProperty(Parameter *param, std::string *err,
-                                   const detail::json &o,
+                                   const detail::json_in &o,
                                    const std::string &prop, bool required) {
   // A parameter value can either be a string or an array of either a boolean or
   // a number. Booleans of any kind aren't supported here. Granted, it
@@ -4218,10 +5796,10 @@ static bool ParseParameterProperty(Parameter *param, std::string *err,
 }
 
 static bool ParseExtensionsProperty(ExtensionMap *ret, std::string *err,
-                                    const detail::json &o) {
+                                    const detail::json_in &o) {
   (void)err;
 
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
   if (!detail::FindMember(o, "extensions", it)) {
     return false;
   }
@@ -4231,9 +5809,9 @@ static bool ParseExtensionsProperty(ExtensionMap *ret, std::string *err,
     return false;
   }
   ExtensionMap extensions;
-  detail::json_const_iterator extIt =
+  detail::json_in_const_iterator extIt =
       detail::ObjectBegin(obj);  // it.value().begin();
-  detail::json_const_iterator extEnd = detail::ObjectEnd(obj);
+  detail::json_in_const_iterator extEnd = detail::ObjectEnd(obj);
   for (; extIt != extEnd; ++extIt) {
     auto &itObj = detail::GetValue(extIt);
     if (!detail::IsObject(itObj)) continue;
@@ -4254,21 +5832,21 @@ static bool ParseExtensionsProperty(ExtensionMap *ret, std::string *err,
 
 template <typename GltfType>
 static bool ParseExtrasAndExtensions(GltfType *target, std::string *err,
-                                     const detail::json &o,
+                                     const detail::json_in &o,
                                      bool store_json_strings) {
   ParseExtensionsProperty(&target->extensions, err, o);
   ParseExtrasProperty(&target->extras, o);
 
   if (store_json_strings) {
     {
-      detail::json_const_iterator it;
+      detail::json_in_const_iterator it;
       if (detail::FindMember(o, "extensions", it)) {
         target->extensions_json_string =
             detail::JsonToString(detail::GetValue(it));
       }
     }
     {
-      detail::json_const_iterator it;
+      detail::json_in_const_iterator it;
       if (detail::FindMember(o, "extras", it)) {
         target->extras_json_string = detail::JsonToString(detail::GetValue(it));
       }
@@ -4277,7 +5855,7 @@ static bool ParseExtrasAndExtensions(GltfType *target, std::string *err,
   return true;
 }
 
-static bool ParseAsset(Asset *asset, std::string *err, const detail::json &o,
+static bool ParseAsset(Asset *asset, std::string *err, const detail::json_in &o,
                        bool store_original_json_for_extras_and_extensions) {
   ParseStringProperty(&asset->version, err, o, "version", true, "Asset");
   ParseStringProperty(&asset->generator, err, o, "generator", false, "Asset");
@@ -4290,17 +5868,22 @@ static bool ParseAsset(Asset *asset, std::string *err, const detail::json &o,
 }
 
 static bool ParseImage(Image *image, const int image_idx, std::string *err,
-                       std::string *warn, const detail::json &o,
+                       std::string *warn, const detail::json_in &o,
                        bool store_original_json_for_extras_and_extensions,
                        const std::string &basedir, const size_t max_file_size,
                        FsCallbacks *fs, const URICallbacks *uri_cb,
                        const LoadImageDataFunction& LoadImageData = nullptr,
-                       void *load_image_user_data = nullptr) {
+                       void *load_image_user_data = nullptr,
+                       std::vector<unsigned char> *encoded = nullptr,
+                       std::string *deferred_path = nullptr) {
   // A glTF image must either reference a bufferView or an image uri
+  // When `encoded` is given, URI images are not decoded here: their bytes
+  // are moved to `*encoded` for the caller to decode. When `deferred_path`
+  // is given, external files are only located, not read.
 
   // schema says oneOf [`bufferView`, `uri`]
   // TODO(syoyo): Check the type of each parameters.
-  detail::json_const_iterator it;
+  detail::json_in_const_iterator it;
   bool hasBufferView = detail::FindMember(o, "bufferView", it);
   bool hasURI = detail::FindMember(o, "uri", it);
 
@@ -4401,6 +5984,18 @@ static bool ParseImage(Image *image, const int image_idx, std::string *err,
       return true;
     }
 
+    if (deferred_path && fs && fs->FileExists && fs->ExpandFilePath) {
+      std::vector<std::string> paths;
+      paths.push_back(basedir);
+      paths.push_back(".");
+
+      (*deferred_path) = FindFile(paths, decoded_uri, fs);
+      if (deferred_path->empty() && warn) {
+        (*warn) += "File not found : " + decoded_uri + "\n";
+      }
+      return true;
+    }
+
     if (!LoadExternalFile(&img, err, warn, decoded_uri, basedir,
                           /* required */ false, /* required bytes */ 0,
                           /* checksize */ false,
@@ -4432,12 +6027,97 @@ static bool ParseImage(Image *image, const int image_idx, std::string *err,
     return false;
   }
 
+  if (encoded) {
+    encoded->swap(img);
+    return true;
+  }
+
   return LoadImageData(image, image_idx, err, warn, 0, 0, &img.at(0),
                        static_cast<int>(img.size()), load_image_user_data);
 }
 
+namespace detail {
+
+// Encoded bytes of one image, gathered before decoding.
+struct PendingImage {
+  std::vector<unsigned char> owned;      // data URI or external file
+  const unsigned char *bytes = nullptr;  // owned.data() or into a buffer
+  size_t size = 0;
+  int req_width = 0;
+  int req_height = 0;
+};
+
+// Decodes every pending image into `images` (same index) using up to
+// `threads` threads. Messages are collected per image and appended in
+// image order, so the result does not depend on scheduling.
+static bool DecodePendingImages(std::vector<Image> &images,
+                                std::vector<PendingImage> &pending,
+                                const LoadImageDataFunction &LoadImageData,
+                                void *load_image_user_data,
+                                unsigned int threads, std::string *err,
+                                std::string *warn) {
+  std::vector<size_t> todo;
+  for (size_t i = 0; i < pending.size(); i++) {
+    if (pending[i].bytes) todo.push_back(i);
+  }
+
+  std::vector<std::string> errs(pending.size());
+  std::vector<std::string> warns(pending.size());
+  std::vector<char> ok(pending.size(), 1);
+
+  auto decode = [&](size_t i) {
+    PendingImage &p = pending[i];
+    ok[i] = LoadImageData(&images[i], static_cast<int>(i), &errs[i], &warns[i],
+                          p.req_width, p.req_height, p.bytes,
+                          static_cast<int>(p.size), load_image_user_data)
+                ? 1
+                : 0;
+    // Encoded bytes are no longer needed
+    std::vector<unsigned char>().swap(p.owned);
+  };
+
+#ifndef TINYGLTF_NO_THREADS
+  if (threads > todo.size()) threads = static_cast<unsigned int>(todo.size());
+
+  if (threads > 1) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+      for (size_t k = next++; k < todo.size(); k = next++) {
+        decode(todo[k]);
+      }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; t++) {
+      pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : pool) {
+      t.join();
+    }
+  } else
+#else
+  (void)threads;
+#endif
+  {
+    for (size_t i : todo) {
+      decode(i);
+    }
+  }
+
+  bool success = true;
+  for (size_t i = 0; i < pending.size(); i++) {
+    if (err) (*err) += errs[i];
+    if (warn) (*warn) += warns[i];
+    if (!ok[i]) success = false;
+  }
+  return success;
+}
+
+}  // namespace detail
+
 static bool ParseTexture(Texture *texture, std::string *err,
-                         const detail::json &o,
+                         const detail::json_in &o,
                          bool store_original_json_for_extras_and_extensions,
                          const std::string &basedir) {
   (void)basedir;
@@ -4459,7 +6139,7 @@ static bool ParseTexture(Texture *texture, std::string *err,
 }
 
 static bool ParseTextureInfo(
-    TextureInfo *texinfo, std::string *err, const detail::json &o,
+    TextureInfo *texinfo, std::string *err, const detail::json_in &o,
     bool store_original_json_for_extras_and_extensions) {
   if (texinfo == nullptr) {
     return false;
@@ -4479,7 +6159,7 @@ static bool ParseTextureInfo(
 }
 
 static bool ParseNormalTextureInfo(
-    NormalTextureInfo *texinfo, std::string *err, const detail::json &o,
+    NormalTextureInfo *texinfo, std::string *err, const detail::json_in &o,
     bool store_original_json_for_extras_and_extensions) {
   if (texinfo == nullptr) {
     return false;
@@ -4500,7 +6180,7 @@ static bool ParseNormalTextureInfo(
 }
 
 static bool ParseOcclusionTextureInfo(
-    OcclusionTextureInfo *texinfo, std::string *err, const detail::json &o,
+    OcclusionTextureInfo *texinfo, std::string *err, const detail::json_in &o,
     bool store_original_json_for_extras_and_extensions) {
   if (texinfo == nullptr) {
     return false;
@@ -4520,13 +6200,15 @@ static bool ParseOcclusionTextureInfo(
   return true;
 }
 
-static bool ParseBuffer(Buffer *buffer, std::string *err, const detail::json &o,
+static bool ParseBuffer(Buffer *buffer, std::string *err, const detail::json_in &o,
                         bool store_original_json_for_extras_and_extensions,
                         FsCallbacks *fs, const URICallbacks *uri_cb,
                         const std::string &basedir,
                         const size_t max_buffer_size, bool is_binary = false,
                         const unsigned char *bin_data = nullptr,
-                        size_t bin_size = 0) {
+                        size_t bin_size = 0,
+                        const std::shared_ptr<const void> &bin_mapping =
+                            std::shared_ptr<const void>()) {
   size_t byteLength;
   if (!ParseUnsignedProperty(&byteLength, err, o, "byteLength", true,
                              "Buffer")) {
@@ -4544,7 +6226,7 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const detail::json &o,
     }
   }
 
-  detail::json_const_iterator type;
+  detail::json_in_const_iterator type;
   if (detail::FindMember(o, "type", type)) {
     std::string typeStr;
     if (detail::GetString(detail::GetValue(type), typeStr)) {
@@ -4603,9 +6285,18 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const detail::json &o,
         return false;
       }
 
-      // Read buffer data
-      buffer->data.resize(static_cast<size_t>(byteLength));
-      memcpy(&(buffer->data.at(0)), bin_data, static_cast<size_t>(byteLength));
+      if (bin_mapping) {
+        // Refer to the mapped file instead of copying
+        buffer->data.clear();
+        buffer->mapped_data = bin_data;
+        buffer->mapped_size = static_cast<size_t>(byteLength);
+        buffer->mapping = bin_mapping;
+      } else {
+        // Read buffer data
+        buffer->data.resize(static_cast<size_t>(byteLength));
+        memcpy(&(buffer->data.at(0)), bin_data,
+               static_cast<size_t>(byteLength));
+      }
     }
 
   } else {
@@ -4642,7 +6333,7 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const detail::json &o,
 }
 
 static bool ParseBufferView(
-    BufferView *bufferView, std::string *err, const detail::json &o,
+    BufferView *bufferView, std::string *err, const detail::json_in &o,
     bool store_original_json_for_extras_and_extensions) {
   int buffer = -1;
   if (!ParseIntegerProperty(&buffer, err, o, "buffer", true, "BufferView")) {
@@ -4703,7 +6394,7 @@ static bool ParseBufferView(
 }
 
 static bool ParseSparseAccessor(
-    Accessor::Sparse *sparse, std::string *err, const detail::json &o,
+    Accessor::Sparse *sparse, std::string *err, const detail::json_in &o,
     bool store_original_json_for_extras_and_extensions) {
   sparse->isSparse = true;
 
@@ -4715,8 +6406,8 @@ static bool ParseSparseAccessor(
   ParseExtrasAndExtensions(sparse, err, o,
                            store_original_json_for_extras_and_extensions);
 
-  detail::json_const_iterator indices_iterator;
-  detail::json_const_iterator values_iterator;
+  detail::json_in_const_iterator indices_iterator;
+  detail::json_in_const_iterator values_iterator;
   if (!detail::FindMember(o, "indices", indices_iterator)) {
     (*err) = "the sparse object of this accessor doesn't have indices";
     return false;
@@ -4727,8 +6418,8 @@ static bool ParseSparseAccessor(
     return false;
   }
 
-  const detail::json &indices_obj = detail::GetValue(indices_iterator);
-  const detail::json &values_obj = detail::GetValue(values_iterator);
+  const detail::json_in &indices_obj = detail::GetValue(indices_iterator);
+  const detail::json_in &values_obj = detail::GetValue(values_iterator);
 
   int indices_buffer_view = 0, component_type = 0;
   size_t indices_byte_offset = 0;
@@ -4768,7 +6459,7 @@ static bool ParseSparseAccessor(
 }
 
 static bool ParseAccessor(Accessor *accessor, std::string *err,
-                          const detail::json &o,
+                          const detail::json_in &o,
                           bool store_original_json_for_extras_and_extensions) {
   int bufferView = -1;
   ParseIntegerProperty(&bufferView, err, o, "bufferView", false, "Accessor");
@@ -4852,7 +6543,7 @@ static bool ParseAccessor(Accessor *accessor, std::string *err,
                            store_original_json_for_extras_and_extensions);
 
   // check if accessor has a "sparse" object:
-  detail::json_const_iterator iterator;
+  detail::json_in_const_iterator iterator;
   if (detail::FindMember(o, "sparse", iterator)) {
     // here this accessor has a "sparse" subobject
     return ParseSparseAccessor(&accessor->sparse, err,
@@ -4976,7 +6667,7 @@ static bool ParseDracoExtension(Primitive *primitive, Model *model,
   view.dracoDecoded = true;
 
   const char *bufferViewData =
-      reinterpret_cast<const char *>(buffer.data.data() + view.byteOffset);
+      reinterpret_cast<const char *>(buffer.Data() + view.byteOffset);
   size_t bufferViewSize = view.byteLength;
 
   // decode draco
@@ -5085,7 +6776,7 @@ static bool ParseDracoExtension(Primitive *primitive, Model *model,
 
 static bool ParsePrimitive(Primitive *primitive, Model *model,
                            std::string *err, std::string *warn,
-                           const detail::json &o,
+                           const detail::json_in &o,
                            bool store_original_json_for_extras_and_extensions,
                            ParseStrictness strictness) {
   int material = -1;
@@ -5105,19 +6796,19 @@ static bool ParsePrimitive(Primitive *primitive, Model *model,
   }
 
   // Look for morph targets
-  detail::json_const_iterator targetsObject;
+  detail::json_in_const_iterator targetsObject;
   if (detail::FindMember(o, "targets", targetsObject) &&
       detail::IsArray(detail::GetValue(targetsObject))) {
     auto targetsObjectEnd = detail::ArrayEnd(detail::GetValue(targetsObject));
-    for (detail::json_const_array_iterator i =
+    for (detail::json_in_array_iterator i =
              detail::ArrayBegin(detail::GetValue(targetsObject));
          i != targetsObjectEnd; ++i) {
       std::map<std::string, int> targetAttribues;
 
-      const detail::json &dict = *i;
+      const detail::json_in &dict = *i;
       if (detail::IsObject(dict)) {
-        detail::json_const_iterator dictIt(detail::ObjectBegin(dict));
-        detail::json_const_iterator dictItEnd(detail::ObjectEnd(dict));
+        detail::json_in_const_iterator dictIt(detail::ObjectBegin(dict));
+        detail::json_in_const_iterator dictItEnd(detail::ObjectEnd(dict));
 
         for (; dictIt != dictItEnd; ++dictIt) {
           int iVal;
@@ -5149,18 +6840,18 @@ static bool ParsePrimitive(Primitive *primitive, Model *model,
 
 static bool ParseMesh(Mesh *mesh, Model *model,
                       std::string *err, std::string *warn,
-                      const detail::json &o,
+                      const detail::json_in &o,
                       bool store_original_json_for_extras_and_extensions,
                       ParseStrictness strictness) {
   ParseStringProperty(&mesh->name, err, o, "name", false);
 
   mesh->primitives.clear();
-  detail::json_const_iterator primObject;
+  detail::json_in_const_iterator primObject;
   if (detail::FindMember(o, "primitives", primObject) &&
       detail::IsArray(detail::GetValue(primObject))) {
-    detail::json_const_array_iterator primEnd =
+    detail::json_in_array_iterator primEnd =
         detail::ArrayEnd(detail::GetValue(primObject));
-    for (detail::json_const_array_iterator i =
+    for (detail::json_in_array_iterator i =
              detail::ArrayBegin(detail::GetValue(primObject));
          i != primEnd; ++i) {
       Primitive primitive;
@@ -5182,7 +6873,7 @@ static bool ParseMesh(Mesh *mesh, Model *model,
   return true;
 }
 
-static bool ParseNode(Node *node, std::string *err, const detail::json &o,
+static bool ParseNode(Node *node, std::string *err, const detail::json_in &o,
                       bool store_original_json_for_extras_and_extensions) {
   ParseStringProperty(&node->name, err, o, "name", false);
 
@@ -5214,8 +6905,11 @@ static bool ParseNode(Node *node, std::string *err, const detail::json &o,
                            store_original_json_for_extras_and_extensions);
 
   // KHR_lights_punctual: parse light source reference
+  // (The key outgrows the small-string buffer; skip building it for the
+  // common node without extensions.)
   int light = -1;
-  if (node->extensions.count("KHR_lights_punctual") != 0) {
+  if (!node->extensions.empty() &&
+      node->extensions.count("KHR_lights_punctual") != 0) {
     auto const &light_ext = node->extensions["KHR_lights_punctual"];
     if (light_ext.Has("light")) {
       light = light_ext.Get("light").GetNumberAsInt();
@@ -5268,7 +6962,7 @@ static bool ParseNode(Node *node, std::string *err, const detail::json &o,
   return true;
 }
 
-static bool ParseScene(Scene *scene, std::string *err, const detail::json &o,
+static bool ParseScene(Scene *scene, std::string *err, const detail::json_in &o,
                        bool store_original_json_for_extras_and_extensions) {
   ParseStringProperty(&scene->name, err, o, "name", false);
   ParseIntegerArrayProperty(&scene->nodes, err, o, "nodes", false);
@@ -5298,7 +6992,7 @@ static bool ParseScene(Scene *scene, std::string *err, const detail::json &o,
 }
 
 static bool ParsePbrMetallicRoughness(
-    PbrMetallicRoughness *pbr, std::string *err, const detail::json &o,
+    PbrMetallicRoughness *pbr, std::string *err, const detail::json_in &o,
     bool store_original_json_for_extras_and_extensions) {
   if (pbr == nullptr) {
     return false;
@@ -5320,7 +7014,7 @@ static bool ParsePbrMetallicRoughness(
   }
 
   {
-    detail::json_const_iterator it;
+    detail::json_in_const_iterator it;
     if (detail::FindMember(o, "baseColorTexture", it)) {
       ParseTextureInfo(&pbr->baseColorTexture, err, detail::GetValue(it),
                        store_original_json_for_extras_and_extensions);
@@ -5328,7 +7022,7 @@ static bool ParsePbrMetallicRoughness(
   }
 
   {
-    detail::json_const_iterator it;
+    detail::json_in_const_iterator it;
     if (detail::FindMember(o, "metallicRoughnessTexture", it)) {
       ParseTextureInfo(&pbr->metallicRoughnessTexture, err,
                        detail::GetValue(it),
@@ -5346,7 +7040,7 @@ static bool ParsePbrMetallicRoughness(
 }
 
 static bool ParseMaterial(Material *material, std::string *err, std::string *warn,
-                          const detail::json &o,
+                          const detail::json_in &o,
                           bool store_original_json_for_extras_and_extensions,
                           ParseStrictness strictness) {
   ParseStringProperty(&material->name, err, o, "name", /* required */ false);
@@ -5384,7 +7078,7 @@ static bool ParseMaterial(Material *material, std::string *err, std::string *war
                        /* required */ false);
 
   {
-    detail::json_const_iterator it;
+    detail::json_in_const_iterator it;
     if (detail::FindMember(o, "pbrMetallicRoughness", it)) {
       ParsePbrMetallicRoughness(&material->pbrMetallicRoughness, err,
                                 detail::GetValue(it),
@@ -5393,7 +7087,7 @@ static bool ParseMaterial(Material *material, std::string *err, std::string *war
   }
 
   {
-    detail::json_const_iterator it;
+    detail::json_in_const_iterator it;
     if (detail::FindMember(o, "normalTexture", it)) {
       ParseNormalTextureInfo(&material->normalTexture, err,
                              detail::GetValue(it),
@@ -5402,7 +7096,7 @@ static bool ParseMaterial(Material *material, std::string *err, std::string *war
   }
 
   {
-    detail::json_const_iterator it;
+    detail::json_in_const_iterator it;
     if (detail::FindMember(o, "occlusionTexture", it)) {
       ParseOcclusionTextureInfo(&material->occlusionTexture, err,
                                 detail::GetValue(it),
@@ -5411,7 +7105,7 @@ static bool ParseMaterial(Material *material, std::string *err, std::string *war
   }
 
   {
-    detail::json_const_iterator it;
+    detail::json_in_const_iterator it;
     if (detail::FindMember(o, "emissiveTexture", it)) {
       ParseTextureInfo(&material->emissiveTexture, err, detail::GetValue(it),
                        store_original_json_for_extras_and_extensions);
@@ -5426,17 +7120,17 @@ static bool ParseMaterial(Material *material, std::string *err, std::string *war
   material->values.clear();
   material->additionalValues.clear();
 
-  detail::json_const_iterator it(detail::ObjectBegin(o));
-  detail::json_const_iterator itEnd(detail::ObjectEnd(o));
+  detail::json_in_const_iterator it(detail::ObjectBegin(o));
+  detail::json_in_const_iterator itEnd(detail::ObjectEnd(o));
 
   for (; it != itEnd; ++it) {
     std::string key(detail::GetKey(it));
     if (key == "pbrMetallicRoughness") {
       if (detail::IsObject(detail::GetValue(it))) {
-        const detail::json &values_object = detail::GetValue(it);
+        const detail::json_in &values_object = detail::GetValue(it);
 
-        detail::json_const_iterator itVal(detail::ObjectBegin(values_object));
-        detail::json_const_iterator itValEnd(detail::ObjectEnd(values_object));
+        detail::json_in_const_iterator itVal(detail::ObjectBegin(values_object));
+        detail::json_in_const_iterator itValEnd(detail::ObjectEnd(values_object));
 
         for (; itVal != itValEnd; ++itVal) {
           Parameter param;
@@ -5486,7 +7180,7 @@ static bool ParseMaterial(Material *material, std::string *err, std::string *war
 }
 
 static bool ParseAnimationChannel(
-    AnimationChannel *channel, std::string *err, const detail::json &o,
+    AnimationChannel *channel, std::string *err, const detail::json_in &o,
     bool store_original_json_for_extras_and_extensions) {
   int samplerIndex = -1;
   int targetIndex = -1;
@@ -5498,10 +7192,10 @@ static bool ParseAnimationChannel(
     return false;
   }
 
-  detail::json_const_iterator targetIt;
+  detail::json_in_const_iterator targetIt;
   if (detail::FindMember(o, "target", targetIt) &&
       detail::IsObject(detail::GetValue(targetIt))) {
-    const detail::json &target_object = detail::GetValue(targetIt);
+    const detail::json_in &target_object = detail::GetValue(targetIt);
 
     ParseIntegerProperty(&targetIndex, err, target_object, "node", false);
 
@@ -5516,14 +7210,14 @@ static bool ParseAnimationChannel(
     ParseExtrasProperty(&channel->target_extras, target_object);
     if (store_original_json_for_extras_and_extensions) {
       {
-        detail::json_const_iterator it;
+        detail::json_in_const_iterator it;
         if (detail::FindMember(target_object, "extensions", it)) {
           channel->target_extensions_json_string =
               detail::JsonToString(detail::GetValue(it));
         }
       }
       {
-        detail::json_const_iterator it;
+        detail::json_in_const_iterator it;
         if (detail::FindMember(target_object, "extras", it)) {
           channel->target_extras_json_string =
               detail::JsonToString(detail::GetValue(it));
@@ -5542,15 +7236,15 @@ static bool ParseAnimationChannel(
 }
 
 static bool ParseAnimation(Animation *animation, std::string *err,
-                           const detail::json &o,
+                           const detail::json_in &o,
                            bool store_original_json_for_extras_and_extensions) {
   {
-    detail::json_const_iterator channelsIt;
+    detail::json_in_const_iterator channelsIt;
     if (detail::FindMember(o, "channels", channelsIt) &&
         detail::IsArray(detail::GetValue(channelsIt))) {
-      detail::json_const_array_iterator channelEnd =
+      detail::json_in_array_iterator channelEnd =
           detail::ArrayEnd(detail::GetValue(channelsIt));
-      for (detail::json_const_array_iterator i =
+      for (detail::json_in_array_iterator i =
                detail::ArrayBegin(detail::GetValue(channelsIt));
            i != channelEnd; ++i) {
         AnimationChannel channel;
@@ -5565,16 +7259,16 @@ static bool ParseAnimation(Animation *animation, std::string *err,
   }
 
   {
-    detail::json_const_iterator samplerIt;
+    detail::json_in_const_iterator samplerIt;
     if (detail::FindMember(o, "samplers", samplerIt) &&
         detail::IsArray(detail::GetValue(samplerIt))) {
-      const detail::json &sampler_array = detail::GetValue(samplerIt);
+      const detail::json_in &sampler_array = detail::GetValue(samplerIt);
 
-      detail::json_const_array_iterator it = detail::ArrayBegin(sampler_array);
-      detail::json_const_array_iterator itEnd = detail::ArrayEnd(sampler_array);
+      detail::json_in_array_iterator it = detail::ArrayBegin(sampler_array);
+      detail::json_in_array_iterator itEnd = detail::ArrayEnd(sampler_array);
 
       for (; it != itEnd; ++it) {
-        const detail::json &s = *it;
+        const detail::json_in &s = *it;
 
         AnimationSampler sampler;
         int inputIndex = -1;
@@ -5612,7 +7306,7 @@ static bool ParseAnimation(Animation *animation, std::string *err,
 }
 
 static bool ParseSampler(Sampler *sampler, std::string *err,
-                         const detail::json &o,
+                         const detail::json_in &o,
                          bool store_original_json_for_extras_and_extensions) {
   ParseStringProperty(&sampler->name, err, o, "name", false);
 
@@ -5643,7 +7337,7 @@ static bool ParseSampler(Sampler *sampler, std::string *err,
   return true;
 }
 
-static bool ParseSkin(Skin *skin, std::string *err, const detail::json &o,
+static bool ParseSkin(Skin *skin, std::string *err, const detail::json_in &o,
                       bool store_original_json_for_extras_and_extensions) {
   ParseStringProperty(&skin->name, err, o, "name", false, "Skin");
 
@@ -5668,7 +7362,7 @@ static bool ParseSkin(Skin *skin, std::string *err, const detail::json &o,
 }
 
 static bool ParsePerspectiveCamera(
-    PerspectiveCamera *camera, std::string *err, const detail::json &o,
+    PerspectiveCamera *camera, std::string *err, const detail::json_in &o,
     bool store_original_json_for_extras_and_extensions) {
   double yfov = 0.0;
   if (!ParseNumberProperty(&yfov, err, o, "yfov", true, "OrthographicCamera")) {
@@ -5702,7 +7396,7 @@ static bool ParsePerspectiveCamera(
 }
 
 static bool ParseSpotLight(SpotLight *light, std::string *err,
-                           const detail::json &o,
+                           const detail::json_in &o,
                            bool store_original_json_for_extras_and_extensions) {
   ParseNumberProperty(&light->innerConeAngle, err, o, "innerConeAngle", false);
   ParseNumberProperty(&light->outerConeAngle, err, o, "outerConeAngle", false);
@@ -5716,7 +7410,7 @@ static bool ParseSpotLight(SpotLight *light, std::string *err,
 }
 
 static bool ParseOrthographicCamera(
-    OrthographicCamera *camera, std::string *err, const detail::json &o,
+    OrthographicCamera *camera, std::string *err, const detail::json_in &o,
     bool store_original_json_for_extras_and_extensions) {
   double xmag = 0.0;
   if (!ParseNumberProperty(&xmag, err, o, "xmag", true, "OrthographicCamera")) {
@@ -5752,14 +7446,14 @@ static bool ParseOrthographicCamera(
   return true;
 }
 
-static bool ParseCamera(Camera *camera, std::string *err, const detail::json &o,
+static bool ParseCamera(Camera *camera, std::string *err, const detail::json_in &o,
                         bool store_original_json_for_extras_and_extensions) {
   if (!ParseStringProperty(&camera->type, err, o, "type", true, "Camera")) {
     return false;
   }
 
   if (camera->type.compare("orthographic") == 0) {
-    detail::json_const_iterator orthoIt;
+    detail::json_in_const_iterator orthoIt;
     if (!detail::FindMember(o, "orthographic", orthoIt)) {
       if (err) {
         std::stringstream ss;
@@ -5769,7 +7463,7 @@ static bool ParseCamera(Camera *camera, std::string *err, const detail::json &o,
       return false;
     }
 
-    const detail::json &v = detail::GetValue(orthoIt);
+    const detail::json_in &v = detail::GetValue(orthoIt);
     if (!detail::IsObject(v)) {
       if (err) {
         std::stringstream ss;
@@ -5785,7 +7479,7 @@ static bool ParseCamera(Camera *camera, std::string *err, const detail::json &o,
       return false;
     }
   } else if (camera->type.compare("perspective") == 0) {
-    detail::json_const_iterator perspIt;
+    detail::json_in_const_iterator perspIt;
     if (!detail::FindMember(o, "perspective", perspIt)) {
       if (err) {
         std::stringstream ss;
@@ -5795,7 +7489,7 @@ static bool ParseCamera(Camera *camera, std::string *err, const detail::json &o,
       return false;
     }
 
-    const detail::json &v = detail::GetValue(perspIt);
+    const detail::json_in &v = detail::GetValue(perspIt);
     if (!detail::IsObject(v)) {
       if (err) {
         std::stringstream ss;
@@ -5828,14 +7522,14 @@ static bool ParseCamera(Camera *camera, std::string *err, const detail::json &o,
   return true;
 }
 
-static bool ParseLight(Light *light, std::string *err, const detail::json &o,
+static bool ParseLight(Light *light, std::string *err, const detail::json_in &o,
                        bool store_original_json_for_extras_and_extensions) {
   if (!ParseStringProperty(&light->type, err, o, "type", true)) {
     return false;
   }
 
   if (light->type == "spot") {
-    detail::json_const_iterator spotIt;
+    detail::json_in_const_iterator spotIt;
     if (!detail::FindMember(o, "spot", spotIt)) {
       if (err) {
         std::stringstream ss;
@@ -5845,134 +7539,814 @@ static bool ParseLight(Light *light, std::string *err, const detail::json &o,
       return false;
     }
 
-    const detail::json &v = detail::GetValue(spotIt);
-    if (!detail::IsObject(v)) {
+    const detail::json_in &v = detail::GetValue(spotIt);
+    if (!detail::IsObject(v)) {
+      if (err) {
+        std::stringstream ss;
+        ss << "\"spot\" is not a JSON object." << std::endl;
+        (*err) += ss.str();
+      }
+      return false;
+    }
+
+    if (!ParseSpotLight(&light->spot, err, v,
+                        store_original_json_for_extras_and_extensions)) {
+      return false;
+    }
+  }
+
+  ParseStringProperty(&light->name, err, o, "name", false);
+  ParseNumberArrayProperty(&light->color, err, o, "color", false);
+  ParseNumberProperty(&light->range, err, o, "range", false);
+  ParseNumberProperty(&light->intensity, err, o, "intensity", false);
+
+  ParseExtrasAndExtensions(light, err, o,
+                           store_original_json_for_extras_and_extensions);
+
+  return true;
+}
+
+static bool ParsePositionalEmitter(
+    PositionalEmitter *positional, std::string *err, const detail::json_in &o,
+    bool store_original_json_for_extras_and_extensions) {
+  ParseNumberProperty(&positional->coneInnerAngle, err, o, "coneInnerAngle",
+                      false);
+  ParseNumberProperty(&positional->coneOuterAngle, err, o, "coneOuterAngle",
+                      false);
+  ParseNumberProperty(&positional->coneOuterGain, err, o, "coneOuterGain",
+                      false);
+  ParseNumberProperty(&positional->maxDistance, err, o, "maxDistance", false);
+  ParseNumberProperty(&positional->refDistance, err, o, "refDistance", false);
+  ParseNumberProperty(&positional->rolloffFactor, err, o, "rolloffFactor",
+                      false);
+
+  ParseExtrasAndExtensions(positional, err, o,
+                           store_original_json_for_extras_and_extensions);
+
+  return true;
+}
+
+static bool ParseAudioEmitter(
+    AudioEmitter *emitter, std::string *err, const detail::json_in &o,
+    bool store_original_json_for_extras_and_extensions) {
+  if (!ParseStringProperty(&emitter->type, err, o, "type", true)) {
+    return false;
+  }
+
+  if (emitter->type == "positional") {
+    detail::json_in_const_iterator positionalIt;
+    if (!detail::FindMember(o, "positional", positionalIt)) {
+      if (err) {
+        std::stringstream ss;
+        ss << "Positional emitter description not found." << std::endl;
+        (*err) += ss.str();
+      }
+      return false;
+    }
+
+    const detail::json_in &v = detail::GetValue(positionalIt);
+    if (!detail::IsObject(v)) {
+      if (err) {
+        std::stringstream ss;
+        ss << "\"positional\" is not a JSON object." << std::endl;
+        (*err) += ss.str();
+      }
+      return false;
+    }
+
+    if (!ParsePositionalEmitter(
+            &emitter->positional, err, v,
+            store_original_json_for_extras_and_extensions)) {
+      return false;
+    }
+  }
+
+  ParseStringProperty(&emitter->name, err, o, "name", false);
+  ParseNumberProperty(&emitter->gain, err, o, "gain", false);
+  ParseBooleanProperty(&emitter->loop, err, o, "loop", false);
+  ParseBooleanProperty(&emitter->playing, err, o, "playing", false);
+  ParseStringProperty(&emitter->distanceModel, err, o, "distanceModel", false);
+  ParseIntegerProperty(&emitter->source, err, o, "source", true);
+
+  ParseExtrasAndExtensions(emitter, err, o,
+                           store_original_json_for_extras_and_extensions);
+
+  return true;
+}
+
+static bool ParseAudioSource(
+    AudioSource *source, std::string *err, const detail::json_in &o,
+    bool store_original_json_for_extras_and_extensions) {
+  ParseStringProperty(&source->name, err, o, "name", false);
+  ParseStringProperty(&source->uri, err, o, "uri", false);
+
+  if (source->uri.empty()) {
+    ParseIntegerProperty(&source->bufferView, err, o, "bufferView", true);
+    ParseStringProperty(&source->mimeType, err, o, "mimeType", true);
+  }
+
+  ParseExtrasAndExtensions(source, err, o,
+                           store_original_json_for_extras_and_extensions);
+
+  return true;
+}
+
+namespace detail {
+
+template <typename Callback>
+bool ForEachInArray(const detail::json_in &_v, const char *member, Callback &&cb) {
+  detail::json_in_const_iterator itm;
+  if (detail::FindMember(_v, member, itm) &&
+      detail::IsArray(detail::GetValue(itm))) {
+    const detail::json_in &root = detail::GetValue(itm);
+    auto it = detail::ArrayBegin(root);
+    auto end = detail::ArrayEnd(root);
+    for (; it != end; ++it) {
+      if (!cb(*it)) return false;
+    }
+  }
+  return true;
+};
+
+// Sizes `vec` for the elements of array `member`, so parsing appends
+// without regrowing
+template <typename T>
+void ReserveForArray(std::vector<T> *vec, const detail::json_in &_v,
+                     const char *member) {
+  detail::json_in_const_iterator itm;
+  if (detail::FindMember(_v, member, itm) &&
+      detail::IsArray(detail::GetValue(itm))) {
+    vec->reserve(vec->size() + detail::ArraySize(detail::GetValue(itm)));
+  }
+}
+
+// What a subset load keeps of each top-level array, as the new index of
+// every element (-1: left out). Arrays without a map here (textures,
+// samplers, cameras, ...) are loaded whole. Images are only parsed when
+// kept but stay at their index, so `images` holds 0 for kept ones.
+struct SubsetSelection {
+  std::vector<int> buffers;
+  std::vector<int> bufferViews;
+  std::vector<int> accessors;
+  std::vector<int> meshes;
+  std::vector<int> nodes;
+  std::vector<int> skins;
+  std::vector<int> materials;
+  std::vector<int> images;
+  std::vector<int> animations;
+  std::vector<int> scenes;
+
+  // Roots of the scene made up for a node subset (original indices)
+  std::vector<int> roots;
+
+  // Byte ranges of an original buffer copied into its compacted one
+  struct Range {
+    size_t src;
+    size_t dst;
+    size_t size;
+  };
+  std::vector<std::vector<Range>> buffer_ranges;
+  std::vector<size_t> buffer_sizes;
+  std::vector<size_t> view_offsets;  // per original view, in its new buffer
+};
+
+inline int SubsetIndex(const std::vector<int> &map, int i) {
+  return (i >= 0 && size_t(i) < map.size()) ? map[size_t(i)] : -1;
+}
+
+// Marks element `i` kept; false when it already was or does not exist
+inline bool SubsetMark(std::vector<int> *map, int i) {
+  if (i < 0 || size_t(i) >= map->size() || (*map)[size_t(i)] >= 0) {
+    return false;
+  }
+  (*map)[size_t(i)] = 0;
+  return true;
+}
+
+// Numbers kept elements in file order
+inline void SubsetNumber(std::vector<int> *map) {
+  int next = 0;
+  for (int &i : *map) {
+    if (i >= 0) i = next++;
+  }
+}
+
+inline int SubsetInt(const detail::json_in &o, const char *member) {
+  detail::json_in_const_iterator it;
+  int i;
+  if (detail::FindMember(o, member, it) &&
+      detail::GetInt(detail::GetValue(it), i)) {
+    return i;
+  }
+  return -1;
+}
+
+inline const detail::json_in *SubsetObject(const detail::json_in &o,
+                                           const char *member) {
+  detail::json_in_const_iterator it;
+  if (detail::FindMember(o, member, it) &&
+      detail::IsObject(detail::GetValue(it))) {
+    return &detail::GetValue(it);
+  }
+  return nullptr;
+}
+
+template <typename Callback>
+void ForEachSubsetInt(const detail::json_in &o, const char *member,
+                      Callback &&cb) {
+  ForEachInArray(o, member, [&](const detail::json_in &e) {
+    int i;
+    if (detail::GetInt(e, i)) cb(i);
+    return true;
+  });
+}
+
+// Marks the accessors named by an attribute object ("POSITION": 3, ...)
+inline void SubsetMarkAttributes(const detail::json_in &o,
+                                 std::vector<int> *accessors) {
+  if (!detail::IsObject(o)) return;
+  for (auto it = detail::ObjectBegin(o); it != detail::ObjectEnd(o); ++it) {
+    int i;
+    if (detail::GetInt(detail::GetValue(it), i)) SubsetMark(accessors, i);
+  }
+}
+
+// Texture indices of every "...Texture": {"index": i} in a material,
+// extensions included
+inline void SubsetMaterialTextures(const detail::json_in &o,
+                                   std::vector<int> *textures) {
+  for (auto it = detail::ObjectBegin(o); it != detail::ObjectEnd(o); ++it) {
+    const detail::json_in &value = detail::GetValue(it);
+    if (!detail::IsObject(value)) continue;
+    const std::string key = detail::GetKey(it);
+    if (key.size() >= 7 && key.compare(key.size() - 7, 7, "Texture") == 0) {
+      int index = SubsetInt(value, "index");
+      if (index >= 0) textures->push_back(index);
+    }
+    SubsetMaterialTextures(value, textures);
+  }
+}
+
+// Works out what a subset load keeps, from the JSON alone
+inline bool SelectSubset(const detail::json_in &v, const ModelSubset &subset,
+                         SubsetSelection *sel, std::string *err) {
+  auto elements = [&](const char *member) {
+    std::vector<const detail::json_in *> out;
+    ForEachInArray(v, member, [&](const detail::json_in &o) {
+      out.push_back(&o);
+      return true;
+    });
+    return out;
+  };
+
+  const auto buffers = elements("buffers");
+  const auto views = elements("bufferViews");
+  const auto accessors = elements("accessors");
+  const auto meshes = elements("meshes");
+  const auto nodes = elements("nodes");
+  const auto skins = elements("skins");
+  const auto materials = elements("materials");
+  const auto textures = elements("textures");
+  const auto images = elements("images");
+  const auto animations = elements("animations");
+  const auto scenes = elements("scenes");
+
+  sel->buffers.assign(buffers.size(), -1);
+  sel->bufferViews.assign(views.size(), -1);
+  sel->accessors.assign(accessors.size(), -1);
+  sel->meshes.assign(meshes.size(), -1);
+  sel->nodes.assign(nodes.size(), -1);
+  sel->skins.assign(skins.size(), -1);
+  sel->materials.assign(materials.size(), -1);
+  sel->images.assign(images.size(), -1);
+  sel->animations.assign(animations.size(), -1);
+  sel->scenes.assign(scenes.size(), -1);
+  sel->roots.clear();
+
+  // Nodes whose parentless ones become the roots of a made up scene
+  std::vector<int> requested = subset.nodes;
+
+  std::vector<int> stack;
+  if (subset.nodes.empty() && subset.scene < 0 && scenes.empty()) {
+    // No scene to pick by default: every root node
+    for (size_t i = 0; i < nodes.size(); i++) {
+      requested.push_back(static_cast<int>(i));
+      stack.push_back(static_cast<int>(i));
+    }
+  } else if (subset.nodes.empty()) {
+    int scene = subset.scene;
+    if (scene < 0) scene = (std::max)(SubsetInt(v, "scene"), 0);
+    if (size_t(scene) >= scenes.size()) {
+      if (err) {
+        (*err) += "subset scene[" + std::to_string(scene) + "] not found.\n";
+      }
+      return false;
+    }
+    sel->scenes[size_t(scene)] = 0;
+    ForEachSubsetInt(*scenes[size_t(scene)], "nodes",
+                     [&](int i) { stack.push_back(i); });
+  } else {
+    for (int i : subset.nodes) {
+      if (i < 0 || size_t(i) >= nodes.size()) {
+        if (err) {
+          (*err) += "subset node[" + std::to_string(i) + "] not found.\n";
+        }
+        return false;
+      }
+      stack.push_back(i);
+    }
+  }
+
+  // Nodes, through children, LODs and skin joints
+  std::vector<char> is_child(nodes.size(), 0);
+  while (!stack.empty()) {
+    const int n = stack.back();
+    stack.pop_back();
+    if (!SubsetMark(&sel->nodes, n)) continue;
+
+    const detail::json_in &node = *nodes[size_t(n)];
+    ForEachSubsetInt(node, "children", [&](int i) {
+      if (i >= 0 && size_t(i) < nodes.size()) is_child[size_t(i)] = 1;
+      stack.push_back(i);
+    });
+    if (const detail::json_in *ext = SubsetObject(node, "extensions")) {
+      if (const detail::json_in *lod = SubsetObject(*ext, "MSFT_lod")) {
+        ForEachSubsetInt(*lod, "ids", [&](int i) { stack.push_back(i); });
+      }
+      if (const detail::json_in *instancing =
+              SubsetObject(*ext, "EXT_mesh_gpu_instancing")) {
+        if (const detail::json_in *attributes =
+                SubsetObject(*instancing, "attributes")) {
+          SubsetMarkAttributes(*attributes, &sel->accessors);
+        }
+      }
+    }
+
+    SubsetMark(&sel->meshes, SubsetInt(node, "mesh"));
+
+    const int skin = SubsetInt(node, "skin");
+    if (SubsetMark(&sel->skins, skin)) {
+      const detail::json_in &s = *skins[size_t(skin)];
+      ForEachSubsetInt(s, "joints", [&](int i) { stack.push_back(i); });
+      stack.push_back(SubsetInt(s, "skeleton"));
+      SubsetMark(&sel->accessors, SubsetInt(s, "inverseBindMatrices"));
+    }
+  }
+
+  for (int i : requested) {
+    if (!is_child[size_t(i)] &&
+        std::find(sel->roots.begin(), sel->roots.end(), i) ==
+            sel->roots.end()) {
+      sel->roots.push_back(i);
+    }
+  }
+
+  // Mesh accessors and materials
+  for (size_t m = 0; m < meshes.size(); m++) {
+    if (sel->meshes[m] < 0) continue;
+    bool draco = false;
+    ForEachInArray(*meshes[m], "primitives", [&](const detail::json_in &p) {
+      if (const detail::json_in *attributes = SubsetObject(p, "attributes")) {
+        SubsetMarkAttributes(*attributes, &sel->accessors);
+      }
+      ForEachInArray(p, "targets", [&](const detail::json_in &t) {
+        SubsetMarkAttributes(t, &sel->accessors);
+        return true;
+      });
+      SubsetMark(&sel->accessors, SubsetInt(p, "indices"));
+      SubsetMark(&sel->materials, SubsetInt(p, "material"));
+
+      const detail::json_in *ext = SubsetObject(p, "extensions");
+      draco = draco ||
+              (ext && SubsetObject(*ext, "KHR_draco_mesh_compression"));
+      if (const detail::json_in *variants =
+              ext ? SubsetObject(*ext, "KHR_materials_variants") : nullptr) {
+        ForEachInArray(*variants, "mappings", [&](const detail::json_in &m) {
+          SubsetMark(&sel->materials, SubsetInt(m, "material"));
+          return true;
+        });
+      }
+      return true;
+    });
+    if (draco) {
+      if (err) {
+        (*err) += "mesh[" + std::to_string(m) +
+                  "] is Draco compressed, which subset loading does not "
+                  "support.\n";
+      }
+      return false;
+    }
+  }
+
+  // Animations with a channel driving a kept node
+  for (size_t a = 0; a < animations.size(); a++) {
+    std::vector<const detail::json_in *> samplers;
+    ForEachInArray(*animations[a], "samplers", [&](const detail::json_in &o) {
+      samplers.push_back(&o);
+      return true;
+    });
+    ForEachInArray(*animations[a], "channels", [&](const detail::json_in &c) {
+      const detail::json_in *target = SubsetObject(c, "target");
+      if (!target || SubsetIndex(sel->nodes, SubsetInt(*target, "node")) < 0) {
+        return true;
+      }
+      sel->animations[a] = 0;
+      const int s = SubsetInt(c, "sampler");
+      if (s >= 0 && size_t(s) < samplers.size()) {
+        SubsetMark(&sel->accessors, SubsetInt(*samplers[size_t(s)], "input"));
+        SubsetMark(&sel->accessors, SubsetInt(*samplers[size_t(s)], "output"));
+      }
+      return true;
+    });
+  }
+
+  // Images of the textures kept materials use
+  std::vector<int> used_textures;
+  for (size_t m = 0; m < materials.size(); m++) {
+    if (sel->materials[m] >= 0 && detail::IsObject(*materials[m])) {
+      SubsetMaterialTextures(*materials[m], &used_textures);
+    }
+  }
+  for (int t : used_textures) {
+    if (size_t(t) >= textures.size()) continue;
+    const detail::json_in &texture = *textures[size_t(t)];
+    SubsetMark(&sel->images, SubsetInt(texture, "source"));
+    // KHR_texture_basisu, EXT_texture_webp, ...
+    if (const detail::json_in *ext = SubsetObject(texture, "extensions")) {
+      for (auto it = detail::ObjectBegin(*ext); it != detail::ObjectEnd(*ext);
+           ++it) {
+        if (detail::IsObject(detail::GetValue(it))) {
+          SubsetMark(&sel->images, SubsetInt(detail::GetValue(it), "source"));
+        }
+      }
+    }
+  }
+  for (size_t i = 0; i < images.size(); i++) {
+    if (sel->images[i] >= 0) {
+      SubsetMark(&sel->bufferViews, SubsetInt(*images[i], "bufferView"));
+    }
+  }
+
+  // Buffer views of kept accessors, sparse storage included
+  for (size_t a = 0; a < accessors.size(); a++) {
+    if (sel->accessors[a] < 0) continue;
+    const detail::json_in &accessor = *accessors[a];
+    SubsetMark(&sel->bufferViews, SubsetInt(accessor, "bufferView"));
+    if (const detail::json_in *sparse = SubsetObject(accessor, "sparse")) {
+      if (const detail::json_in *o = SubsetObject(*sparse, "indices")) {
+        SubsetMark(&sel->bufferViews, SubsetInt(*o, "bufferView"));
+      }
+      if (const detail::json_in *o = SubsetObject(*sparse, "values")) {
+        SubsetMark(&sel->bufferViews, SubsetInt(*o, "bufferView"));
+      }
+    }
+  }
+
+  // Pack the byte ranges of kept views into compacted buffers. Each range
+  // keeps its offset modulo 16, so element alignment is preserved.
+  struct ViewRange {
+    size_t offset;
+    size_t length;
+    size_t view;
+  };
+  std::vector<std::vector<ViewRange>> by_buffer(buffers.size());
+  for (size_t i = 0; i < views.size(); i++) {
+    if (sel->bufferViews[i] < 0) continue;
+    const int b = SubsetInt(*views[i], "buffer");
+    if (b < 0 || size_t(b) >= buffers.size()) continue;
+    ViewRange r{0, 0, i};
+    ParseUnsignedProperty(&r.offset, nullptr, *views[i], "byteOffset", false);
+    ParseUnsignedProperty(&r.length, nullptr, *views[i], "byteLength", false);
+    sel->buffers[size_t(b)] = 0;
+    by_buffer[size_t(b)].push_back(r);
+  }
+
+  sel->view_offsets.assign(views.size(), 0);
+  sel->buffer_ranges.assign(buffers.size(), {});
+  sel->buffer_sizes.assign(buffers.size(), 0);
+  for (size_t b = 0; b < buffers.size(); b++) {
+    auto &list = by_buffer[b];
+    std::sort(list.begin(), list.end(),
+              [](const ViewRange &x, const ViewRange &y) {
+                return x.offset < y.offset;
+              });
+    auto &ranges = sel->buffer_ranges[b];
+    size_t size = 0;
+    for (const ViewRange &r : list) {
+      if (ranges.empty() || r.offset > ranges.back().src + ranges.back().size) {
+        size_t dst = size + ((r.offset - size) & 15);
+        ranges.push_back({r.offset, dst, 0});
+      }
+      SubsetSelection::Range &range = ranges.back();
+      range.size = (std::max)(range.size, r.offset + r.length - range.src);
+      size = range.dst + range.size;
+      sel->view_offsets[r.view] = range.dst + (r.offset - range.src);
+    }
+    sel->buffer_sizes[b] = size;
+  }
+
+  SubsetNumber(&sel->buffers);
+  SubsetNumber(&sel->bufferViews);
+  SubsetNumber(&sel->accessors);
+  SubsetNumber(&sel->meshes);
+  SubsetNumber(&sel->nodes);
+  SubsetNumber(&sel->skins);
+  SubsetNumber(&sel->materials);
+  SubsetNumber(&sel->animations);
+  SubsetNumber(&sel->scenes);
+  return true;
+}
+
+// Copies the kept byte ranges of a buffer into owned storage
+inline bool CompactSubsetBuffer(Buffer *buffer, int index,
+                                const SubsetSelection &sel, std::string *err) {
+  std::vector<unsigned char> data(sel.buffer_sizes[size_t(index)]);
+  const unsigned char *src = buffer->Data();
+  const size_t size = buffer->Size();
+  for (const auto &r : sel.buffer_ranges[size_t(index)]) {
+    if (r.src > size || r.size > size - r.src) {
       if (err) {
-        std::stringstream ss;
-        ss << "\"spot\" is not a JSON object." << std::endl;
-        (*err) += ss.str();
+        (*err) += "buffer[" + std::to_string(index) +
+                  "] is smaller than its buffer views.\n";
       }
       return false;
     }
-
-    if (!ParseSpotLight(&light->spot, err, v,
-                        store_original_json_for_extras_and_extensions)) {
-      return false;
-    }
+    if (r.size) memcpy(&data[r.dst], src + r.src, r.size);
   }
 
-  ParseStringProperty(&light->name, err, o, "name", false);
-  ParseNumberArrayProperty(&light->color, err, o, "color", false);
-  ParseNumberProperty(&light->range, err, o, "range", false);
-  ParseNumberProperty(&light->intensity, err, o, "intensity", false);
+  buffer->data.swap(data);
+  buffer->mapped_data = nullptr;
+  buffer->mapped_size = 0;
+  buffer->mapping.reset();
+  return true;
+}
 
-  ParseExtrasAndExtensions(light, err, o,
-                           store_original_json_for_extras_and_extensions);
+// ---- Renumbering parsed elements into the subset ----
 
-  return true;
+// Index map of the elements of T a subset filters, null if it keeps all
+template <typename T>
+const std::vector<int> *SubsetMap(const SubsetSelection &, const T *) {
+  return nullptr;
+}
+inline const std::vector<int> *SubsetMap(const SubsetSelection &s,
+                                         const BufferView *) {
+  return &s.bufferViews;
+}
+inline const std::vector<int> *SubsetMap(const SubsetSelection &s,
+                                         const Accessor *) {
+  return &s.accessors;
+}
+inline const std::vector<int> *SubsetMap(const SubsetSelection &s,
+                                         const Mesh *) {
+  return &s.meshes;
+}
+inline const std::vector<int> *SubsetMap(const SubsetSelection &s,
+                                         const Node *) {
+  return &s.nodes;
+}
+inline const std::vector<int> *SubsetMap(const SubsetSelection &s,
+                                         const Skin *) {
+  return &s.skins;
+}
+inline const std::vector<int> *SubsetMap(const SubsetSelection &s,
+                                         const Material *) {
+  return &s.materials;
+}
+inline const std::vector<int> *SubsetMap(const SubsetSelection &s,
+                                         const Animation *) {
+  return &s.animations;
+}
+inline const std::vector<int> *SubsetMap(const SubsetSelection &s,
+                                         const Scene *) {
+  return &s.scenes;
 }
 
-static bool ParsePositionalEmitter(
-    PositionalEmitter *positional, std::string *err, const detail::json &o,
-    bool store_original_json_for_extras_and_extensions) {
-  ParseNumberProperty(&positional->coneInnerAngle, err, o, "coneInnerAngle",
-                      false);
-  ParseNumberProperty(&positional->coneOuterAngle, err, o, "coneOuterAngle",
-                      false);
-  ParseNumberProperty(&positional->coneOuterGain, err, o, "coneOuterGain",
-                      false);
-  ParseNumberProperty(&positional->maxDistance, err, o, "maxDistance", false);
-  ParseNumberProperty(&positional->refDistance, err, o, "refDistance", false);
-  ParseNumberProperty(&positional->rolloffFactor, err, o, "rolloffFactor",
-                      false);
+// Rewrites the references of an element parsed from array position
+// `index` to subset indices
+template <typename T>
+void RemapToSubset(T *, int, const SubsetSelection &) {}
 
-  ParseExtrasAndExtensions(positional, err, o,
-                           store_original_json_for_extras_and_extensions);
+inline void RemapToSubset(BufferView *view, int index,
+                          const SubsetSelection &s) {
+  view->buffer = SubsetIndex(s.buffers, view->buffer);
+  view->byteOffset = s.view_offsets[size_t(index)];
+}
 
-  return true;
+inline void RemapToSubset(Accessor *accessor, int, const SubsetSelection &s) {
+  accessor->bufferView = SubsetIndex(s.bufferViews, accessor->bufferView);
+  auto &sparse = accessor->sparse;
+  sparse.indices.bufferView =
+      SubsetIndex(s.bufferViews, sparse.indices.bufferView);
+  sparse.values.bufferView =
+      SubsetIndex(s.bufferViews, sparse.values.bufferView);
 }
 
-static bool ParseAudioEmitter(
-    AudioEmitter *emitter, std::string *err, const detail::json &o,
-    bool store_original_json_for_extras_and_extensions) {
-  if (!ParseStringProperty(&emitter->type, err, o, "type", true)) {
-    return false;
+// Renumbers an index held in an extension value
+inline void SubsetRemapValue(Value *value, const std::vector<int> &map) {
+  if (value->IsNumber()) {
+    *value = Value(SubsetIndex(map, value->GetNumberAsInt()));
   }
+}
 
-  if (emitter->type == "positional") {
-    detail::json_const_iterator positionalIt;
-    if (!detail::FindMember(o, "positional", positionalIt)) {
-      if (err) {
-        std::stringstream ss;
-        ss << "Positional emitter description not found." << std::endl;
-        (*err) += ss.str();
+// Member `key` of extension `name`, null when missing
+inline Value *SubsetExtensionMember(ExtensionMap *extensions, const char *name,
+                                    const char *key) {
+  auto ext = extensions->find(name);
+  if (ext == extensions->end() || !ext->second.IsObject()) return nullptr;
+  Value::Object &o = ext->second.Get<Value::Object>();
+  auto it = o.find(key);
+  return it != o.end() ? &it->second : nullptr;
+}
+
+inline void RemapToSubset(Mesh *mesh, int, const SubsetSelection &s) {
+  for (auto &primitive : mesh->primitives) {
+    for (auto &attribute : primitive.attributes) {
+      attribute.second = SubsetIndex(s.accessors, attribute.second);
+    }
+    for (auto &target : primitive.targets) {
+      for (auto &attribute : target) {
+        attribute.second = SubsetIndex(s.accessors, attribute.second);
       }
-      return false;
     }
+    primitive.indices = SubsetIndex(s.accessors, primitive.indices);
+    primitive.material = SubsetIndex(s.materials, primitive.material);
 
-    const detail::json &v = detail::GetValue(positionalIt);
-    if (!detail::IsObject(v)) {
-      if (err) {
-        std::stringstream ss;
-        ss << "\"positional\" is not a JSON object." << std::endl;
-        (*err) += ss.str();
+    Value *mappings = SubsetExtensionMember(
+        &primitive.extensions, "KHR_materials_variants", "mappings");
+    if (mappings && mappings->IsArray()) {
+      for (Value &mapping : mappings->Get<Value::Array>()) {
+        if (!mapping.IsObject()) continue;
+        Value::Object &m = mapping.Get<Value::Object>();
+        auto material = m.find("material");
+        if (material != m.end()) {
+          SubsetRemapValue(&material->second, s.materials);
+        }
       }
-      return false;
     }
+  }
+}
 
-    if (!ParsePositionalEmitter(
-            &emitter->positional, err, v,
-            store_original_json_for_extras_and_extensions)) {
-      return false;
+inline void RemapToSubset(Node *node, int, const SubsetSelection &s) {
+  for (int &child : node->children) child = SubsetIndex(s.nodes, child);
+  for (int &lod : node->lods) lod = SubsetIndex(s.nodes, lod);
+  node->mesh = SubsetIndex(s.meshes, node->mesh);
+  node->skin = SubsetIndex(s.skins, node->skin);
+
+  Value *attributes = SubsetExtensionMember(
+      &node->extensions, "EXT_mesh_gpu_instancing", "attributes");
+  if (attributes && attributes->IsObject()) {
+    for (auto &attribute : attributes->Get<Value::Object>()) {
+      SubsetRemapValue(&attribute.second, s.accessors);
     }
   }
+}
 
-  ParseStringProperty(&emitter->name, err, o, "name", false);
-  ParseNumberProperty(&emitter->gain, err, o, "gain", false);
-  ParseBooleanProperty(&emitter->loop, err, o, "loop", false);
-  ParseBooleanProperty(&emitter->playing, err, o, "playing", false);
-  ParseStringProperty(&emitter->distanceModel, err, o, "distanceModel", false);
-  ParseIntegerProperty(&emitter->source, err, o, "source", true);
-
-  ParseExtrasAndExtensions(emitter, err, o,
-                           store_original_json_for_extras_and_extensions);
+inline void RemapToSubset(Skin *skin, int, const SubsetSelection &s) {
+  for (int &joint : skin->joints) joint = SubsetIndex(s.nodes, joint);
+  skin->skeleton = SubsetIndex(s.nodes, skin->skeleton);
+  skin->inverseBindMatrices =
+      SubsetIndex(s.accessors, skin->inverseBindMatrices);
+}
 
-  return true;
+inline void RemapToSubset(Scene *scene, int, const SubsetSelection &s) {
+  for (int &node : scene->nodes) node = SubsetIndex(s.nodes, node);
 }
 
-static bool ParseAudioSource(
-    AudioSource *source, std::string *err, const detail::json &o,
-    bool store_original_json_for_extras_and_extensions) {
-  ParseStringProperty(&source->name, err, o, "name", false);
-  ParseStringProperty(&source->uri, err, o, "uri", false);
+// Keeps the channels driving kept nodes and the samplers they use
+inline void RemapToSubset(Animation *animation, int,
+                          const SubsetSelection &s) {
+  std::vector<int> sampler_map(animation->samplers.size(), -1);
+  std::vector<AnimationSampler> samplers;
+  std::vector<AnimationChannel> channels;
+  for (auto &channel : animation->channels) {
+    const int node = SubsetIndex(s.nodes, channel.target_node);
+    if (node < 0 || channel.sampler < 0 ||
+        size_t(channel.sampler) >= sampler_map.size()) {
+      continue;
+    }
+    int &sampler = sampler_map[size_t(channel.sampler)];
+    if (sampler < 0) {
+      sampler = static_cast<int>(samplers.size());
+      samplers.emplace_back(
+          std::move(animation->samplers[size_t(channel.sampler)]));
+      samplers.back().input = SubsetIndex(s.accessors, samplers.back().input);
+      samplers.back().output =
+          SubsetIndex(s.accessors, samplers.back().output);
+    }
+    channel.target_node = node;
+    channel.sampler = sampler;
+    channels.emplace_back(std::move(channel));
+  }
+  animation->samplers.swap(samplers);
+  animation->channels.swap(channels);
+}
+
+// Appends the elements of array `member` to `vec`, each filled in place by
+// `parse(T *, std::string *err, std::string *warn, const json_in &)`.
+// With more than one thread the elements are spread over workers in
+// chunks; messages are kept per element and appended in array order up to
+// the first failure, and `vec` is cut back there, so the outcome is that
+// of the serial loop. With a `subset`, elements it leaves out are skipped
+// and the others renumbered into it.
+template <typename T, typename Parse>
+bool ParseArrayElements(std::vector<T> *vec, const detail::json_in &_v,
+                        const char *member, unsigned int threads,
+                        std::string *err, std::string *warn, Parse &&parse,
+                        const SubsetSelection *subset = nullptr) {
+  ReserveForArray(vec, _v, member);
+
+  const std::vector<int> *keep =
+      subset ? SubsetMap(*subset, static_cast<const T *>(nullptr)) : nullptr;
+
+#ifndef TINYGLTF_NO_THREADS
+  if (threads > 1) {
+    std::vector<const detail::json_in *> elements;
+    std::vector<int> indices;  // array position of each element
+    elements.reserve(vec->capacity() - vec->size());
+    int index = 0;
+    ForEachInArray(_v, member, [&](const detail::json_in &o) {
+      if (!keep || SubsetIndex(*keep, index) >= 0) {
+        elements.push_back(&o);
+        indices.push_back(index);
+      }
+      ++index;
+      return true;
+    });
 
-  if (source->uri.empty()) {
-    ParseIntegerProperty(&source->bufferView, err, o, "bufferView", true);
-    ParseStringProperty(&source->mimeType, err, o, "mimeType", true);
-  }
+    const size_t count = elements.size();
+    const size_t base = vec->size();
+    vec->resize(base + count);
 
-  ParseExtrasAndExtensions(source, err, o,
-                           store_original_json_for_extras_and_extensions);
+    std::vector<std::string> errs(count);
+    std::vector<std::string> warns(count);
+    std::vector<char> ok(count, 1);
 
-  return true;
-}
+    const size_t kChunk = 64;
+    const size_t chunks = (count + kChunk - 1) / kChunk;
+    if (threads > chunks) threads = static_cast<unsigned int>(chunks);
 
-namespace detail {
+    std::atomic<size_t> next(0);
+#ifdef TINYGLTF_USE_ARENA
+    std::shared_ptr<Arena> arena = Arena::Current();
+#endif
+    auto worker = [&]() {
+#ifdef TINYGLTF_USE_ARENA
+      Arena::Scope scope(arena);
+#endif
+      for (size_t c = next++; c < chunks; c = next++) {
+        size_t end = (std::min)(count, (c + 1) * kChunk);
+        for (size_t i = c * kChunk; i < end; i++) {
+          ok[i] = parse(&(*vec)[base + i], err ? &errs[i] : nullptr,
+                        warn ? &warns[i] : nullptr, *elements[i])
+                      ? 1
+                      : 0;
+          if (ok[i] && subset) {
+            RemapToSubset(&(*vec)[base + i], indices[i], *subset);
+          }
+        }
+      }
+    };
 
-template <typename Callback>
-bool ForEachInArray(const detail::json &_v, const char *member, Callback &&cb) {
-  detail::json_const_iterator itm;
-  if (detail::FindMember(_v, member, itm) &&
-      detail::IsArray(detail::GetValue(itm))) {
-    const detail::json &root = detail::GetValue(itm);
-    auto it = detail::ArrayBegin(root);
-    auto end = detail::ArrayEnd(root);
-    for (; it != end; ++it) {
-      if (!cb(*it)) return false;
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; t++) {
+      pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : pool) {
+      t.join();
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      if (err) (*err) += errs[i];
+      if (warn) (*warn) += warns[i];
+      if (!ok[i]) {
+        vec->resize(base + i);
+        return false;
+      }
     }
+    return true;
   }
-  return true;
-};
+#else
+  (void)threads;
+#endif
+
+  int index = 0;
+  return ForEachInArray(_v, member, [&](const detail::json_in &o) {
+    const int i = index++;
+    if (keep && SubsetIndex(*keep, i) < 0) {
+      return true;
+    }
+    vec->emplace_back();
+    if (!parse(&vec->back(), err, warn, o)) {
+      vec->pop_back();
+      return false;
+    }
+    if (subset) {
+      RemapToSubset(&vec->back(), i, *subset);
+    }
+    return true;
+  });
+}
 
 }  // end of namespace detail
 
@@ -5988,7 +8362,7 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
     return false;
   }
 
-  detail::JsonDocument v;
+  detail::JsonInDocument v;
 
 #if (defined(__cpp_exceptions) || defined(__EXCEPTIONS) || \
      defined(_CPPUNWIND)) &&                               \
@@ -6026,11 +8400,11 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   {
     bool version_found = false;
-    detail::json_const_iterator it;
+    detail::json_in_const_iterator it;
     if (detail::FindMember(v, "asset", it) &&
         detail::IsObject(detail::GetValue(it))) {
       auto &itObj = detail::GetValue(it);
-      detail::json_const_iterator version_it;
+      detail::json_in_const_iterator version_it;
       std::string versionStr;
       if (detail::FindMember(itObj, "version", version_it) &&
           detail::GetString(detail::GetValue(version_it), versionStr)) {
@@ -6050,9 +8424,9 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
   // scene is not mandatory.
   // FIXME Maybe a better way to handle it than removing the code
 
-  auto IsArrayMemberPresent = [](const detail::json &_v,
+  auto IsArrayMemberPresent = [](const detail::json_in &_v,
                                  const char *name) -> bool {
-    detail::json_const_iterator it;
+    detail::json_in_const_iterator it;
     return detail::FindMember(_v, name, it) &&
            detail::IsArray(detail::GetValue(it));
   };
@@ -6109,12 +8483,18 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
   // Reset the model
   (*model) = Model();
 
+#ifdef TINYGLTF_USE_ARENA
+  // Everything parsed below allocates its Value trees from the model's arena
+  model->arena = std::make_shared<Arena>();
+  Arena::Scope arena_scope(model->arena);
+#endif
+
   // 1. Parse Asset
   {
-    detail::json_const_iterator it;
+    detail::json_in_const_iterator it;
     if (detail::FindMember(v, "asset", it) &&
         detail::IsObject(detail::GetValue(it))) {
-      const detail::json &root = detail::GetValue(it);
+      const detail::json_in &root = detail::GetValue(it);
 
       ParseAsset(&model->asset, err, root,
                  store_original_json_for_extras_and_extensions_);
@@ -6123,9 +8503,34 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   using detail::ForEachInArray;
 
+  unsigned int parse_threads = parse_threads_;
+#ifndef TINYGLTF_NO_THREADS
+  if (parse_threads == 0) {
+    parse_threads = std::thread::hardware_concurrency();
+  }
+#endif
+
+#ifdef TINYGLTF_ENABLE_DRACO
+  // Draco decoding appends buffers and accessors to the model
+  const unsigned int mesh_threads = 1;
+#else
+  const unsigned int mesh_threads = parse_threads;
+#endif
+
+  // Work out what a subset load keeps before parsing anything
+  detail::SubsetSelection selection;
+  const detail::SubsetSelection *subset = nullptr;
+  if (load_subset_) {
+    if (!detail::SelectSubset(v, subset_, &selection, err)) {
+      return false;
+    }
+    subset = &selection;
+  }
+
   // 2. Parse extensionUsed
   {
-    ForEachInArray(v, "extensionsUsed", [&](const detail::json &o) {
+    detail::ReserveForArray(&model->extensionsUsed, v, "extensionsUsed");
+    ForEachInArray(v, "extensionsUsed", [&](const detail::json_in &o) {
       std::string str;
       detail::GetString(o, str);
       model->extensionsUsed.emplace_back(std::move(str));
@@ -6134,7 +8539,8 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
   }
 
   {
-    ForEachInArray(v, "extensionsRequired", [&](const detail::json &o) {
+    detail::ReserveForArray(&model->extensionsRequired, v, "extensionsRequired");
+    ForEachInArray(v, "extensionsRequired", [&](const detail::json_in &o) {
       std::string str;
       detail::GetString(o, str);
       model->extensionsRequired.emplace_back(std::move(str));
@@ -6144,7 +8550,21 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 3. Parse Buffer
   {
-    bool success = ForEachInArray(v, "buffers", [&](const detail::json &o) {
+    // A subset shares the BIN chunk instead of copying it whole, then keeps
+    // only the ranges its views use
+    std::shared_ptr<const void> bin_mapping = bin_mapping_;
+    if (subset && !bin_mapping && bin_data_) {
+      bin_mapping = std::shared_ptr<const void>(
+          static_cast<const void *>(bin_data_), [](const void *) {});
+    }
+
+    int idx = 0;
+    detail::ReserveForArray(&model->buffers, v, "buffers");
+    bool success = ForEachInArray(v, "buffers", [&](const detail::json_in &o) {
+      const int index = idx++;
+      if (subset && detail::SubsetIndex(subset->buffers, index) < 0) {
+        return true;
+      }
       if (!detail::IsObject(o)) {
         if (err) {
           (*err) += "`buffers' does not contain an JSON object.";
@@ -6155,7 +8575,11 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
       if (!ParseBuffer(&buffer, err, o,
                        store_original_json_for_extras_and_extensions_, &fs,
                        &uri_cb, base_dir, max_external_file_size_, is_binary_,
-                       bin_data_, bin_size_)) {
+                       bin_data_, bin_size_, bin_mapping)) {
+        return false;
+      }
+      if (subset &&
+          !detail::CompactSubsetBuffer(&buffer, index, *subset, err)) {
         return false;
       }
 
@@ -6169,22 +8593,23 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
   }
   // 4. Parse BufferView
   {
-    bool success = ForEachInArray(v, "bufferViews", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->bufferViews, v, "bufferViews", parse_threads, err, warn,
+        [&](BufferView *bufferView, std::string *element_err, std::string *,
+            const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`bufferViews' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`bufferViews' does not contain an JSON object.";
         }
         return false;
       }
-      BufferView bufferView;
-      if (!ParseBufferView(&bufferView, err, o,
+      if (!ParseBufferView(bufferView, element_err, o,
                            store_original_json_for_extras_and_extensions_)) {
         return false;
       }
 
-      model->bufferViews.emplace_back(std::move(bufferView));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6193,22 +8618,23 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 5. Parse Accessor
   {
-    bool success = ForEachInArray(v, "accessors", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->accessors, v, "accessors", parse_threads, err, warn,
+        [&](Accessor *accessor, std::string *element_err, std::string *,
+            const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`accessors' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`accessors' does not contain an JSON object.";
         }
         return false;
       }
-      Accessor accessor;
-      if (!ParseAccessor(&accessor, err, o,
+      if (!ParseAccessor(accessor, element_err, o,
                          store_original_json_for_extras_and_extensions_)) {
         return false;
       }
 
-      model->accessors.emplace_back(std::move(accessor));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6217,23 +8643,24 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 6. Parse Mesh
   {
-    bool success = ForEachInArray(v, "meshes", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->meshes, v, "meshes", mesh_threads, err, warn,
+        [&](Mesh *mesh, std::string *element_err, std::string *element_warn,
+            const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`meshes' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`meshes' does not contain an JSON object.";
         }
         return false;
       }
-      Mesh mesh;
-      if (!ParseMesh(&mesh, model, err, warn, o,
+      if (!ParseMesh(mesh, model, element_err, element_warn, o,
                      store_original_json_for_extras_and_extensions_,
                      strictness_)) {
         return false;
       }
 
-      model->meshes.emplace_back(std::move(mesh));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6304,22 +8731,23 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 7. Parse Node
   {
-    bool success = ForEachInArray(v, "nodes", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->nodes, v, "nodes", parse_threads, err, warn,
+        [&](Node *node, std::string *element_err, std::string *,
+            const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`nodes' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`nodes' does not contain an JSON object.";
         }
         return false;
       }
-      Node node;
-      if (!ParseNode(&node, err, o,
+      if (!ParseNode(node, element_err, o,
                      store_original_json_for_extras_and_extensions_)) {
         return false;
       }
 
-      model->nodes.emplace_back(std::move(node));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6328,23 +8756,23 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 8. Parse scenes.
   {
-    bool success = ForEachInArray(v, "scenes", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->scenes, v, "scenes", parse_threads, err, warn,
+        [&](Scene *scene, std::string *element_err, std::string *,
+            const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`scenes' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`scenes' does not contain an JSON object.";
         }
         return false;
       }
-
-      Scene scene;
-      if (!ParseScene(&scene, err, o,
+      if (!ParseScene(scene, element_err, o,
                       store_original_json_for_extras_and_extensions_)) {
         return false;
       }
 
-      model->scenes.emplace_back(std::move(scene));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6353,7 +8781,7 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 9. Parse default scenes.
   {
-    detail::json_const_iterator rootIt;
+    detail::json_in_const_iterator rootIt;
     int iVal;
     if (detail::FindMember(v, "scene", rootIt) &&
         detail::GetInt(detail::GetValue(rootIt), iVal)) {
@@ -6361,27 +8789,40 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
     }
   }
 
+  if (subset) {
+    // A node subset gets a scene of its roots
+    if (!subset->roots.empty()) {
+      Scene scene;
+      for (int root : subset->roots) {
+        scene.nodes.push_back(detail::SubsetIndex(subset->nodes, root));
+      }
+      model->scenes.emplace_back(std::move(scene));
+    }
+    model->defaultScene = model->scenes.empty() ? -1 : 0;
+  }
+
   // 10. Parse Material
   {
-    bool success = ForEachInArray(v, "materials", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->materials, v, "materials", parse_threads, err, warn,
+        [&](Material *material, std::string *element_err,
+            std::string *element_warn, const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`materials' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`materials' does not contain an JSON object.";
         }
         return false;
       }
-      Material material;
-      ParseStringProperty(&material.name, err, o, "name", false);
+      ParseStringProperty(&material->name, element_err, o, "name", false);
 
-      if (!ParseMaterial(&material, err, warn, o,
+      if (!ParseMaterial(material, element_err, element_warn, o,
                          store_original_json_for_extras_and_extensions_,
                          strictness_)) {
         return false;
       }
 
-      model->materials.emplace_back(std::move(material));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6404,21 +8845,45 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   {
     int idx = 0;
-    bool success = ForEachInArray(v, "images", [&](const detail::json &o) {
+    std::vector<detail::PendingImage> pending;
+    detail::ReserveForArray(&model->images, v, "images");
+    bool success = ForEachInArray(v, "images", [&](const detail::json_in &o) {
       if (!detail::IsObject(o)) {
         if (err) {
           (*err) += "image[" + std::to_string(idx) + "] is not a JSON object.";
         }
         return false;
       }
+      if (subset && detail::SubsetIndex(subset->images, idx) < 0) {
+        // Not used by the subset: left empty so indices hold
+        model->images.emplace_back();
+        pending.emplace_back();
+        ++idx;
+        return true;
+      }
+
       Image image;
+      detail::PendingImage encoded;
+      std::string deferred_path;
       if (!ParseImage(&image, idx, err, warn, o,
                       store_original_json_for_extras_and_extensions_, base_dir,
                       max_external_file_size_, &fs, &uri_cb,
-                      this->LoadImageData, load_image_user_data)) {
+                      this->LoadImageData, load_image_user_data,
+                      &encoded.owned,
+                      defer_image_decoding_ ? &deferred_path : nullptr)) {
         return false;
       }
 
+      if (!encoded.owned.empty()) {
+        encoded.bytes = encoded.owned.data();
+        encoded.size = encoded.owned.size();
+      }
+
+      if (subset) {
+        image.bufferView =
+            detail::SubsetIndex(subset->bufferViews, image.bufferView);
+      }
+
       if (image.bufferView != -1) {
         // Load image from the buffer view.
         if (size_t(image.bufferView) >= model->bufferViews.size()) {
@@ -6443,7 +8908,7 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
           return false;
         }
         const Buffer &buffer = model->buffers[size_t(bufferView.buffer)];
-        if (bufferView.byteOffset >= buffer.data.size()) {
+        if (bufferView.byteOffset >= buffer.Size()) {
           if (err) {
             std::stringstream ss;
             ss << "image[" << idx << "] bufferView \"" << image.bufferView
@@ -6459,16 +8924,23 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
           }
           return false;
         }
-        bool ret = LoadImageData(
-            &image, idx, err, warn, image.width, image.height,
-            &buffer.data[bufferView.byteOffset],
-            static_cast<int>(bufferView.byteLength), load_image_user_data);
-        if (!ret) {
-          return false;
-        }
+
+        encoded.bytes = buffer.Data() + bufferView.byteOffset;
+        encoded.size = bufferView.byteLength;
+        encoded.req_width = image.width;
+        encoded.req_height = image.height;
+      }
+
+      if (defer_image_decoding_) {
+        // Keep only where the bytes are; DecodeImage does the rest
+        image.deferred = encoded.bytes != nullptr || !deferred_path.empty();
+        image.encoded.swap(encoded.owned);
+        image.encoded_path = std::move(deferred_path);
+        encoded = detail::PendingImage();
       }
 
       model->images.emplace_back(std::move(image));
+      pending.emplace_back(std::move(encoded));
       ++idx;
       return true;
     });
@@ -6476,27 +8948,42 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
     if (!success) {
       return false;
     }
+
+    // Decode all gathered images at once, in parallel when allowed
+    unsigned int threads = image_decode_threads_;
+    if (threads == 0) {
+#ifndef TINYGLTF_NO_THREADS
+      threads = user_image_loader_ ? 1 : std::thread::hardware_concurrency();
+#endif
+    }
+
+    if (!detail::DecodePendingImages(model->images, pending, LoadImageData,
+                                     load_image_user_data, threads, err,
+                                     warn)) {
+      return false;
+    }
   }
 
   // 12. Parse Texture
   {
-    bool success = ForEachInArray(v, "textures", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->textures, v, "textures", parse_threads, err, warn,
+        [&](Texture *texture, std::string *element_err, std::string *,
+            const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`textures' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`textures' does not contain an JSON object.";
         }
         return false;
       }
-      Texture texture;
-      if (!ParseTexture(&texture, err, o,
+      if (!ParseTexture(texture, element_err, o,
                         store_original_json_for_extras_and_extensions_,
                         base_dir)) {
         return false;
       }
 
-      model->textures.emplace_back(std::move(texture));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6505,22 +8992,23 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 13. Parse Animation
   {
-    bool success = ForEachInArray(v, "animations", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->animations, v, "animations", parse_threads, err, warn,
+        [&](Animation *animation, std::string *element_err, std::string *,
+            const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`animations' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`animations' does not contain an JSON object.";
         }
         return false;
       }
-      Animation animation;
-      if (!ParseAnimation(&animation, err, o,
+      if (!ParseAnimation(animation, element_err, o,
                           store_original_json_for_extras_and_extensions_)) {
         return false;
       }
 
-      model->animations.emplace_back(std::move(animation));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6529,22 +9017,23 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 14. Parse Skin
   {
-    bool success = ForEachInArray(v, "skins", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->skins, v, "skins", parse_threads, err, warn,
+        [&](Skin *skin, std::string *element_err, std::string *,
+            const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`skins' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`skins' does not contain an JSON object.";
         }
         return false;
       }
-      Skin skin;
-      if (!ParseSkin(&skin, err, o,
+      if (!ParseSkin(skin, element_err, o,
                      store_original_json_for_extras_and_extensions_)) {
         return false;
       }
 
-      model->skins.emplace_back(std::move(skin));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6553,22 +9042,23 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 15. Parse Sampler
   {
-    bool success = ForEachInArray(v, "samplers", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->samplers, v, "samplers", parse_threads, err, warn,
+        [&](Sampler *sampler, std::string *element_err, std::string *,
+            const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`samplers' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`samplers' does not contain an JSON object.";
         }
         return false;
       }
-      Sampler sampler;
-      if (!ParseSampler(&sampler, err, o,
+      if (!ParseSampler(sampler, element_err, o,
                         store_original_json_for_extras_and_extensions_)) {
         return false;
       }
 
-      model->samplers.emplace_back(std::move(sampler));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6577,22 +9067,23 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 16. Parse Camera
   {
-    bool success = ForEachInArray(v, "cameras", [&](const detail::json &o) {
+    bool success = detail::ParseArrayElements(
+        &model->cameras, v, "cameras", parse_threads, err, warn,
+        [&](Camera *camera, std::string *element_err, std::string *,
+            const detail::json_in &o) {
       if (!detail::IsObject(o)) {
-        if (err) {
-          (*err) += "`cameras' does not contain an JSON object.";
+        if (element_err) {
+          (*element_err) += "`cameras' does not contain an JSON object.";
         }
         return false;
       }
-      Camera camera;
-      if (!ParseCamera(&camera, err, o,
+      if (!ParseCamera(camera, element_err, o,
                        store_original_json_for_extras_and_extensions_)) {
         return false;
       }
 
-      model->cameras.emplace_back(std::move(camera));
       return true;
-    });
+    }, subset);
 
     if (!success) {
       return false;
@@ -6605,22 +9096,22 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
 
   // 18. Specific extension implementations
   {
-    detail::json_const_iterator rootIt;
+    detail::json_in_const_iterator rootIt;
     if (detail::FindMember(v, "extensions", rootIt) &&
         detail::IsObject(detail::GetValue(rootIt))) {
-      const detail::json &root = detail::GetValue(rootIt);
+      const detail::json_in &root = detail::GetValue(rootIt);
 
-      detail::json_const_iterator it(detail::ObjectBegin(root));
-      detail::json_const_iterator itEnd(detail::ObjectEnd(root));
+      detail::json_in_const_iterator it(detail::ObjectBegin(root));
+      detail::json_in_const_iterator itEnd(detail::ObjectEnd(root));
       for (; it != itEnd; ++it) {
         // parse KHR_lights_punctual extension
         std::string key(detail::GetKey(it));
         if ((key == "KHR_lights_punctual") &&
             detail::IsObject(detail::GetValue(it))) {
-          const detail::json &object = detail::GetValue(it);
-          detail::json_const_iterator itLight;
+          const detail::json_in &object = detail::GetValue(it);
+          detail::json_in_const_iterator itLight;
           if (detail::FindMember(object, "lights", itLight)) {
-            const detail::json &lights = detail::GetValue(itLight);
+            const detail::json_in &lights = detail::GetValue(itLight);
             if (!detail::IsArray(lights)) {
               continue;
             }
@@ -6639,10 +9130,10 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
         }
         // parse KHR_audio extension
         if ((key == "KHR_audio") && detail::IsObject(detail::GetValue(it))) {
-          const detail::json &object = detail::GetValue(it);
-          detail::json_const_iterator itKhrAudio;
+          const detail::json_in &object = detail::GetValue(it);
+          detail::json_in_const_iterator itKhrAudio;
           if (detail::FindMember(object, "emitters", itKhrAudio)) {
-            const detail::json &emitters = detail::GetValue(itKhrAudio);
+            const detail::json_in &emitters = detail::GetValue(itKhrAudio);
             if (!detail::IsArray(emitters)) {
               continue;
             }
@@ -6661,7 +9152,7 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
           }
 
           if (detail::FindMember(object, "sources", itKhrAudio)) {
-            const detail::json &sources = detail::GetValue(itKhrAudio);
+            const detail::json_in &sources = detail::GetValue(itKhrAudio);
             if (!detail::IsArray(sources)) {
               continue;
             }
@@ -6940,6 +9431,28 @@ bool TinyGLTF::LoadBinaryFromFile(Model *model, std::string *err,
     return false;
   }
 
+  std::string basedir = GetBaseDir(filename);
+
+#ifndef TINYGLTF_NO_FS
+  if (map_binary_files_) {
+    const unsigned char *mapped = nullptr;
+    size_t mapped_size = 0;
+    std::shared_ptr<const void> mapping;
+    std::string maperr;
+    if (MapWholeFile(&mapped, &mapped_size, &mapping, &maperr, filename) &&
+        mapped_size <= (std::numeric_limits<unsigned int>::max)()) {
+      // Buffers parsed from the BIN chunk share `mapping`
+      bin_mapping_ = mapping;
+      bool ret = LoadBinaryFromMemory(model, err, warn, mapped,
+                                      static_cast<unsigned int>(mapped_size),
+                                      basedir, check_sections);
+      bin_mapping_.reset();
+      return ret;
+    }
+    // Otherwise read the file as usual
+  }
+#endif
+
   std::vector<unsigned char> data;
   std::string fileerr;
   bool fileread = fs.ReadWholeFile(&data, &fileerr, filename, fs.user_data);
@@ -6951,8 +9464,6 @@ bool TinyGLTF::LoadBinaryFromFile(Model *model, std::string *err,
     return false;
   }
 
-  std::string basedir = GetBaseDir(filename);
-
   bool ret = LoadBinaryFromMemory(model, err, warn, &data.at(0),
                                   static_cast<unsigned int>(data.size()),
                                   basedir, check_sections);
@@ -6960,6 +9471,96 @@ bool TinyGLTF::LoadBinaryFromFile(Model *model, std::string *err,
   return ret;
 }
 
+bool TinyGLTF::DecodeImage(Model *model, int image_idx, std::string *err,
+                           std::string *warn) const {
+  if (!model || image_idx < 0 || size_t(image_idx) >= model->images.size()) {
+    if (err) {
+      (*err) += "image[" + std::to_string(image_idx) + "] not found.\n";
+    }
+    return false;
+  }
+
+  Image &image = model->images[size_t(image_idx)];
+  if (!image.deferred) {
+    return true;
+  }
+
+  if (LoadImageData == nullptr) {
+    if (err) {
+      (*err) += "No LoadImageData callback specified.\n";
+    }
+    return false;
+  }
+
+  const unsigned char *bytes = nullptr;
+  size_t size = 0;
+  int req_width = 0;
+  int req_height = 0;
+  std::vector<unsigned char> file;
+
+  if (image.bufferView >= 0) {
+    // Validated when the model was loaded
+    const BufferView &view = model->bufferViews[size_t(image.bufferView)];
+    const Buffer &buffer = model->buffers[size_t(view.buffer)];
+    bytes = buffer.Data() + view.byteOffset;
+    size = view.byteLength;
+    req_width = image.width;
+    req_height = image.height;
+  } else if (!image.encoded.empty()) {
+    bytes = image.encoded.data();
+    size = image.encoded.size();
+  } else if (!image.encoded_path.empty()) {
+    if (fs.GetFileSizeInBytes) {
+      size_t file_size = 0;
+      std::string fserr;
+      if (!fs.GetFileSizeInBytes(&file_size, &fserr, image.encoded_path,
+                                 fs.user_data) ||
+          file_size > max_external_file_size_) {
+        if (err) {
+          (*err) += "Cannot read image file : " + image.encoded_path + "\n";
+        }
+        return false;
+      }
+    }
+
+    std::string fserr;
+    if (!fs.ReadWholeFile ||
+        !fs.ReadWholeFile(&file, &fserr, image.encoded_path, fs.user_data) ||
+        file.empty()) {
+      if (err) {
+        (*err) += "Failed to read image file : " + image.encoded_path + " " +
+                  fserr + "\n";
+      }
+      return false;
+    }
+    bytes = file.data();
+    size = file.size();
+  } else {
+    if (err) {
+      (*err) += "No encoded data for image[" + std::to_string(image_idx) +
+                "].\n";
+    }
+    return false;
+  }
+
+  LoadImageDataOption option;
+  void *user_data = load_image_user_data_;
+  if (!user_image_loader_) {
+    option.preserve_channels = preserve_image_channels_;
+    option.as_is = images_as_is_;
+    user_data = &option;
+  }
+
+  if (!LoadImageData(&image, image_idx, err, warn, req_width, req_height,
+                     bytes, static_cast<int>(size), user_data)) {
+    return false;
+  }
+
+  image.deferred = false;
+  std::vector<unsigned char>().swap(image.encoded);
+  return true;
+}
+
 ///////////////////////
 // GLTF Serialization
 ///////////////////////
@@ -7190,12 +9791,12 @@ static void SerializeValue(const std::string &key, const Value &value,
   }
 }
 
-static void SerializeGltfBufferData(const std::vector<unsigned char> &data,
+static void SerializeGltfBufferData(const unsigned char *data, size_t size,
                                     detail::json &o) {
   std::string header = "data:application/octet-stream;base64,";
-  if (data.size() > 0) {
+  if (size > 0) {
     std::string encodedData =
-        base64_encode(&data[0], static_cast<unsigned int>(data.size()));
+        base64_encode(data, static_cast<unsigned int>(size));
     SerializeStringProperty("uri", header + encodedData, o);
   } else {
     // Issue #229
@@ -7204,7 +9805,7 @@ static void SerializeGltfBufferData(const std::vector<unsigned char> &data,
   }
 }
 
-static bool SerializeGltfBufferData(const std::vector<unsigned char> &data,
+static bool SerializeGltfBufferData(const unsigned char *data, size_t size,
                                     const std::string &binFilename) {
 #ifndef TINYGLTF_NO_FS
 #ifdef _WIN32
@@ -7226,9 +9827,9 @@ static bool SerializeGltfBufferData(const std::vector<unsigned char> &data,
   std::ofstream output(binFilename.c_str(), std::ofstream::binary);
   if (!output.is_open()) return false;
 #endif
-  if (data.size() > 0) {
-    output.write(reinterpret_cast<const char *>(&data[0]),
-                 std::streamsize(data.size()));
+  if (size > 0) {
+    output.write(reinterpret_cast<const char *>(data),
+                 std::streamsize(size));
   } else {
     // Issue #229
     // size 0 will be still valid buffer data.
@@ -7490,10 +10091,9 @@ static void SerializeGltfAsset(const Asset &asset, detail::json &o) {
   SerializeExtrasAndExtensions(asset, o);
 }
 
-static void SerializeGltfBufferBin(const Buffer &buffer, detail::json &o,
-                                   std::vector<unsigned char> &binBuffer) {
-  SerializeNumberProperty("byteLength", buffer.data.size(), o);
-  binBuffer = buffer.data;
+// The data goes to the GLB BIN chunk, written from the buffer itself
+static void SerializeGltfBufferBin(const Buffer &buffer, detail::json &o) {
+  SerializeNumberProperty("byteLength", buffer.Size(), o);
 
   if (buffer.name.size()) SerializeStringProperty("name", buffer.name, o);
 
@@ -7501,8 +10101,8 @@ static void SerializeGltfBufferBin(const Buffer &buffer, detail::json &o,
 }
 
 static void SerializeGltfBuffer(const Buffer &buffer, detail::json &o) {
-  SerializeNumberProperty("byteLength", buffer.data.size(), o);
-  SerializeGltfBufferData(buffer.data, o);
+  SerializeNumberProperty("byteLength", buffer.Size(), o);
+  SerializeGltfBufferData(buffer.Data(), buffer.Size(), o);
 
   if (buffer.name.size()) SerializeStringProperty("name", buffer.name, o);
 
@@ -7512,8 +10112,9 @@ static void SerializeGltfBuffer(const Buffer &buffer, detail::json &o) {
 static bool SerializeGltfBuffer(const Buffer &buffer, detail::json &o,
                                 const std::string &binFilename,
                                 const std::string &binUri) {
-  if (!SerializeGltfBufferData(buffer.data, binFilename)) return false;
-  SerializeNumberProperty("byteLength", buffer.data.size(), o);
+  if (!SerializeGltfBufferData(buffer.Data(), buffer.Size(), binFilename))
+    return false;
+  SerializeNumberProperty("byteLength", buffer.Size(), o);
   SerializeStringProperty("uri", binUri, o);
 
   if (buffer.name.size()) SerializeStringProperty("name", buffer.name, o);
@@ -8452,13 +11053,15 @@ static void SerializeGltfModel(const Model *model, detail::json &o) {
   }
 }
 
-static bool WriteGltfStream(std::ostream &stream, const std::string &content) {
-  stream << content << std::endl;
+static bool WriteGltfStream(std::ostream &stream, const detail::json &content,
+                            int spacing) {
+  if (!detail::JsonWrite(stream, content, spacing)) return false;
+  stream << std::endl;
   return stream.good();
 }
 
 static bool WriteGltfFile(const std::string &output,
-                          const std::string &content) {
+                          const detail::json &content, int spacing) {
 #ifndef TINYGLTF_NO_FS
 #ifdef _WIN32
 #if defined(_MSC_VER)
@@ -8478,67 +11081,77 @@ static bool WriteGltfFile(const std::string &output,
   std::ofstream gltfFile(output.c_str());
   if (!gltfFile.is_open()) return false;
 #endif
-  return WriteGltfStream(gltfFile, content);
+  return WriteGltfStream(gltfFile, content, spacing);
 #else
     return false;
 #endif
 }
 
+// Streams a GLB: the JSON chunk is serialized straight from `content` and
+// the BIN chunk, present when `bin` is set, written from the buffer's own
+// memory. Chunk lengths come from a counting pass over the JSON first, so
+// neither chunk is ever assembled in memory.
 static bool WriteBinaryGltfStream(std::ostream &stream,
-                                  const std::string &content,
-                                  const std::vector<unsigned char> &binBuffer) {
+                                  const detail::json &content,
+                                  const Buffer *bin) {
   const std::string header = "glTF";
   const int version = 2;
 
-  const uint32_t content_size = uint32_t(content.size());
-  const uint32_t binBuffer_size = uint32_t(binBuffer.size());
+  detail::CountingStreamBuf counter;
+  {
+    std::ostream counting(&counter);
+    if (!detail::JsonWrite(counting, content)) return false;
+  }
+
+  const uint64_t content_size = counter.count;
+  const uint64_t binBuffer_size = bin ? bin->Size() : 0;
   // determine number of padding bytes required to ensure 4 byte alignment
   const uint32_t content_padding_size =
-      content_size % 4 == 0 ? 0 : 4 - content_size % 4;
+      content_size % 4 == 0 ? 0 : 4 - uint32_t(content_size % 4);
   const uint32_t bin_padding_size =
-      binBuffer_size % 4 == 0 ? 0 : 4 - binBuffer_size % 4;
+      binBuffer_size % 4 == 0 ? 0 : 4 - uint32_t(binBuffer_size % 4);
 
   // 12 bytes for header, JSON content length, 8 bytes for JSON chunk info.
   // Chunk data must be located at 4-byte boundary, which may require padding
-  const uint32_t length =
+  const uint64_t total_length =
       12 + 8 + content_size + content_padding_size +
       (binBuffer_size ? (8 + binBuffer_size + bin_padding_size) : 0);
+  if (total_length > 0xFFFFFFFFu) {
+    // GLB lengths are 32-bit
+    return false;
+  }
+  const uint32_t length = uint32_t(total_length);
 
   stream.write(header.c_str(), std::streamsize(header.size()));
   stream.write(reinterpret_cast<const char *>(&version), sizeof(version));
   stream.write(reinterpret_cast<const char *>(&length), sizeof(length));
 
   // JSON chunk info, then JSON data
-  const uint32_t model_length = uint32_t(content.size()) + content_padding_size;
+  const uint32_t model_length = uint32_t(content_size) + content_padding_size;
   const uint32_t model_format = 0x4E4F534A;
   stream.write(reinterpret_cast<const char *>(&model_length),
                sizeof(model_length));
   stream.write(reinterpret_cast<const char *>(&model_format),
                sizeof(model_format));
-  stream.write(content.c_str(), std::streamsize(content.size()));
+  if (!detail::JsonWrite(stream, content)) return false;
 
   // Chunk must be multiplies of 4, so pad with spaces
-  if (content_padding_size > 0) {
-    const std::string padding = std::string(size_t(content_padding_size), ' ');
-    stream.write(padding.c_str(), std::streamsize(padding.size()));
-  }
-  if (binBuffer.size() > 0) {
+  static const char spaces[4] = {' ', ' ', ' ', ' '};
+  static const char zeros[4] = {0, 0, 0, 0};
+  stream.write(spaces, std::streamsize(content_padding_size));
+
+  if (binBuffer_size > 0) {
     // BIN chunk info, then BIN data
-    const uint32_t bin_length = uint32_t(binBuffer.size()) + bin_padding_size;
+    const uint32_t bin_length = uint32_t(binBuffer_size) + bin_padding_size;
     const uint32_t bin_format = 0x004e4942;
     stream.write(reinterpret_cast<const char *>(&bin_length),
                  sizeof(bin_length));
     stream.write(reinterpret_cast<const char *>(&bin_format),
                  sizeof(bin_format));
-    stream.write(reinterpret_cast<const char *>(binBuffer.data()),
-                 std::streamsize(binBuffer.size()));
+    stream.write(reinterpret_cast<const char *>(bin->Data()),
+                 std::streamsize(binBuffer_size));
     // Chunksize must be multiplies of 4, so pad with zeroes
-    if (bin_padding_size > 0) {
-      const std::vector<unsigned char> padding =
-          std::vector<unsigned char>(size_t(bin_padding_size), 0);
-      stream.write(reinterpret_cast<const char *>(padding.data()),
-                   std::streamsize(padding.size()));
-    }
+    stream.write(zeros, std::streamsize(bin_padding_size));
   }
 
   stream.flush();
@@ -8546,8 +11159,8 @@ static bool WriteBinaryGltfStream(std::ostream &stream,
 }
 
 static bool WriteBinaryGltfFile(const std::string &output,
-                                const std::string &content,
-                                const std::vector<unsigned char> &binBuffer) {
+                                const detail::json &content,
+                                const Buffer *bin) {
 #ifndef TINYGLTF_NO_FS
 #ifdef _WIN32
 #if defined(_MSC_VER)
@@ -8564,7 +11177,7 @@ static bool WriteBinaryGltfFile(const std::string &output,
 #else
   std::ofstream gltfFile(output.c_str(), std::ios::binary);
 #endif
-  return WriteBinaryGltfStream(gltfFile, content, binBuffer);
+  return WriteBinaryGltfStream(gltfFile, content, bin);
 #else
     return false;
 #endif
@@ -8579,14 +11192,15 @@ bool TinyGLTF::WriteGltfSceneToStream(const Model *model, std::ostream &stream,
   SerializeGltfModel(model, output);
 
   // BUFFERS
-  std::vector<unsigned char> binBuffer;
+  const Buffer *binBuffer = nullptr;
   if (model->buffers.size()) {
     detail::json buffers;
     detail::JsonReserveArray(buffers, model->buffers.size());
     for (unsigned int i = 0; i < model->buffers.size(); ++i) {
       detail::json buffer;
       if (writeBinary && i == 0 && model->buffers[i].uri.empty()) {
-        SerializeGltfBufferBin(model->buffers[i], buffer, binBuffer);
+        SerializeGltfBufferBin(model->buffers[i], buffer);
+        binBuffer = &model->buffers[i];
       } else {
         SerializeGltfBuffer(model->buffers[i], buffer);
       }
@@ -8619,11 +11233,9 @@ bool TinyGLTF::WriteGltfSceneToStream(const Model *model, std::ostream &stream,
   }
 
   if (writeBinary) {
-    return WriteBinaryGltfStream(stream, detail::JsonToString(output),
-                                 binBuffer);
+    return WriteBinaryGltfStream(stream, output, binBuffer);
   } else {
-    return WriteGltfStream(stream,
-                           detail::JsonToString(output, prettyPrint ? 2 : -1));
+    return WriteGltfStream(stream, output, prettyPrint ? 2 : -1);
   }
 }
 
@@ -8651,14 +11263,15 @@ bool TinyGLTF::WriteGltfSceneToFile(const Model *model,
 
   // BUFFERS
   std::vector<std::string> usedFilenames;
-  std::vector<unsigned char> binBuffer;
+  const Buffer *binBuffer = nullptr;
   if (model->buffers.size()) {
     detail::json buffers;
     detail::JsonReserveArray(buffers, model->buffers.size());
     for (unsigned int i = 0; i < model->buffers.size(); ++i) {
       detail::json buffer;
       if (writeBinary && i == 0 && model->buffers[i].uri.empty()) {
-        SerializeGltfBufferBin(model->buffers[i], buffer, binBuffer);
+        SerializeGltfBufferBin(model->buffers[i], buffer);
+        binBuffer = &model->buffers[i];
       } else if (embedBuffers) {
         SerializeGltfBuffer(model->buffers[i], buffer);
       } else {
@@ -8727,11 +11340,9 @@ bool TinyGLTF::WriteGltfSceneToFile(const Model *model,
   }
 
   if (writeBinary) {
-    return WriteBinaryGltfFile(filename, detail::JsonToString(output),
-                               binBuffer);
+    return WriteBinaryGltfFile(filename, output, binBuffer);
   } else {
-    return WriteGltfFile(filename,
-                         detail::JsonToString(output, (prettyPrint ? 2 : -1)));
+    return WriteGltfFile(filename, output, prettyPrint ? 2 : -1);
   }
 }
 
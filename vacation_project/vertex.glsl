@@ -1,41 +1,87 @@
 #version 330 core
 
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
-layout(location = 2) in vec2 aTexCoord;
-layout(location = 3) in ivec4 aJoints;  //  ε (ִ 4 )
-layout(location = 4) in vec4 aWeights;  // ġ
+/* =========================
+   Attributes (glTF)
+   ========================= */
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout(location = 0) in vec3  aPos;       // POSITION
+layout(location = 1) in vec2  aNormalOct; // NORMAL, octahedral snorm16
+layout(location = 2) in uvec4 aJoints;    // JOINTS_0
+layout(location = 3) in vec4  aWeights;   // WEIGHTS_0
+layout(location = 4) in vec2  aTexCoord;  // TEXCOORD_0
+layout(location = 5) in uint  aDrawID;    // per draw, via baseInstance
 
-// ִ   (𵨿  ÷   )
-const int MAX_JOINTS = 100;
-uniform mat4 u_jointMatrices[MAX_JOINTS]; 
+/* =========================
+   Uniforms
+   ========================= */
+
+uniform mat4 uMVP;
+
+// World matrix per draw: four RGBA32F texels (columns) from uDrawBase
+uniform samplerBuffer uDrawMatrices;
+uniform int uDrawBase;
+
+// Streamed from the palette ring buffer (binding 0), one region per frame
+const int MAX_JOINTS = 256;
+
+layout(std140) uniform JointPalette
+{
+    mat4 uJoints[MAX_JOINTS];
+};
+
+/* =========================
+   Outputs
+   ========================= */
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
 
+/* =========================
+   Helpers
+   ========================= */
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+mat4 FetchDrawMatrix(uint drawID)
+{
+    int base = uDrawBase + int(drawID) * 4;
+    return mat4(
+        texelFetch(uDrawMatrices, base + 0),
+        texelFetch(uDrawMatrices, base + 1),
+        texelFetch(uDrawMatrices, base + 2),
+        texelFetch(uDrawMatrices, base + 3));
+}
+
+/* =========================
+   Main
+   ========================= */
+
 void main()
 {
-    // Ű   (ġ * ش  ȯ )
-    mat4 skinMat = 
-        aWeights.x * u_jointMatrices[aJoints.x] +
-        aWeights.y * u_jointMatrices[aJoints.y] +
-        aWeights.z * u_jointMatrices[aJoints.z] +
-        aWeights.w * u_jointMatrices[aJoints.w];
-
-    // Ű    ġ
-    vec4 localPosition = skinMat * vec4(aPos, 1.0);
-    
-    //  ͵ Ű  ȸ п  ޾ƾ 
-    vec4 localNormal = skinMat * vec4(aNormal, 0.0);
-
-    gl_Position = projection * view * model * localPosition;
-    
-    FragPos = vec3(model * localPosition);
-    Normal = mat3(transpose(inverse(model))) * localNormal.xyz;
+    /* ---- Skinning ---- */
+    mat4 skinMat =
+        aWeights.x * uJoints[aJoints.x] +
+        aWeights.y * uJoints[aJoints.y] +
+        aWeights.z * uJoints[aJoints.z] +
+        aWeights.w * uJoints[aJoints.w];
+
+    mat4 world = FetchDrawMatrix(aDrawID);
+
+    vec4 worldPos = world * (skinMat * vec4(aPos, 1.0));
+    vec3 worldNorm = mat3(world) * (mat3(skinMat) * OctDecode(aNormalOct));
+
+    /* ---- Outputs ---- */
+    gl_Position = uMVP * worldPos;
+
+    FragPos = vec3(worldPos);
+    Normal = worldNorm;
     TexCoord = aTexCoord;
-}
\ No newline at end of file
+}
@@ -0,0 +1,229 @@
+#include "vertex_pack.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <gl/glm/gtc/packing.hpp>
+
+/* =========================
+   Encoders
+   ========================= */
+
+static float SignNotZero(float v)
+{
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+static short ToSnorm16(float v)
+{
+    v = std::min(std::max(v, -1.0f), 1.0f);
+    return static_cast<short>(std::lround(v * 32767.0f));
+}
+
+glm::i16vec2 EncodeOctahedral(const glm::vec3& n)
+{
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (l1 <= 0.0f)
+        return glm::i16vec2(0, 32767);   // +Z
+
+    // Project onto the octahedron, fold the lower half over the upper
+    glm::vec2 p(n.x / l1, n.y / l1);
+    if (n.z < 0.0f)
+    {
+        p = glm::vec2(
+            (1.0f - std::fabs(p.y)) * SignNotZero(p.x),
+            (1.0f - std::fabs(p.x)) * SignNotZero(p.y));
+    }
+
+    return glm::i16vec2(ToSnorm16(p.x), ToSnorm16(p.y));
+}
+
+glm::vec3 DecodeOctahedral(const glm::i16vec2& e)
+{
+    // Same as OctDecode in the vertex shaders
+    glm::vec2 p(
+        std::max(e.x / 32767.0f, -1.0f),
+        std::max(e.y / 32767.0f, -1.0f));
+
+    glm::vec3 n(p.x, p.y, 1.0f - std::fabs(p.x) - std::fabs(p.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+glm::u16vec4 QuantizeWeights(const glm::vec4& w, unsigned scale)
+{
+    glm::vec4 c = glm::max(w, glm::vec4(0.0f));
+    float sum = c.x + c.y + c.z + c.w;
+    if (sum <= 0.0f)
+        return glm::u16vec4(static_cast<unsigned short>(scale), 0, 0, 0);
+
+    c *= scale / sum;
+
+    glm::u16vec4 q;
+    int total = 0;
+    int largest = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        q[i] = static_cast<unsigned short>(std::lround(c[i]));
+        total += q[i];
+        if (c[i] > c[largest])
+            largest = i;
+    }
+
+    // Rounding error goes to the dominant influence, where it matters least
+    q[largest] = static_cast<unsigned short>(q[largest] + static_cast<int>(scale) - total);
+    return q;
+}
+
+/* =========================
+   Packing
+   ========================= */
+
+// Vertices converted per block in PackVertices
+const size_t kPackBlock = 256;
+
+VertexLayout ChooseVertexLayout(const VertexStreams& streams, WeightPrecision precision)
+{
+    const size_t count = streams.positions.Size();
+
+    unsigned short maxJoint = streams.rigidJoint;
+    if (streams.joints.Size() == count)
+    {
+        glm::u16vec4 block[kPackBlock];
+        maxJoint = 0;
+        for (size_t first = 0; first < count; first += kPackBlock)
+        {
+            size_t n = std::min(kPackBlock, count - first);
+            streams.joints.Read(first, n, block);
+            for (size_t i = 0; i < n; i++)
+            {
+                const glm::u16vec4& j = block[i];
+                maxJoint = std::max(maxJoint, std::max(std::max(j.x, j.y), std::max(j.z, j.w)));
+            }
+        }
+    }
+
+    VertexLayout layout;
+    layout.jointType = maxJoint < 256 ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT;
+    layout.weightType = precision == WeightPrecision::Unorm8 ?
+        GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT;
+
+    size_t jointSize = layout.jointType == GL_UNSIGNED_BYTE ? 1 : 2;
+    size_t weightSize = layout.weightType == GL_UNSIGNED_BYTE ? 1 : 2;
+
+    // Every attribute stays 4-byte aligned
+    layout.position = 0;
+    layout.normal = layout.position + 3 * sizeof(float);
+    layout.joints = layout.normal + 2 * sizeof(short);
+    layout.weights = layout.joints + 4 * jointSize;
+    layout.uv = layout.weights + 4 * weightSize;
+    layout.stride = static_cast<GLsizei>(layout.uv + 2 * sizeof(unsigned short));
+
+    return layout;
+}
+
+template <typename T>
+static void Store(unsigned char* dst, const T& value)
+{
+    std::memcpy(dst, &value, sizeof(T));
+}
+
+void PackVertices(
+    const VertexStreams& streams,
+    const VertexLayout& l,
+    unsigned char* dst)
+{
+    const size_t count = streams.positions.Size();
+
+    const bool hasNormals = streams.normals.Size() == count;
+    const bool hasJoints = streams.joints.Size() == count;
+    const bool hasWeights = streams.weights.Size() == count;
+    const bool hasUVs = streams.uvs.Size() == count;
+
+    const unsigned scale = l.weightType == GL_UNSIGNED_BYTE ? 255 : 65535;
+
+    // Stored as read: no staging at all
+    streams.positions.Read(0, count,
+        reinterpret_cast<glm::vec3*>(dst + l.position), l.stride);
+
+    const bool directJoints = hasJoints && l.jointType == GL_UNSIGNED_SHORT;
+    if (directJoints)
+    {
+        streams.joints.Read(0, count,
+            reinterpret_cast<glm::u16vec4*>(dst + l.joints), l.stride);
+    }
+
+    glm::vec3 normals[kPackBlock];
+    glm::u16vec4 joints[kPackBlock];
+    glm::vec4 weights[kPackBlock];
+    glm::vec2 uvs[kPackBlock];
+
+    for (size_t first = 0; first < count; first += kPackBlock)
+    {
+        const size_t n = std::min(kPackBlock, count - first);
+
+        if (hasNormals) streams.normals.Read(first, n, normals);
+        if (hasJoints && !directJoints) streams.joints.Read(first, n, joints);
+        if (hasWeights) streams.weights.Read(first, n, weights);
+        if (hasUVs) streams.uvs.Read(first, n, uvs);
+
+        for (size_t i = 0; i < n; i++)
+        {
+            unsigned char* v = dst + (first + i) * l.stride;
+
+            glm::vec3 nrm = hasNormals ? normals[i] : glm::vec3(0, 1, 0);
+            Store(v + l.normal, EncodeOctahedral(nrm));
+
+            if (!directJoints)
+            {
+                glm::u16vec4 j = hasJoints ?
+                    joints[i] : glm::u16vec4(streams.rigidJoint, 0, 0, 0);
+                if (l.jointType == GL_UNSIGNED_BYTE)
+                    Store(v + l.joints, glm::u8vec4(j));
+                else
+                    Store(v + l.joints, j);
+            }
+
+            glm::vec4 w = hasWeights ? weights[i] : glm::vec4(1, 0, 0, 0);
+            glm::u16vec4 qw = QuantizeWeights(w, scale);
+            if (l.weightType == GL_UNSIGNED_BYTE)
+                Store(v + l.weights, glm::u8vec4(qw));
+            else
+                Store(v + l.weights, qw);
+
+            glm::vec2 uv = hasUVs ? uvs[i] : glm::vec2(0.0f);
+            Store(v + l.uv, glm::u16vec2(glm::packHalf1x16(uv.x), glm::packHalf1x16(uv.y)));
+        }
+    }
+}
+
+void SetupPackedAttributes(const VertexLayout& layout)
+{
+    // POSITION (location = 0)
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, layout.stride,
+        (void*)layout.position);
+
+    // NORMAL (location = 1), decoded in the shader
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, layout.stride,
+        (void*)layout.normal);
+
+    // JOINTS_0 (location = 2)
+    glEnableVertexAttribArray(2);
+    glVertexAttribIPointer(2, 4, layout.jointType, layout.stride,
+        (void*)layout.joints);
+
+    // WEIGHTS_0 (location = 3)
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 4, layout.weightType, GL_TRUE, layout.stride,
+        (void*)layout.weights);
+
+    // TEXCOORD_0 (location = 4)
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 2, GL_HALF_FLOAT, GL_FALSE, layout.stride,
+        (void*)layout.uv);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+
+#include <gl/glew.h>
+#include <gl/glm/glm.hpp>
+#include <gl/glm/gtc/type_precision.hpp>
+
+#include "accessor_view.h"
+
+/* =========================
+   Vertex Packing
+   ========================= */
+
+// Compact interleaved layout for skinned vertices:
+//
+//   location 0  POSITION    3 x float32
+//   location 1  NORMAL      2 x snorm16, octahedral
+//   location 2  JOINTS_0    4 x uint8 (uint16 past 256 joints), integer
+//   location 3  WEIGHTS_0   4 x unorm8 or unorm16, summing to one
+//   location 4  TEXCOORD_0  2 x half float
+//
+// 28-36 bytes per vertex instead of 76 for the all-float layout.
+
+enum class WeightPrecision
+{
+    Unorm8,
+    Unorm16,
+};
+
+// Attributes of one primitive, read in place from the model; all but
+// positions may be empty.
+struct VertexStreams
+{
+    AccessorView<glm::vec3> positions;
+    AccessorView<glm::vec3> normals;
+    AccessorView<glm::u16vec4> joints;
+    AccessorView<glm::vec4> weights;
+    AccessorView<glm::vec2> uvs;
+
+    // Joint given full weight when there is no JOINTS_0, so rigid
+    // geometry can share the skinning shader
+    unsigned short rigidJoint = 0;
+};
+
+struct VertexLayout
+{
+    GLsizei stride = 0;
+
+    size_t position = 0;        // byte offsets
+    size_t normal = 0;
+    size_t joints = 0;
+    size_t weights = 0;
+    size_t uv = 0;
+
+    GLenum jointType = GL_UNSIGNED_BYTE;
+    GLenum weightType = GL_UNSIGNED_SHORT;
+};
+
+VertexLayout ChooseVertexLayout(
+    const VertexStreams& streams,
+    WeightPrecision precision);
+
+// Writes positions.Size() vertices, layout.stride bytes each, to dst.
+// Attributes convert from the model straight into dst, or through small
+// blocks on the stack when they need encoding.
+void PackVertices(
+    const VertexStreams& streams,
+    const VertexLayout& layout,
+    unsigned char* dst);
+
+// Points attributes 0-4 at the GL_ARRAY_BUFFER currently bound.
+void SetupPackedAttributes(const VertexLayout& layout);
+
+// ---- Encoders ----
+
+glm::i16vec2 EncodeOctahedral(const glm::vec3& n);
+glm::vec3 DecodeOctahedral(const glm::i16vec2& e);
+
+// Quantizes to `scale` (255 or 65535) keeping the sum exactly `scale`.
+glm::u16vec4 QuantizeWeights(const glm::vec4& w, unsigned scale);